@@ -0,0 +1,332 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_BLEP_OSCILLATOR_HPP
+#define SYNTH_BLEP_OSCILLATOR_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "synth/fixed.hpp"
+#include "synth/nco.hpp"
+#include "synth/span.hpp"
+#include "synth/wavetable.hpp"
+
+namespace synth {
+
+/// The shapes produced by blep_oscillator.
+enum class blep_waveform : uint8_t {
+  sawtooth,
+  square,
+  /// A square wave whose duty cycle is set by
+  /// blep_oscillator::set_pulse_width().
+  pulse,
+  triangle,
+};
+
+namespace details {
+
+/// Each residual table has 2^blep_table_bits intervals.
+constexpr auto blep_table_bits = 8U;
+constexpr auto blep_table_size = (size_t{1} << blep_table_bits) + 1U;
+/// The residual values have blep_residual_bits fractional bits.
+constexpr auto blep_residual_bits = 30U;
+/// The position within a residual table has blep_position_bits fractional
+/// bits.
+constexpr auto blep_position_bits = 16U;
+
+using blep_table = std::array<int32_t, blep_table_size>;
+
+/// \tparam Function  A function with signature equivalent to double(double).
+template <typename Function>
+constexpr blep_table make_blep_table (Function const f) {
+  blep_table t{};
+  for (auto k = size_t{0}; k < t.size (); ++k) {
+    auto const u =
+        static_cast<double> (k) / static_cast<double> (blep_table_size - 1U);
+    t[k] = static_cast<int32_t> (round (
+        f (u) * static_cast<double> (uint64_t{1} << blep_residual_bits)));
+  }
+  return t;
+}
+
+/// The polynomial band-limited step residual for the sample which precedes a
+/// discontinuity by (1-u) of the phase increment. The sample which follows it
+/// by u uses the negated value at 1-u.
+inline constexpr blep_table blep_residual =
+    make_blep_table ([] (double const u) { return u * u; });
+/// The polynomial band-limited ramp residual: the integral of blep_residual,
+/// which corrects a discontinuity in slope. The value for the sample which
+/// follows the corner by u is that at 1-u.
+inline constexpr blep_table blamp_residual =
+    make_blep_table ([] (double const u) { return u * u * u / 3.0; });
+
+/// Returns the value of table \p t at \p u, which has blep_position_bits
+/// fractional bits, using linear interpolation.
+constexpr int64_t blep_lookup (blep_table const& t, uint32_t const u) {
+  constexpr auto frac_bits = blep_position_bits - blep_table_bits;
+  auto const i = std::min (size_t{u >> frac_bits}, blep_table_size - 2U);
+  auto const frac = int64_t{u} - static_cast<int64_t> (i << frac_bits);
+  return t[i] + (((t[i + 1U] - int64_t{t[i]}) * frac) >> frac_bits);
+}
+
+}  // end namespace details
+
+/// A band-limited oscillator producing the classic analog shapes.
+///
+/// Each shape is computed directly from the phase and then the samples on
+/// either side of each discontinuity are corrected by a polynomial residual
+/// (PolyBLEP for a step in value and PolyBLAMP for a step in slope). The
+/// residuals are taken from small precomputed tables so the arithmetic is all
+/// integer: the phase accumulator is that of oscillator and division by the
+/// phase increment is replaced by multiplication by a reciprocal which is
+/// computed when the frequency changes.
+///
+/// render() fills a block with the uncorrected shape in a loop without
+/// branches and then visits only the discontinuities which fall within it,
+/// so the cost of the band-limiting is proportional to the frequency rather
+/// than to the number of samples.
+///
+/// The frequency must be below the Nyquist frequency.
+template <unsigned SampleRate, typename Traits>
+class blep_oscillator {
+public:
+  using traits = Traits;
+  static constexpr auto sample_rate = SampleRate;
+  using phase_index_type = typename oscillator_info<traits>::phase_index_type;
+
+  constexpr explicit blep_oscillator (
+      blep_waveform const w = blep_waveform::sawtooth) noexcept
+      : waveform_{w} {}
+
+  blep_waveform waveform () const noexcept { return waveform_; }
+  void set_waveform (blep_waveform const w) noexcept { waveform_ = w; }
+
+  void set_frequency (frequency f) noexcept;
+  /// Sets the duty cycle of the blep_waveform::pulse shape.
+  ///
+  /// \param width  The fraction of each cycle for which the output is high.
+  ///   It must lie in the range (0, 1).
+  void set_pulse_width (double width) noexcept;
+
+  /// Fills the buffer \p out with consecutive samples from the oscillator.
+  void render (span<amplitude> out) noexcept;
+
+  amplitude tick () noexcept {
+    amplitude result;
+    this->render (span<amplitude>{&result, 1U});
+    return result;
+  }
+
+private:
+  static constexpr auto M = traits::M;
+  static_assert (M <= 32U && M > amplitude::fractional_bits + 2U,
+                 "The phase accumulator must have between 25 and 32 bits");
+  /// The number of distinct phase values.
+  static constexpr auto modulus = uint64_t{1} << M;
+  static constexpr auto phase_mask = modulus - 1U;
+  /// The amplitude value 1.0.
+  static constexpr auto one = int64_t{1} << amplitude::fractional_bits;
+
+  /// Fills \p out with the values of \p shape, a function of the phase, from
+  /// the current phase onwards.
+  template <typename Shape>
+  void fill (span<amplitude> out, Shape shape) const noexcept;
+  /// Calls \p f for each sample in [0, n] which immediately follows the phase
+  /// passing \p edge. The arguments are the sample's index and the distance by
+  /// which its phase is past the edge; the latter is less than the increment.
+  template <typename Function>
+  void for_each_edge (size_t n, uint64_t edge, Function f) const noexcept;
+  /// Corrects the samples on either side of each step in value at phase \p
+  /// edge. The step is from -1 to +1 if \p rising, otherwise from +1 to -1.
+  void add_blep (span<amplitude> out, uint64_t edge,
+                 bool rising) const noexcept;
+  /// Corrects the samples on either side of each corner at phase \p edge where
+  /// the slope changes by \p slope_change (in amplitude per cycle).
+  void add_blamp (span<amplitude> out, uint64_t edge,
+                  int64_t slope_change) const noexcept;
+
+  /// Returns the position u in [0,1) of \p x within the phase increment.
+  uint32_t position (uint64_t const x) const noexcept {
+    assert (x < increment_);
+    return static_cast<uint32_t> ((x * reciprocal_) >> M);
+  }
+  static void add (amplitude &a, int64_t const v) noexcept {
+    a = amplitude::frombits (static_cast<uint32_t> (a.get () + v));
+  }
+
+  blep_waveform waveform_;
+  uint64_t phase_ = 0;
+  uint64_t increment_ = 0;
+  /// 2^(M+blep_position_bits) divided by increment_.
+  uint64_t reciprocal_ = 0;
+  /// The phase at which the pulse falls.
+  uint64_t width_ = modulus / 2U;
+};
+
+// set frequency
+// ~~~~~~~~~~~~~
+template <unsigned SampleRate, typename Traits>
+void blep_oscillator<SampleRate, Traits>::set_frequency (
+    frequency const f) noexcept {
+  increment_ =
+      uint64_t{oscillator<SampleRate, Traits>::phase_increment (f).get ()};
+  assert (increment_ < modulus / 2U && "frequency must be below Nyquist");
+  constexpr auto numerator = uint64_t{1} << (M + details::blep_position_bits);
+  reciprocal_ = increment_ == 0U ? 0U : numerator / increment_;
+}
+
+// set pulse width
+// ~~~~~~~~~~~~~~~
+template <unsigned SampleRate, typename Traits>
+void blep_oscillator<SampleRate, Traits>::set_pulse_width (
+    double const width) noexcept {
+  assert (width > 0.0 && width < 1.0);
+  width_ = static_cast<uint64_t> (
+      details::round (width * static_cast<double> (modulus)));
+}
+
+// fill
+// ~~~~
+template <unsigned SampleRate, typename Traits>
+template <typename Shape>
+void blep_oscillator<SampleRate, Traits>::fill (span<amplitude> const out,
+                                                Shape const shape) const
+    noexcept {
+  // The phase fits in 32 bits, which allows the loop to be vectorized.
+  auto phase = static_cast<uint32_t> (phase_);
+  auto const increment = static_cast<uint32_t> (increment_);
+  for (amplitude &a : out) {
+    a = amplitude::frombits (static_cast<uint32_t> (shape (phase)));
+    phase = (phase + increment) & static_cast<uint32_t> (phase_mask);
+  }
+}
+
+// for each edge
+// ~~~~~~~~~~~~~
+template <unsigned SampleRate, typename Traits>
+template <typename Function>
+void blep_oscillator<SampleRate, Traits>::for_each_edge (
+    size_t const n, uint64_t const edge, Function const f) const noexcept {
+  auto const d = increment_;
+  if (d == 0U) {
+    return;
+  }
+  // The phase of sample k relative to the edge.
+  auto x = (phase_ + modulus - edge) & phase_mask;
+  auto k = size_t{0};
+  if (x < d) {
+    f (k, x);
+  }
+  for (;;) {
+    // Sample n is the first of the next block. If the edge is not passed by
+    // then, there are no more edges in this block. Checking this first means
+    // that there is no division unless an edge is found.
+    auto const remaining = modulus - x;
+    if (remaining > (n - k) * d) {
+      return;
+    }
+    auto const steps = (remaining + d - 1U) / d;
+    k += steps;
+    x = x + steps * d - modulus;
+    f (k, x);
+  }
+}
+
+// add blep
+// ~~~~~~~~
+template <unsigned SampleRate, typename Traits>
+void blep_oscillator<SampleRate, Traits>::add_blep (
+    span<amplitude> const out, uint64_t const edge,
+    bool const rising) const noexcept {
+  constexpr auto shift =
+      details::blep_residual_bits - amplitude::fractional_bits;
+  constexpr auto unit = uint32_t{1} << details::blep_position_bits;
+  auto const n = out.size ();
+  auto const sign = rising ? int64_t{1} : int64_t{-1};
+  this->for_each_edge (n, edge, [&] (size_t const k, uint64_t const x) {
+    auto const u = this->position (x);
+    if (k > 0U) {
+      add (out[k - 1U],
+           sign * (details::blep_lookup (details::blep_residual, u) >> shift));
+    }
+    if (k < n) {
+      add (out[k], -sign * (details::blep_lookup (details::blep_residual,
+                                                  unit - u) >>
+                            shift));
+    }
+  });
+}
+
+// add blamp
+// ~~~~~~~~~
+template <unsigned SampleRate, typename Traits>
+void blep_oscillator<SampleRate, Traits>::add_blamp (
+    span<amplitude> const out, uint64_t const edge,
+    int64_t const slope_change) const noexcept {
+  // The correction is slope_change * (increment_/2^M) * residual, scaled to
+  // an amplitude.
+  constexpr auto shift =
+      M + details::blep_residual_bits - amplitude::fractional_bits;
+  constexpr auto unit = uint32_t{1} << details::blep_position_bits;
+  auto const n = out.size ();
+  auto const scale = slope_change * static_cast<int64_t> (increment_);
+  this->for_each_edge (n, edge, [&] (size_t const k, uint64_t const x) {
+    auto const u = this->position (x);
+    if (k > 0U) {
+      add (out[k - 1U],
+           (scale * details::blep_lookup (details::blamp_residual, u)) >>
+               shift);
+    }
+    if (k < n) {
+      add (out[k],
+           (scale * details::blep_lookup (details::blamp_residual, unit - u)) >>
+               shift);
+    }
+  });
+}
+
+// render
+// ~~~~~~
+template <unsigned SampleRate, typename Traits>
+void blep_oscillator<SampleRate, Traits>::render (
+    span<amplitude> const out) noexcept {
+  constexpr auto high = static_cast<int32_t> (one);
+  constexpr auto half = static_cast<uint32_t> (modulus / 2U);
+  switch (waveform_) {
+  case blep_waveform::sawtooth:
+    this->fill (out, [] (uint32_t const p) {
+      return static_cast<int32_t> (p >> (M - amplitude::fractional_bits - 1U)) -
+             high;
+    });
+    this->add_blep (out, 0U, false);
+    break;
+  case blep_waveform::square:
+  case blep_waveform::pulse: {
+    auto const width = static_cast<uint32_t> (
+        waveform_ == blep_waveform::square ? modulus / 2U : width_);
+    this->fill (out, [width] (uint32_t const p) {
+      return p < width ? high : -high;
+    });
+    this->add_blep (out, 0U, true);
+    this->add_blep (out, width, false);
+  } break;
+  case blep_waveform::triangle:
+    this->fill (out, [] (uint32_t const p) {
+      auto const ramp =
+          static_cast<int32_t> (p >> (M - amplitude::fractional_bits - 2U));
+      return p < half ? ramp - high : 3 * high - ramp;
+    });
+    // The slope is 4 per cycle: rising from the minimum at phase 0 and falling
+    // from the maximum half a cycle later.
+    this->add_blamp (out, 0U, 8);
+    this->add_blamp (out, half, -8);
+    break;
+  }
+  phase_ = (phase_ + out.size () * increment_) & phase_mask;
+}
+
+}  // end namespace synth
+
+#endif  // SYNTH_BLEP_OSCILLATOR_HPP
@@ -0,0 +1,244 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_COMPACT_WAVETABLE_HPP
+#define SYNTH_COMPACT_WAVETABLE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "synth/fixed.hpp"
+#include "synth/lerp.hpp"
+#include "synth/span.hpp"
+#include "synth/wavetable.hpp"
+
+namespace synth {
+
+/// The symmetries of a waveform which a compact_wavetable can exploit to
+/// reduce the number of entries that it stores.
+enum class symmetry : uint8_t {
+  /// No symmetry: every entry is stored.
+  none,
+  /// f(θ+π) = -f(θ) (for example, a square wave). The first half of the cycle
+  /// is stored.
+  half_wave,
+  /// f(-θ) = -f(θ) and f(π-θ) = f(θ) (for example, a sine wave). The first
+  /// quarter of the cycle is stored.
+  quarter_wave_odd,
+  /// f(-θ) = f(θ) and f(π-θ) = -f(θ) (for example, a cosine wave or the
+  /// triangle wave). The first quarter of the cycle is stored.
+  quarter_wave_even,
+};
+
+/// A wavetable which uses less memory than wavetable<> by storing only the
+/// part of a cycle from which the rest can be reconstructed using the
+/// waveform's symmetry, and by (optionally) storing its entries as narrow
+/// integers which are widened to amplitude on lookup.
+///
+/// A compact_wavetable may be used anywhere that a wavetable<> can, including
+/// as an oscillator's wavetable; the two behave identically other than for the
+/// lower precision of the entries.
+///
+/// \tparam Traits  The oscillator traits.
+/// \tparam Symmetry  The symmetry of the waveform.
+/// \tparam Entry  The type of the stored entries: either amplitude or a signed
+///   integer type holding a fixed-point value with no integral bits.
+template <typename Traits, symmetry Symmetry, typename Entry = int16_t>
+class compact_wavetable {
+public:
+  /// The traits type with which this wavetable is associated.
+  using traits = Traits;
+  using phase_index_type = typename oscillator_info<Traits>::phase_index_type;
+
+  /// \tparam Function  A function with signature equivalent to double(double).
+  /// \param f A function f(θ) which will be invoked with θ from the portion of
+  ///   [0..2π) which is stored.
+  template <typename Function>
+  constexpr explicit compact_wavetable (Function f) {
+    constexpr double delta = two_pi / table_size_;
+    for (auto k = size_t{0}; k < stored_; ++k) {
+      y_[k] = encode (f (static_cast<double> (k) * delta));
+    }
+  }
+
+  constexpr amplitude phase_to_amplitude (
+      phase_index_type const phase) const noexcept;
+  /// Computes the amplitude for each of the phase values in \p phases and
+  /// writes them to the corresponding element of \p out.
+  void phase_to_amplitude (span<phase_index_type const> phases,
+                           span<amplitude> out) const noexcept;
+
+  /// Returns entry \p index of the complete (2^wavetable_N entry) table.
+  constexpr amplitude operator[] (size_t index) const noexcept;
+
+  /// The number of entries in the complete table.
+  static constexpr auto size () noexcept { return table_size_; }
+  /// The number of entries which are actually stored.
+  static constexpr auto stored_size () noexcept { return stored_; }
+
+private:
+  static constexpr auto N = Traits::wavetable_N;
+  static_assert (N >= 2U, "A table must have at least four entries");
+  static constexpr auto table_size_ = size_t{1} << N;
+  static constexpr auto half_ = table_size_ / 2U;
+  static constexpr auto quarter_ = table_size_ / 4U;
+  /// A quarter-wave table includes the entry at π/2 as well as those before it.
+  static constexpr auto stored_ =
+      Symmetry == symmetry::none        ? table_size_
+      : Symmetry == symmetry::half_wave ? half_
+                                        : quarter_ + 1U;
+
+  static constexpr bool narrow_ = !std::is_same_v<Entry, amplitude>;
+  static_assert (!narrow_ || (std::is_integral_v<Entry> &&
+                              std::is_signed_v<Entry> &&
+                              std::numeric_limits<Entry>::digits <=
+                                  static_cast<int> (amplitude::fractional_bits)),
+                 "Entry must be amplitude or a narrower signed integer");
+
+  std::array<Entry, stored_> y_{};
+
+  static constexpr auto interpolation_ = oscillator_info<Traits>::interpolation;
+  /// The number of phase bits below the table index.
+  static constexpr auto shift_ =
+      oscillator_info<Traits>::accumulator_fractional_bits;
+  /// The position of a phase between two table entries.
+  using ratio_type = ufixed<shift_, 0>;
+
+  /// Converts a value in the range [-1, 1] to an entry. Values which the
+  /// entry type cannot represent (such as +1) are clamped.
+  static constexpr Entry encode (double v);
+  /// Widens an entry to an amplitude.
+  static constexpr amplitude decode (Entry e) noexcept;
+
+  static constexpr size_t wrap (size_t const index) noexcept {
+    return index & mask_v<N>;
+  }
+};
+
+// encode
+// ~~~~~~
+template <typename Traits, symmetry Symmetry, typename Entry>
+constexpr Entry compact_wavetable<Traits, Symmetry, Entry>::encode (
+    double const v) {
+  if constexpr (narrow_) {
+    using limits = std::numeric_limits<Entry>;
+    constexpr auto scale =
+        static_cast<double> (sinteger_t<64>{1} << limits::digits);
+    return static_cast<Entry> (std::clamp (
+        details::round (v * scale), sinteger_t<64>{limits::min ()},
+        sinteger_t<64>{limits::max ()}));
+  } else {
+    return amplitude::fromfp (v);
+  }
+}
+
+// decode
+// ~~~~~~
+template <typename Traits, symmetry Symmetry, typename Entry>
+constexpr amplitude compact_wavetable<Traits, Symmetry, Entry>::decode (
+    Entry const e) noexcept {
+  if constexpr (narrow_) {
+    // Move the binary point from the entry's position to amplitude's.
+    constexpr auto scale = amplitude::value_type{1}
+                           << (amplitude::fractional_bits -
+                               static_cast<unsigned> (
+                                   std::numeric_limits<Entry>::digits));
+    return amplitude::frombits (static_cast<uinteger_t<amplitude::total_bits>> (
+        static_cast<amplitude::value_type> (e) * scale));
+  } else {
+    return e;
+  }
+}
+
+// operator[]
+// ~~~~~~~~~~
+template <typename Traits, symmetry Symmetry, typename Entry>
+constexpr amplitude compact_wavetable<Traits, Symmetry, Entry>::operator[] (
+    size_t const index) const noexcept {
+  assert (index < table_size_);
+  if constexpr (Symmetry == symmetry::none) {
+    return decode (y_[index]);
+  } else if constexpr (Symmetry == symmetry::half_wave) {
+    auto const e = decode (y_[index & (half_ - 1U)]);
+    return index < half_ ? e : -e;
+  } else if constexpr (Symmetry == symmetry::quarter_wave_odd) {
+    // The second half of the cycle is the negated first half. Within a half,
+    // the second quarter mirrors the first.
+    auto const m = index & (half_ - 1U);
+    auto const e = decode (y_[m <= quarter_ ? m : half_ - m]);
+    return index < half_ ? e : -e;
+  } else {
+    static_assert (Symmetry == symmetry::quarter_wave_even);
+    // The second half of the cycle mirrors the first. Within a half, the
+    // second quarter is the negated mirror of the first.
+    auto const m = index <= half_ ? index : table_size_ - index;
+    auto const e = decode (y_[m <= quarter_ ? m : half_ - m]);
+    return m <= quarter_ ? e : -e;
+  }
+}
+
+// phase to amplitude
+// ~~~~~~~~~~~~~~~~~~
+template <typename Traits, symmetry Symmetry, typename Entry>
+constexpr amplitude
+compact_wavetable<Traits, Symmetry, Entry>::phase_to_amplitude (
+    phase_index_type const phase) const noexcept {
+  // The most significant (wavetable_N) bits of the phase accumulator output
+  // provide the index into the lookup table.
+  auto const index =
+      static_cast<size_t> ((phase.get () >> shift_) & mask_v<N>);
+  if constexpr (interpolation_ == interpolation::none) {
+    return (*this)[index];
+  } else {
+    // The remaining bits give the position between entry 'index' and its
+    // successor.
+    auto const r = ratio_type::frombits (
+        static_cast<typename ratio_type::value_type> (phase.get () &
+                                                      mask_v<shift_>));
+    auto const& self = *this;
+    if constexpr (interpolation_ == interpolation::linear) {
+      return lerp_b (self[wrap (index + 1U)], self[index], r);
+    } else {
+      return hermite (self[wrap (index + table_size_ - 1U)], self[index],
+                      self[wrap (index + 1U)], self[wrap (index + 2U)], r);
+    }
+  }
+}
+
+template <typename Traits, symmetry Symmetry, typename Entry>
+void compact_wavetable<Traits, Symmetry, Entry>::phase_to_amplitude (
+    span<phase_index_type const> const phases,
+    span<amplitude> const out) const noexcept {
+  assert (phases.size () == out.size ());
+  auto const size = std::min (phases.size (), out.size ());
+  for (auto ctr = size_t{0}; ctr < size; ++ctr) {
+    out[ctr] = this->phase_to_amplitude (phases[ctr]);
+  }
+}
+
+// Compact forms of the standard wavetables. The sine and triangle tables are a
+// quarter of a cycle of 16-bit values (1/8 of the size of the full tables);
+// the square table is half a cycle. Unlike square<>, compact_square<> is -1 at
+// exactly θ=π because that point belongs to the negated second half.
+
+template <typename Traits>
+inline constexpr compact_wavetable<Traits, symmetry::quarter_wave_odd>
+    compact_sine{[] (double const theta) { return details::sin (theta); }};
+
+template <typename Traits>
+inline constexpr compact_wavetable<Traits, symmetry::half_wave> compact_square{
+    [] (double const /*theta*/) { return 1.0; }};
+
+template <typename Traits>
+inline constexpr compact_wavetable<Traits, symmetry::quarter_wave_even>
+    compact_triangle{[] (double const theta) { return theta / half_pi - 1.0; }};
+
+template <typename Traits>
+inline constexpr compact_wavetable<Traits, symmetry::none> compact_sawtooth{
+    [] (double const theta) { return theta / pi - 1.0; }};
+
+}  // end namespace synth
+
+#endif  // SYNTH_COMPACT_WAVETABLE_HPP
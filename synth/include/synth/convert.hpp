@@ -0,0 +1,540 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_CONVERT_HPP
+#define SYNTH_CONVERT_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "synth/fixed.hpp"
+#include "synth/simd.hpp"
+#include "synth/span.hpp"
+#include "synth/wavetable.hpp"
+
+namespace synth {
+
+// Sample conversion
+// ~~~~~~~~~~~~~~~~~
+// Block conversions between amplitude, double, and float samples, and between
+// these and the little-endian integer and floating-point encodings used by
+// audio files and devices. A gain is applied to every sample on the way.
+// Integer and amplitude output is clamped to the range [-1, +1].
+//
+// The input is processed in fixed-size blocks. Where the compiler can't
+// vectorize a loop by itself, there are AVX2 and AVX-512 versions.
+
+/// Generates triangular probability density function (TPDF) dither: the
+/// difference of two independent, uniformly distributed, random values. Adding
+/// it to a signal before quantization decorrelates the quantization error from
+/// the signal.
+///
+/// The values come from a number of independent xorshift generators so that a
+/// block of them is computed with vector instructions. The two uniform values
+/// which make up each dither value come from different generators.
+class tpdf_dither {
+public:
+  static constexpr auto lanes = size_t{8};
+
+  explicit tpdf_dither (uint32_t seed = 1U) noexcept {
+    for (auto& generators : state_) {
+      for (auto& s : generators) {
+        // Spread the seed across the generators. A xorshift state must not be
+        // zero.
+        seed = seed * 1664525U + 1013904223U;
+        s = seed | 1U;
+      }
+    }
+  }
+
+  /// Fills \p out with dither values. Each is in the range (-1, 1).
+  void fill (span<double> out) noexcept;
+
+private:
+  /// Advances the xorshift32 generator \p x and returns a uniform value in
+  /// [0, 1) from the top 24 bits of its new state.
+  static double uniform (uint32_t& x) noexcept {
+    x ^= x << 13U;
+    x ^= x >> 17U;
+    x ^= x << 5U;
+    return static_cast<double> (x >> 8U) / 16777216.0;
+  }
+
+  /// Two sets of generators: one for each of the uniform values.
+  std::array<std::array<uint32_t, lanes>, 2> state_{};
+};
+
+// fill
+// ~~~~
+inline void tpdf_dither::fill (span<double> const out) noexcept {
+  for (auto first = size_t{0}, size = out.size (); first < size;
+       first += lanes) {
+    std::array<double, lanes> d;
+    for (auto k = size_t{0}; k < lanes; ++k) {
+      d[k] = uniform (state_[0][k]) - uniform (state_[1][k]);
+    }
+    std::copy_n (std::begin (d), std::min (lanes, size - first),
+                 out.data () + first);
+  }
+}
+
+namespace details {
+
+/// The number of samples converted by each step of the conversion loops.
+constexpr auto convert_block_size = size_t{64};
+
+/// True if the host stores integers in little-endian order, allowing a block
+/// of them to be copied directly to little-endian output.
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+constexpr bool little_endian = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+#else
+constexpr bool little_endian = true;  // x86 and ARM.
+#endif
+
+constexpr double sample_value (double const x) noexcept { return x; }
+constexpr double sample_value (float const x) noexcept { return x; }
+constexpr double sample_value (amplitude const x) noexcept {
+  return x.as_double ();
+}
+
+}  // end namespace details
+
+/// Converts samples to floating point: out[i] = in[i] * gain.
+///
+/// \tparam From  The input sample type: amplitude, double, or float.
+/// \tparam To  The output sample type: double or float.
+template <typename From, typename To,
+          typename = std::enable_if_t<std::is_floating_point_v<To>>>
+void convert (span<From const> const in, span<To> const out,
+              To const gain = To{1}) noexcept {
+  assert (in.size () == out.size ());
+  auto const* const x = in.data ();
+  auto* const y = out.data ();
+  for (auto k = size_t{0}, n = std::min (in.size (), out.size ()); k < n; ++k) {
+    auto const v = details::sample_value (x[k]) * gain;
+    if constexpr (std::is_same_v<To, double>) {
+      y[k] = v;
+    } else {
+      y[k] = static_cast<To> (v);
+    }
+  }
+}
+
+namespace details {
+
+/// Returns \p x clamped to the range [lo, hi]. Unlike std::clamp(), this works
+/// with values rather than references which allows it to be compiled to min/max
+/// instructions.
+constexpr double clamp (double const x, double const lo,
+                        double const hi) noexcept {
+  auto const t = x < lo ? lo : x;
+  return t > hi ? hi : t;
+}
+
+}  // end namespace details
+
+/// Converts samples to amplitude: out[i] = in[i] * gain clamped to the range
+/// [-1, +1] and rounded to the nearest amplitude value.
+///
+/// \tparam From  The input sample type: amplitude, double, or float.
+template <typename From>
+void convert (span<From const> const in, span<amplitude> const out,
+              double const gain = 1.0) noexcept {
+  assert (in.size () == out.size ());
+  constexpr auto scale =
+      static_cast<double> (uint32_t{1} << amplitude::fractional_bits);
+  auto const* const x = in.data ();
+  auto* const y = out.data ();
+  for (auto k = size_t{0}, n = std::min (in.size (), out.size ()); k < n; ++k) {
+    auto const v = details::clamp (details::sample_value (x[k]) * gain, -1.0,
+                                   1.0) *
+                   scale;
+    y[k] = amplitude::frombits (static_cast<uint32_t> (
+        static_cast<int32_t> (std::floor (v + 0.5))));
+  }
+}
+
+namespace details {
+
+/// Converts samples to \p Bits-bit integers. The integer for x is
+/// floor(x*(2^Bits-1)/2) so that [-1, +1] spans the full integer range.
+///
+/// \param in  The samples to be converted.
+/// \param gain  The gain applied to each sample before it's clamped.
+/// \param dither  Values (in LSBs) added to each scaled sample.
+/// \param out  The buffer to which the integers are written.
+template <unsigned Bits>
+inline void quantize (span<double const> const in, double const gain,
+                      double const* const dither,
+                      int32_t* const out) noexcept {
+  static_assert (Bits >= 8U && Bits <= 32U);
+  static constexpr auto scale =
+      static_cast<double> ((uint64_t{1} << Bits) - 1U) / 2.0;
+  auto const* const x = in.data ();
+  auto const n = in.size ();
+  auto k = size_t{0};
+  // The compiler won't vectorize the comparisons in clamp() so the vector
+  // versions are written out explicitly. They produce the same results as the
+  // scalar code.
+#if defined(__AVX512F__)
+  SYNTH_AVX512_BEGIN
+  {
+    __m512d const g = _mm512_set1_pd (gain);
+    __m512d const one = _mm512_set1_pd (1.0);
+    __m512d const minus_one = _mm512_set1_pd (-1.0);
+    __m512d const s = _mm512_set1_pd (scale);
+    __m512d const minus_s = _mm512_set1_pd (-scale);
+    for (; k + 8U <= n; k += 8U) {
+      __m512d v = _mm512_mul_pd (_mm512_loadu_pd (x + k), g);
+      v = _mm512_min_pd (_mm512_max_pd (v, minus_one), one);
+      v = _mm512_add_pd (_mm512_mul_pd (v, s), _mm512_loadu_pd (dither + k));
+      v = _mm512_min_pd (_mm512_max_pd (v, minus_s), s);
+      v = _mm512_roundscale_pd (v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+      _mm256_storeu_si256 (reinterpret_cast<__m256i*> (out + k),
+                           _mm512_cvttpd_epi32 (v));
+    }
+  }
+  SYNTH_AVX512_END
+#endif  // __AVX512F__
+#if defined(__AVX2__)
+  {
+    __m256d const g = _mm256_set1_pd (gain);
+    __m256d const one = _mm256_set1_pd (1.0);
+    __m256d const minus_one = _mm256_set1_pd (-1.0);
+    __m256d const s = _mm256_set1_pd (scale);
+    __m256d const minus_s = _mm256_set1_pd (-scale);
+    for (; k + 4U <= n; k += 4U) {
+      __m256d v = _mm256_mul_pd (_mm256_loadu_pd (x + k), g);
+      v = _mm256_min_pd (_mm256_max_pd (v, minus_one), one);
+      v = _mm256_add_pd (_mm256_mul_pd (v, s), _mm256_loadu_pd (dither + k));
+      v = _mm256_min_pd (_mm256_max_pd (v, minus_s), s);
+      _mm_storeu_si128 (reinterpret_cast<__m128i*> (out + k),
+                        _mm256_cvttpd_epi32 (_mm256_floor_pd (v)));
+    }
+  }
+#endif  // __AVX2__
+  for (; k < n; ++k) {
+    auto const v = clamp (x[k] * gain, -1.0, 1.0) * scale + dither[k];
+    out[k] = static_cast<int32_t> (std::floor (clamp (v, -scale, scale)));
+  }
+}
+
+/// Writes the \p Bits-bit integers from \p in to \p out as little-endian bytes.
+///
+/// \returns  A pointer one past the last byte written.
+template <unsigned Bits>
+uint8_t* pack (span<int32_t const> in, uint8_t* out) noexcept;
+
+template <>
+inline uint8_t* pack<16> (span<int32_t const> const in,
+                          uint8_t* const out) noexcept {
+  auto const* const x = in.data ();
+  auto const n = in.size ();
+  auto k = size_t{0};
+#if defined(__AVX2__)
+  if constexpr (little_endian) {
+    // The values are already in range so the saturation performed by
+    // packs_epi32 has no effect. It works within 128-bit lanes so a permute is
+    // needed to restore the order.
+    for (; k + 16U <= n; k += 16U) {
+      __m256i const packed = _mm256_packs_epi32 (
+          _mm256_loadu_si256 (reinterpret_cast<__m256i const*> (x + k)),
+          _mm256_loadu_si256 (reinterpret_cast<__m256i const*> (x + k + 8U)));
+      _mm256_storeu_si256 (reinterpret_cast<__m256i*> (out + 2U * k),
+                           _mm256_permute4x64_epi64 (packed, 0xD8));
+    }
+  }
+#endif  // __AVX2__
+  for (; k < n; ++k) {
+    auto const v = static_cast<uint16_t> (x[k]);
+    out[2U * k] = static_cast<uint8_t> (v);
+    out[2U * k + 1U] = static_cast<uint8_t> (v >> 8U);
+  }
+  return out + n * sizeof (int16_t);
+}
+
+template <>
+inline uint8_t* pack<24> (span<int32_t const> const in,
+                          uint8_t* const out) noexcept {
+  auto const* const x = in.data ();
+  auto const n = in.size ();
+  auto k = size_t{0};
+#if defined(__AVX2__)
+  if constexpr (little_endian) {
+    // Drop the top byte of each 32-bit value leaving 12 bytes in the low end
+    // of each 128-bit half of the register. Each half is written with a
+    // 16-byte store whose final 4 bytes are overwritten by the next store, so
+    // the loop stops while there are at least 8 more values to follow.
+    __m256i const shuffle = _mm256_setr_epi8 (
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,  //
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    for (; k + 16U <= n; k += 8U) {
+      __m256i const v = _mm256_shuffle_epi8 (
+          _mm256_loadu_si256 (reinterpret_cast<__m256i const*> (x + k)),
+          shuffle);
+      auto* const dest = out + 3U * k;
+      _mm_storeu_si128 (reinterpret_cast<__m128i*> (dest),
+                        _mm256_castsi256_si128 (v));
+      _mm_storeu_si128 (reinterpret_cast<__m128i*> (dest + 12),
+                        _mm256_extracti128_si256 (v, 1));
+    }
+  }
+#endif  // __AVX2__
+  for (; k < n; ++k) {
+    auto const v = static_cast<uint32_t> (x[k]);
+    out[3U * k] = static_cast<uint8_t> (v);
+    out[3U * k + 1U] = static_cast<uint8_t> (v >> 8U);
+    out[3U * k + 2U] = static_cast<uint8_t> (v >> 16U);
+  }
+  return out + 3U * n;
+}
+
+template <>
+inline uint8_t* pack<32> (span<int32_t const> const in,
+                          uint8_t* const out) noexcept {
+  auto const n = in.size ();
+  if constexpr (little_endian) {
+    std::memcpy (out, in.data (), n * sizeof (int32_t));
+  } else {
+    for (auto k = size_t{0}; k < n; ++k) {
+      auto const v = static_cast<uint32_t> (in[k]);
+      for (auto b = 0U; b < 4U; ++b) {
+        out[4U * k + b] = static_cast<uint8_t> (v >> (8U * b));
+      }
+    }
+  }
+  return out + n * sizeof (int32_t);
+}
+
+/// Reads \p Bits-bit little-endian signed integers from \p in into \p out.
+///
+/// \param in  The bytes to be read. There must be at least out.size()*Bits/8.
+/// \param out  The buffer to which the sign-extended integers are written.
+template <unsigned Bits>
+void unpack (uint8_t const* in, span<int32_t> out) noexcept;
+
+template <>
+inline void unpack<16> (uint8_t const* const in,
+                        span<int32_t> const out) noexcept {
+  auto* const y = out.data ();
+  auto const n = out.size ();
+  auto k = size_t{0};
+#if defined(__AVX2__)
+  if constexpr (little_endian) {
+    for (; k + 8U <= n; k += 8U) {
+      _mm256_storeu_si256 (
+          reinterpret_cast<__m256i*> (y + k),
+          _mm256_cvtepi16_epi32 (_mm_loadu_si128 (
+              reinterpret_cast<__m128i const*> (in + 2U * k))));
+    }
+  }
+#endif  // __AVX2__
+  for (; k < n; ++k) {
+    y[k] = static_cast<int16_t> (
+        static_cast<uint16_t> (in[2U * k] | in[2U * k + 1U] << 8U));
+  }
+}
+
+template <>
+inline void unpack<24> (uint8_t const* const in,
+                        span<int32_t> const out) noexcept {
+  auto* const y = out.data ();
+  auto const n = out.size ();
+  auto k = size_t{0};
+#if defined(__AVX2__)
+  if constexpr (little_endian) {
+    // Move each 3-byte value to the top of a 32-bit lane then shift it down to
+    // sign-extend it. Each 16-byte load reads 4 bytes beyond the 12 that it
+    // uses so the loop stops while there are at least 8 more values to follow.
+    __m256i const shuffle = _mm256_setr_epi8 (
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,  //
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    for (; k + 16U <= n; k += 8U) {
+      auto const* const src = in + 3U * k;
+      __m256i const v = _mm256_inserti128_si256 (
+          _mm256_castsi128_si256 (
+              _mm_loadu_si128 (reinterpret_cast<__m128i const*> (src))),
+          _mm_loadu_si128 (reinterpret_cast<__m128i const*> (src + 12)), 1);
+      _mm256_storeu_si256 (
+          reinterpret_cast<__m256i*> (y + k),
+          _mm256_srai_epi32 (_mm256_shuffle_epi8 (v, shuffle), 8));
+    }
+  }
+#endif  // __AVX2__
+  for (; k < n; ++k) {
+    auto const v = uint32_t{in[3U * k]} << 8U |
+                   uint32_t{in[3U * k + 1U]} << 16U |
+                   uint32_t{in[3U * k + 2U]} << 24U;
+    y[k] = static_cast<int32_t> (v) >> 8;
+  }
+}
+
+template <>
+inline void unpack<32> (uint8_t const* const in,
+                        span<int32_t> const out) noexcept {
+  auto const n = out.size ();
+  if constexpr (little_endian) {
+    std::memcpy (out.data (), in, n * sizeof (int32_t));
+  } else {
+    for (auto k = size_t{0}; k < n; ++k) {
+      auto v = uint32_t{0};
+      for (auto b = 0U; b < 4U; ++b) {
+        v |= uint32_t{in[4U * k + b]} << (8U * b);
+      }
+      out[k] = static_cast<int32_t> (v);
+    }
+  }
+}
+
+}  // end namespace details
+
+/// Converts samples to \p Bits-bit little-endian signed integers.
+///
+/// \tparam Bits  The number of bits in each output value: 16, 24, or 32.
+/// \tparam T  The input sample type: amplitude, double, or float.
+/// \param in  The samples to be converted.
+/// \param out  The buffer to which the samples are written. Must be at least
+///   in.size()*Bits/8 bytes.
+/// \param gain  The gain applied to each sample before it is clamped to the
+///   range [-1, +1].
+/// \param dither  If not null, dither added to each sample.
+/// \returns  A pointer one past the last byte written.
+template <unsigned Bits, typename T>
+uint8_t* to_pcm (span<T const> in, span<uint8_t> const out,
+                 double const gain = 1.0,
+                 tpdf_dither* const dither = nullptr) noexcept {
+  static_assert (Bits == 16U || Bits == 24U || Bits == 32U);
+  assert (out.size () >= in.size () * (Bits / 8U));
+  constexpr auto block_size = details::convert_block_size;
+  std::array<double, block_size> d{};
+  std::array<double, block_size> x;
+  std::array<int32_t, block_size> v;
+  auto* dest = out.data ();
+  while (!in.empty ()) {
+    auto const n = std::min (in.size (), block_size);
+    if (dither != nullptr) {
+      dither->fill (span<double>{d.data (), n});
+    }
+    if constexpr (std::is_same_v<T, double>) {
+      details::quantize<Bits> (in.subspan (0U, n), gain, d.data (), v.data ());
+    } else {
+      // Widen the samples to double applying the gain along the way.
+      convert (in.subspan (0U, n), span<double>{x.data (), n}, gain);
+      details::quantize<Bits> (span<double const>{x.data (), n}, 1.0, d.data (),
+                               v.data ());
+    }
+    dest = details::pack<Bits> (span<int32_t const>{v.data (), n}, dest);
+    in = in.subspan (n);
+  }
+  return dest;
+}
+
+/// Converts samples to little-endian 32-bit IEEE floating point. The samples
+/// are not clamped.
+///
+/// \tparam T  The input sample type: amplitude, double, or float.
+/// \param in  The samples to be converted.
+/// \param out  The buffer to which the samples are written. Must be at least
+///   in.size()*4 bytes.
+/// \param gain  The gain applied to each sample.
+/// \returns  A pointer one past the last byte written.
+template <typename T>
+uint8_t* to_float32 (span<T const> in, span<uint8_t> const out,
+                     float const gain = 1.0F) noexcept {
+  static_assert (sizeof (float) == sizeof (uint32_t));
+  assert (out.size () >= in.size () * sizeof (float));
+  constexpr auto block_size = details::convert_block_size;
+  std::array<float, block_size> f;
+  std::array<int32_t, block_size> bits;
+  auto* dest = out.data ();
+  while (!in.empty ()) {
+    auto const n = std::min (in.size (), block_size);
+    convert (in.subspan (0U, n), span<float>{f.data (), n}, gain);
+    std::memcpy (bits.data (), f.data (), n * sizeof (float));
+    dest = details::pack<32> (span<int32_t const>{bits.data (), n}, dest);
+    in = in.subspan (n);
+  }
+  return dest;
+}
+
+/// Converts \p Bits-bit little-endian signed integers to samples. The integer
+/// v becomes v/2^(Bits-1) so that the full integer range spans [-1, +1).
+///
+/// \tparam Bits  The number of bits in each input value: 16, 24, or 32.
+/// \tparam T  The output sample type: amplitude, double, or float.
+/// \param in  The bytes to be converted. Must be at least out.size()*Bits/8
+///   bytes.
+/// \param out  The buffer to which the samples are written.
+/// \param gain  The gain applied to each sample. Amplitude output is then
+///   clamped to the range [-1, +1].
+template <unsigned Bits, typename T>
+void from_pcm (span<uint8_t const> const in, span<T> out,
+               double const gain = 1.0) noexcept {
+  static_assert (Bits == 16U || Bits == 24U || Bits == 32U);
+  assert (in.size () >= out.size () * (Bits / 8U));
+  constexpr auto block_size = details::convert_block_size;
+  auto const scale = gain / static_cast<double> (uint32_t{1} << (Bits - 1U));
+  std::array<int32_t, block_size> v;
+  std::array<double, block_size> x;
+  auto const* src = in.data ();
+  while (!out.empty ()) {
+    auto const n = std::min (out.size (), block_size);
+    details::unpack<Bits> (src, span<int32_t>{v.data (), n});
+    auto const widen = [&v, scale, n] (double* const NONNULL dest) {
+      for (auto k = size_t{0}; k < n; ++k) {
+        dest[k] = static_cast<double> (v[k]) * scale;
+      }
+    };
+    if constexpr (std::is_same_v<T, double>) {
+      widen (out.data ());
+    } else {
+      widen (x.data ());
+      convert (span<double const>{x.data (), n}, out.first (n));
+    }
+    src += n * (Bits / 8U);
+    out = out.subspan (n);
+  }
+}
+
+/// Converts little-endian 32-bit IEEE floating point values to samples.
+///
+/// \tparam T  The output sample type: amplitude, double, or float.
+/// \param in  The bytes to be converted. Must be at least out.size()*4 bytes.
+/// \param out  The buffer to which the samples are written.
+/// \param gain  The gain applied to each sample. Amplitude output is then
+///   clamped to the range [-1, +1].
+template <typename T>
+void from_float32 (span<uint8_t const> const in, span<T> out,
+                   double const gain = 1.0) noexcept {
+  static_assert (sizeof (float) == sizeof (uint32_t));
+  assert (in.size () >= out.size () * sizeof (float));
+  constexpr auto block_size = details::convert_block_size;
+  std::array<int32_t, block_size> bits;
+  std::array<float, block_size> f;
+  auto const* src = in.data ();
+  while (!out.empty ()) {
+    auto const n = std::min (out.size (), block_size);
+    details::unpack<32> (src, span<int32_t>{bits.data (), n});
+    std::memcpy (f.data (), bits.data (), n * sizeof (float));
+    if constexpr (std::is_same_v<T, amplitude>) {
+      convert (span<float const>{f.data (), n}, out.first (n), gain);
+    } else {
+      convert (span<float const>{f.data (), n}, out.first (n),
+               static_cast<T> (gain));
+    }
+    src += n * sizeof (float);
+    out = out.subspan (n);
+  }
+}
+
+}  // end namespace synth
+
+#endif  // SYNTH_CONVERT_HPP
@@ -0,0 +1,138 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_ENGINE_HPP
+#define SYNTH_ENGINE_HPP
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <memory>
+
+#include "synth/envelope.hpp"
+#include "synth/mipmap_wavetable.hpp"
+#include "synth/span.hpp"
+#include "synth/thread_pool.hpp"
+#include "synth/voice_assigner.hpp"
+#include "synth/wavetable.hpp"
+
+namespace synth {
+
+/// The sample rates for which make_engine() can create an engine.
+constexpr std::array<unsigned, 5> engine_sample_rates{
+    {44100U, 48000U, 88200U, 96000U, 192000U}};
+
+/// A set of voices whose sample rate is chosen at run time.
+///
+/// The sample rate is a template parameter of the oscillators, envelopes and
+/// voices so that the per-sample arithmetic uses constants. This interface
+/// allows a host which learns the rate of its output device only once it is
+/// running to use them: make_engine() returns an instance of engine_instance
+/// specialized for the rate. The cost of the run-time selection is a single
+/// virtual call per block.
+template <typename Traits, size_t Polyphony = 8>
+class engine {
+public:
+  static constexpr auto polyphony = Polyphony;
+
+  engine () noexcept = default;
+  engine (engine const &) = delete;
+  engine (engine &&) noexcept = delete;
+  virtual ~engine () noexcept = default;
+
+  engine &operator= (engine const &) = delete;
+  engine &operator= (engine &&) noexcept = delete;
+
+  /// The sample rate in Hertz.
+  virtual unsigned sample_rate () const noexcept = 0;
+
+  virtual void note_on (unsigned note) = 0;
+  virtual void note_off (unsigned note) = 0;
+
+  /// Fills the buffer \p out with the mixed output of all of the voices.
+  virtual void render (span<double> out) = 0;
+  /// Fills the buffer \p out with the mixed output of all of the voices
+  /// saturated to the range [-1, 1]. Only integer arithmetic is used.
+  virtual void render (span<amplitude> out) = 0;
+
+  virtual void set_wavetable (wavetable<Traits> const *w) = 0;
+  virtual void set_wavetable (mipmap_wavetable<Traits> const *w) = 0;
+  virtual void set_envelope (envelope_phase stage, double value) = 0;
+  virtual void set_steal_policy (steal_policy p) noexcept = 0;
+  virtual void set_thread_pool (thread_pool *pool) noexcept = 0;
+
+  virtual std::bitset<Polyphony> active_voices () const = 0;
+};
+
+/// The implementation of the engine interface for a sample rate known at
+/// compile time. Each member function forwards to a voice_assigner.
+template <unsigned SampleRate, typename Traits, size_t Polyphony = 8>
+class engine_instance final : public engine<Traits, Polyphony> {
+public:
+  using voices_type = voice_assigner<SampleRate, Traits, Polyphony>;
+
+  unsigned sample_rate () const noexcept override { return SampleRate; }
+
+  void note_on (unsigned const note) override { voices_.note_on (note); }
+  void note_off (unsigned const note) override { voices_.note_off (note); }
+
+  void render (span<double> const out) override { voices_.render (out); }
+  void render (span<amplitude> const out) override { voices_.render (out); }
+
+  void set_wavetable (wavetable<Traits> const *const w) override {
+    voices_.set_wavetable (w);
+  }
+  void set_wavetable (mipmap_wavetable<Traits> const *const w) override {
+    voices_.set_wavetable (w);
+  }
+  void set_envelope (envelope_phase const stage, double const value) override {
+    voices_.set_envelope (stage, value);
+  }
+  void set_steal_policy (steal_policy const p) noexcept override {
+    voices_.set_steal_policy (p);
+  }
+  void set_thread_pool (thread_pool *const pool) noexcept override {
+    voices_.set_thread_pool (pool);
+  }
+
+  std::bitset<Polyphony> active_voices () const override {
+    return voices_.active_voices ();
+  }
+
+  /// The voices, for the use of settings not forwarded by this class.
+  voices_type &voices () noexcept { return voices_; }
+
+private:
+  voices_type voices_;
+};
+
+namespace details {
+
+template <typename Traits, size_t Polyphony, size_t Index>
+std::unique_ptr<engine<Traits, Polyphony>> make_engine (
+    [[maybe_unused]] unsigned const sample_rate) {
+  if constexpr (Index == engine_sample_rates.size ()) {
+    return nullptr;
+  } else {
+    constexpr auto rate = engine_sample_rates[Index];
+    if (sample_rate == rate) {
+      return std::make_unique<engine_instance<rate, Traits, Polyphony>> ();
+    }
+    return make_engine<Traits, Polyphony, Index + 1U> (sample_rate);
+  }
+}
+
+}  // end namespace details
+
+/// Creates an engine for the given sample rate.
+///
+/// \param sample_rate  The sample rate in Hertz.
+/// \returns  The new engine or null if \p sample_rate is not one of
+///   #engine_sample_rates.
+template <typename Traits, size_t Polyphony = 8>
+std::unique_ptr<engine<Traits, Polyphony>> make_engine (
+    unsigned const sample_rate) {
+  return details::make_engine<Traits, Polyphony, 0U> (sample_rate);
+}
+
+}  // end namespace synth
+
+#endif  // SYNTH_ENGINE_HPP
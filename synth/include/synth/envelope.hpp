@@ -2,44 +2,86 @@
 #ifndef SYNTH_ENVELOPE_HPP
 #define SYNTH_ENVELOPE_HPP
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <type_traits>
 
 #include "synth/nco.hpp"
+#include "synth/span.hpp"
 
 namespace synth {
 
+/// The phases of an envelope. The bottom bit is set for the time-based phases
+/// (attack, decay, and release). The enumeration does not depend on the sample
+/// rate so that it may be used by code which selects the rate at run time.
+enum class envelope_phase : uint8_t {
+  idle = 0b000,
+  attack = 0b001,
+  decay = 0b011,
+  sustain = 0b010,
+  release = 0b101,
+  quench = 0b111,
+};
+
 template <unsigned SampleRate>
 class envelope {
 public:
   void note_on ();
   void note_off ();
+  /// Fades the envelope to silence over quench_time. This silences a voice
+  /// quickly, without the click of an abrupt stop, so that it can be reused.
+  void quench ();
   bool active () const;
 
   // Set the bottom bit for time-based envelope phases (i.e. ADR).
   static constexpr auto timed_phase_mask = uint8_t{0b001};
-  enum class phase : uint8_t {
-    idle = 0b000,
-    attack = 0b000 | timed_phase_mask,
-    decay = 0b010 | timed_phase_mask,
-    sustain = 0b010,
-    release = 0b100 | timed_phase_mask,
-  };
+  using phase = envelope_phase;
   static char const* NONNULL phase_name (phase p) noexcept;
 
   void set (phase p, double v);
 
-  amplitude tick (amplitude v);
+  /// The envelope level and the per-sample rates of change are unsigned
+  /// fixed-point values in the range [0, 1] so that the rendering path needs
+  /// only integer arithmetic.
+  using level_type = ufixed<32, 2>;
+  /// The current envelope level.
+  level_type level () const noexcept { return level_; }
+
+  /// The time taken by quench() to fade from full level to silence.
+  static constexpr auto quench_time = 0.002;  // seconds
+  /// The level below which a release or quench is treated as silent: the
+  /// envelope becomes idle (and its voice can be freed) as soon as it is
+  /// reached rather than when the level is exactly zero. This is -96dB, below
+  /// the resolution of 16-bit output.
+  static constexpr auto silence = 1.0 / 65536.0;
+
+  amplitude tick (amplitude v) {
+    this->render (span<amplitude>{&v, 1U});
+    return v;
+  }
+  /// Applies the envelope to each of the samples in \p buffer in place.
+  void render (span<amplitude> buffer);
 
 private:
-  double attack_ = 0.0;
-  double decay_ = 0.0;
-  double sustain_ = 1.0;
-  double release_ = 0.0;
+  static constexpr auto zero_ = level_type::fromint (0U);
+  static constexpr auto one_ = level_type::fromint (1U);
+  static constexpr auto quench_ =
+      level_type::fromfp (1.0 / (quench_time * SampleRate));
+  static constexpr auto silence_ = level_type::fromfp (silence);
+
+  level_type attack_ = zero_;
+  level_type decay_ = zero_;
+  level_type sustain_ = one_;
+  level_type release_ = zero_;
 
   phase phase_ = phase::idle;
-  amplitude a_;
+  level_type level_ = zero_;
+
+  /// Returns the sample \p v scaled by the envelope level \p l.
+  static constexpr amplitude scale (amplitude const v, level_type const l) {
+    return mul_round<amplitude> (v, l);
+  }
 
   static unsigned time (double seconds) {
     return static_cast<unsigned> (std::round (SampleRate * seconds));
@@ -60,6 +102,15 @@ void envelope<SampleRate>::note_off () {
   phase_ = phase::release;
 }
 
+// quench
+// ~~~~~~
+template <unsigned SampleRate>
+void envelope<SampleRate>::quench () {
+  if (phase_ != phase::idle) {
+    phase_ = phase::quench;
+  }
+}
+
 // active
 // ~~~~~~
 template <unsigned SampleRate>
@@ -77,12 +128,14 @@ void envelope<SampleRate>::set (phase p, double v) {
     v = v < 1.0 / SampleRate ? 0.0 : 1.0 / (v * SampleRate);
   }
   assert (v <= 1.0);
+  auto const l = level_type::fromfp (std::min (v, 1.0));
   switch (p) {
   case phase::idle: break;
-  case phase::attack: attack_ = v; break;
-  case phase::decay: decay_ = v; break;
-  case phase::sustain: sustain_ = std::min (v, 1.0); break;
-  case phase::release: release_ = v; break;
+  case phase::attack: attack_ = l; break;
+  case phase::decay: decay_ = l; break;
+  case phase::sustain: sustain_ = l; break;
+  case phase::release: release_ = l; break;
+  case phase::quench: break;  // The quench rate is fixed.
   }
 }
 
@@ -96,60 +149,89 @@ char const* NONNULL envelope<SampleRate>::phase_name (phase const p) noexcept {
   case phase::attack: return "attack";
   case phase::decay: return "decay";
   case phase::release: return "release";
+  case phase::quench: return "quench";
   }
   return "";
 }
 
-// tick
-// ~~~~
+// render
+// ~~~~~~
 template <unsigned SampleRate>
-auto envelope<SampleRate>::tick (amplitude const v) -> amplitude {
-  auto delta = 0.0;
-
-  switch (phase_) {
-  case phase::attack:
-    assert (attack_ >= 0.0);
-    if (attack_ == 0.0) {
-      a_ = amplitude::fromfp (1.0);
-    } else if (a_.as_double () < 1.0) {
+void envelope<SampleRate>::render (span<amplitude> const buffer) {
+  auto* first = buffer.begin ();
+  auto* const last = buffer.end ();
+  // Work on a local copy of the level so that the compiler is free to keep it
+  // in a register.
+  auto level = level_;
+  while (first != last) {
+    switch (phase_) {
+    case phase::attack:
+      if (attack_.is_zero ()) {
+        level = one_;
+      }
       // Increase the amplitude at the attack_ rate.
-      delta = attack_;
-      break;
-    }
-    phase_ = phase::decay;
-    [[fallthrough]];
-  case phase::decay:
-    assert (decay_ >= 0.0);
-    if (decay_ == 0.0) {
-      a_ = amplitude::fromfp (sustain_);
-    } else if (a_.as_double () > sustain_) {
+      for (; first != last && level < one_; ++first) {
+        level = std::min (add_sat (level, attack_), one_);
+        *first = scale (*first, level);
+      }
+      if (level < one_) {
+        break;  // We reached the end of the buffer.
+      }
+      phase_ = phase::decay;
+      [[fallthrough]];
+    case phase::decay:
+      if (decay_.is_zero ()) {
+        level = sustain_;
+      }
       // Allow the amplitude to drop to the sustain level at the rate set by
       // decay_.
-      delta = -decay_;
+      for (; first != last && level > sustain_; ++first) {
+        level = std::max (sub_sat (level, decay_), sustain_);
+        *first = scale (*first, level);
+      }
+      if (level > sustain_) {
+        break;  // We reached the end of the buffer.
+      }
+      phase_ = phase::sustain;
+      [[fallthrough]];
+    case phase::sustain:
+      // Sustain is a fixed amplitude.
+      for (; first != last; ++first) {
+        *first = scale (*first, sustain_);
+      }
       break;
-    }
-    phase_ = phase::sustain;
-    [[fallthrough]];
-  case phase::sustain:
-    // Sustain is a fixed amplitude.
-    assert (sustain_ >= 0.0 && sustain_ <= 1.0);
-    return amplitude::fromfp (v.as_double () * sustain_);
-  case phase::release:
-    assert (release_ >= 0.0);
-    if (release_ == 0.0) {
-      a_ = amplitude::fromfp (0.0);
-    } else if (a_.as_double () > 0.0) {
-      delta = -release_;
+    case phase::release:
+      if (release_.is_zero ()) {
+        level = zero_;
+      }
+      for (; first != last && level > silence_; ++first) {
+        level = sub_sat (level, release_);
+        *first = scale (*first, level);
+      }
+      if (level > silence_) {
+        break;  // We reached the end of the buffer.
+      }
+      level = zero_;
+      phase_ = phase::idle;
+      break;
+    case phase::quench:
+      for (; first != last && level > silence_; ++first) {
+        level = sub_sat (level, quench_);
+        *first = scale (*first, level);
+      }
+      if (level > silence_) {
+        break;  // We reached the end of the buffer.
+      }
+      level = zero_;
+      phase_ = phase::idle;
+      break;
+    case phase::idle:
+      std::fill (first, last, amplitude{});
+      first = last;
       break;
     }
-    phase_ = phase::idle;
-    [[fallthrough]];
-  case phase::idle: return amplitude::fromfp (0.0);
   }
-  // If this addition could saturate to 1s for overflow or 0s for underflow, the
-  // special cases for 0 in the above switch could be removed.
-  a_ = amplitude::fromfp (a_.as_double () + delta);
-  return amplitude::fromfp (v.as_double () * a_.as_double ());
+  level_ = level;
 }
 
 }  // end namespace synth
@@ -0,0 +1,153 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_EVENT_HPP
+#define SYNTH_EVENT_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "synth/envelope.hpp"
+#include "synth/mipmap_wavetable.hpp"
+#include "synth/span.hpp"
+#include "synth/spsc_queue.hpp"
+#include "synth/voice_assigner.hpp"
+#include "synth/wavetable.hpp"
+
+namespace synth {
+
+/// A change to the state of a voice_assigner which is sent from a control
+/// thread to the audio thread.
+template <unsigned SampleRate, typename Traits>
+struct event {
+  enum class kind : uint8_t {
+    note_on,
+    note_off,
+    set_wavetable,
+    set_mipmap_wavetable,
+    set_envelope,
+  };
+  using phase = typename envelope<SampleRate>::phase;
+
+  kind what = kind::note_off;
+  /// The position of the event in samples from the start of the block in which
+  /// it is rendered.
+  uint32_t offset = 0;
+  /// The note number (note_on and note_off).
+  unsigned note = 0;
+  /// The envelope stage and its new value (set_envelope).
+  phase stage = phase::idle;
+  double value = 0.0;
+  /// The new wavetable (set_wavetable and set_mipmap_wavetable).
+  wavetable<Traits> const* table = nullptr;
+  mipmap_wavetable<Traits> const* mipmap = nullptr;
+
+  static constexpr event make_note_on (unsigned const n,
+                                       uint32_t const at = 0U) noexcept {
+    event e;
+    e.what = kind::note_on;
+    e.offset = at;
+    e.note = n;
+    return e;
+  }
+  static constexpr event make_note_off (unsigned const n,
+                                        uint32_t const at = 0U) noexcept {
+    event e;
+    e.what = kind::note_off;
+    e.offset = at;
+    e.note = n;
+    return e;
+  }
+  static constexpr event make_wavetable (
+      wavetable<Traits> const* NONNULL const w,
+      uint32_t const at = 0U) noexcept {
+    event e;
+    e.what = kind::set_wavetable;
+    e.offset = at;
+    e.table = w;
+    return e;
+  }
+  static constexpr event make_wavetable (
+      mipmap_wavetable<Traits> const* NONNULL const w,
+      uint32_t const at = 0U) noexcept {
+    event e;
+    e.what = kind::set_mipmap_wavetable;
+    e.offset = at;
+    e.mipmap = w;
+    return e;
+  }
+  static constexpr event make_envelope (phase const p, double const v,
+                                        uint32_t const at = 0U) noexcept {
+    event e;
+    e.what = kind::set_envelope;
+    e.offset = at;
+    e.stage = p;
+    e.value = v;
+    return e;
+  }
+};
+
+/// The queue which carries events to the audio thread.
+template <unsigned SampleRate, typename Traits, size_t Capacity = 256>
+using event_queue = spsc_queue<event<SampleRate, Traits>, Capacity>;
+
+/// Applies the event \p e to \p voices.
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void apply (event<SampleRate, Traits> const& e,
+            voice_assigner<SampleRate, Traits, Polyphony>& voices) {
+  using kind = typename event<SampleRate, Traits>::kind;
+  switch (e.what) {
+  case kind::note_on: voices.note_on (e.note); break;
+  case kind::note_off: voices.note_off (e.note); break;
+  case kind::set_wavetable: voices.set_wavetable (e.table); break;
+  case kind::set_mipmap_wavetable: voices.set_wavetable (e.mipmap); break;
+  case kind::set_envelope: voices.set_envelope (e.stage, e.value); break;
+  }
+}
+
+/// Renders a block of output from \p voices, applying each of \p events at the
+/// sample given by its offset. The block is split only where an event falls so
+/// that each of the sub-blocks is rendered in a single call; a block without
+/// events is rendered in one piece. Events whose offset is at or beyond the end
+/// of the block are applied after its last sample.
+///
+/// \param voices  The voices to be rendered.
+/// \param events  The events to be applied, sorted by offset.
+/// \param out  The buffer to be filled: either double or amplitude samples.
+template <unsigned SampleRate, typename Traits, size_t Polyphony,
+          typename Sample>
+void render (voice_assigner<SampleRate, Traits, Polyphony>& voices,
+             span<event<SampleRate, Traits> const> const events,
+             span<Sample> const out) {
+  auto pos = size_t{0};
+  for (auto const& e : events) {
+    auto const offset = std::min (size_t{e.offset}, out.size ());
+    assert (offset >= pos && "events must be sorted by offset");
+    if (offset > pos) {
+      voices.render (out.subspan (pos, offset - pos));
+      pos = offset;
+    }
+    apply (e, voices);
+  }
+  if (pos < out.size ()) {
+    voices.render (out.subspan (pos));
+  }
+}
+
+/// Applies all of the events waiting in \p queue to \p voices, ignoring their
+/// offsets. This is called by the audio thread at the start of each block and
+/// never waits.
+///
+/// \returns  The number of events applied.
+template <unsigned SampleRate, typename Traits, size_t Capacity,
+          size_t Polyphony>
+size_t apply_events (event_queue<SampleRate, Traits, Capacity>& queue,
+                     voice_assigner<SampleRate, Traits, Polyphony>& voices) {
+  return queue.drain ([&voices] (event<SampleRate, Traits> const& e) {
+    apply (e, voices);
+  });
+}
+
+}  // end namespace synth
+
+#endif  // SYNTH_EVENT_HPP
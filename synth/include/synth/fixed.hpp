@@ -25,6 +25,21 @@ struct mask<0U> {
 template <unsigned Bits>
 inline constexpr auto mask_v = mask<Bits>::value;
 
+namespace details {
+
+/// A constexpr equivalent of std::round(): rounds \p x to the nearest integer,
+/// rounding halfway cases away from zero. |x| must be less than 2^63.
+constexpr sinteger_t<64> round (double const x) noexcept {
+  if (x < 0.0) {
+    return -round (-x);
+  }
+  auto const t = static_cast<sinteger_t<64>> (x);
+  // x-t is exact because t <= x < t+1.
+  return x - static_cast<double> (t) >= 0.5 ? t + 1 : t;
+}
+
+}  // end namespace details
+
 template <unsigned TotalBits, unsigned IntegralBits,
           typename = typename std::enable_if_t<TotalBits >= IntegralBits>>
 class fixed {
@@ -37,9 +52,9 @@ public:
   constexpr fixed () = default;
 
   static constexpr decltype (auto) fromfp (double const x) {
-    assert (std::isfinite (x) &&
-            std::abs (x) < (uinteger_t<integral_bits + 1>{1} << integral_bits));
-    return fixed{static_cast<value_type> (std::round (x * mul_))};
+    // (This test also rejects infinities and NaN.)
+    assert (x > -limit_ && x < limit_);
+    return fixed{static_cast<value_type> (details::round (x * mul_))};
   }
   static constexpr fixed frombits (uinteger_t<total_bits> const bits) {
     return fixed{static_cast<value_type> (bits)};
@@ -59,8 +74,25 @@ public:
         static_cast<value_type> (fractional & mask_v<fractional_bits>)};
   }
 
+  /// Returns the largest value representable by this type.
+  static constexpr fixed max () noexcept {
+    return fixed{static_cast<value_type> (mask_v<total_bits - 1U>)};
+  }
+  /// Returns the smallest (most negative) value representable by this type.
+  static constexpr fixed min () noexcept {
+    return fixed{static_cast<value_type> (-max ().x_ - 1)};
+  }
+
   constexpr bool operator== (fixed other) const { return x_ == other.x_; }
   constexpr bool operator!= (fixed other) const { return !operator== (other); }
+  constexpr bool operator< (fixed const other) const { return x_ < other.x_; }
+  constexpr bool operator<= (fixed const other) const {
+    return x_ <= other.x_;
+  }
+  constexpr bool operator> (fixed const other) const { return x_ > other.x_; }
+  constexpr bool operator>= (fixed const other) const {
+    return x_ >= other.x_;
+  }
 
   constexpr double as_double () const { return x_ / mul_; }
   constexpr decltype (auto) integral_part () const {
@@ -69,8 +101,18 @@ public:
   constexpr uinteger_t<fractional_bits> fractional_part () const {
     return x_ & mask_v<fractional_bits>;
   }
+  /// Addition. The result is not wrapped or saturated: use add_wrap() or
+  /// add_sat() if the sum may not be representable.
   constexpr fixed operator+ (fixed const other) const {
-    return fixed{x_ + other.x_};
+    return fixed{static_cast<value_type> (x_ + other.x_)};
+  }
+  /// Subtraction. The result is not wrapped or saturated: use sub_wrap() or
+  /// sub_sat() if the difference may not be representable.
+  constexpr fixed operator- (fixed const other) const {
+    return fixed{static_cast<value_type> (x_ - other.x_)};
+  }
+  constexpr fixed operator- () const {
+    return fixed{static_cast<value_type> (-x_)};
   }
   constexpr fixed operator>> (unsigned const shift) const {
     return fixed{x_ >> shift};
@@ -87,6 +129,8 @@ private:
   value_type x_ = 0;
   static constexpr auto mul_ = static_cast<double> (
       uinteger_t<fractional_bits + 1>{1} << fractional_bits);
+  static constexpr auto limit_ = static_cast<double> (
+      uinteger_t<integral_bits + 1>{1} << integral_bits);
 };
 
 template <unsigned IntegralBits, unsigned FractionalBits>
@@ -154,6 +198,12 @@ public:
 
   constexpr bool operator== (ufixed other) const { return x_ == other.x_; }
   constexpr bool operator!= (ufixed other) const { return !operator== (other); }
+  constexpr bool operator< (ufixed const other) const {
+    return x_ < other.x_;
+  }
+  constexpr bool operator<= (ufixed const other) const {
+    return x_ <= other.x_;
+  }
   constexpr bool operator> (ufixed const other) const {
     return x_ > other.x_;
   }
@@ -161,6 +211,13 @@ public:
     return x_ >= other.x_;
   }
 
+  /// Returns the largest value representable by this type.
+  static constexpr ufixed max () noexcept {
+    return ufixed{static_cast<value_type> (mask_v<total_bits>)};
+  }
+  /// Returns the smallest value representable by this type (zero).
+  static constexpr ufixed min () noexcept { return ufixed{}; }
+
   constexpr explicit operator double () const {
     return x_ / mul_;
   }
@@ -249,6 +306,179 @@ constexpr decltype (auto) operator* (ufixed<LhsWL, LhsIWL> const lhs,
       static_cast<typename result_type::value_type> (lhs.get ()) * rhs.get ());
 }
 
+namespace details {
+
+/// Shifts \p v right by \p Shift bits, rounding the result to nearest (ties
+/// are rounded towards +infinity). If \p Shift is negative, the value is
+/// shifted left.
+template <int Shift, typename T>
+constexpr T shift_round (T const v) {
+  if constexpr (Shift > 0) {
+    return static_cast<T> ((v + (T{1} << (Shift - 1))) >> Shift);
+  } else {
+    return static_cast<T> (v * (T{1} << -Shift));
+  }
+}
+
+/// Converts the signed value \p v to a signed value of \p Bits bits, wrapping
+/// on overflow.
+template <unsigned Bits, typename T>
+constexpr sinteger_t<Bits> wrap_signed (T const v) {
+  using utype = uinteger_t<64>;
+  constexpr auto sign = utype{1} << (Bits - 1U);
+  auto const u = static_cast<utype> (v) & mask_v<Bits>;
+  return static_cast<sinteger_t<Bits>> (
+      static_cast<sinteger_t<64>> ((u ^ sign) - sign));
+}
+
+/// Clamps the signed value \p v to the range of a signed value of \p Bits
+/// bits.
+template <unsigned Bits, typename T>
+constexpr sinteger_t<Bits> saturate_signed (T const v) {
+  constexpr auto max = static_cast<T> (mask_v<Bits - 1U>);
+  constexpr auto min = static_cast<T> (-max - 1);
+  return static_cast<sinteger_t<Bits>> (v > max ? max : (v < min ? min : v));
+}
+
+}  // end namespace details
+
+// Wrapping and saturating arithmetic
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// These functions produce a result of the same type as their arguments. The
+// "wrap" variants discard any carry/borrow out of the most significant bit
+// (modulo arithmetic, as wanted by a phase accumulator); the "sat" variants
+// clamp the result to the type's representable range (as wanted when mixing
+// audio).
+
+template <unsigned TotalBits, unsigned IntegralBits>
+constexpr fixed<TotalBits, IntegralBits> add_wrap (
+    fixed<TotalBits, IntegralBits> const lhs,
+    fixed<TotalBits, IntegralBits> const rhs) {
+  return fixed<TotalBits, IntegralBits>::frombits (
+      static_cast<uinteger_t<TotalBits>> (details::wrap_signed<TotalBits> (
+          sinteger_t<64>{lhs.get ()} + rhs.get ())));
+}
+template <unsigned TotalBits, unsigned IntegralBits>
+constexpr fixed<TotalBits, IntegralBits> sub_wrap (
+    fixed<TotalBits, IntegralBits> const lhs,
+    fixed<TotalBits, IntegralBits> const rhs) {
+  return fixed<TotalBits, IntegralBits>::frombits (
+      static_cast<uinteger_t<TotalBits>> (details::wrap_signed<TotalBits> (
+          sinteger_t<64>{lhs.get ()} - rhs.get ())));
+}
+template <unsigned TotalBits, unsigned IntegralBits>
+constexpr fixed<TotalBits, IntegralBits> add_sat (
+    fixed<TotalBits, IntegralBits> const lhs,
+    fixed<TotalBits, IntegralBits> const rhs) {
+  static_assert (TotalBits < 64U);
+  return fixed<TotalBits, IntegralBits>::frombits (
+      static_cast<uinteger_t<TotalBits>> (details::saturate_signed<TotalBits> (
+          sinteger_t<TotalBits + 1U>{lhs.get ()} + rhs.get ())));
+}
+template <unsigned TotalBits, unsigned IntegralBits>
+constexpr fixed<TotalBits, IntegralBits> sub_sat (
+    fixed<TotalBits, IntegralBits> const lhs,
+    fixed<TotalBits, IntegralBits> const rhs) {
+  static_assert (TotalBits < 64U);
+  return fixed<TotalBits, IntegralBits>::frombits (
+      static_cast<uinteger_t<TotalBits>> (details::saturate_signed<TotalBits> (
+          sinteger_t<TotalBits + 1U>{lhs.get ()} - rhs.get ())));
+}
+
+template <size_t WL, size_t IWL>
+constexpr ufixed<WL, IWL> add_wrap (ufixed<WL, IWL> const lhs,
+                                    ufixed<WL, IWL> const rhs) {
+  using value_type = typename ufixed<WL, IWL>::value_type;
+  return ufixed<WL, IWL>::frombits (
+      static_cast<value_type> ((lhs.get () + rhs.get ()) & mask_v<WL>));
+}
+template <size_t WL, size_t IWL>
+constexpr ufixed<WL, IWL> sub_wrap (ufixed<WL, IWL> const lhs,
+                                    ufixed<WL, IWL> const rhs) {
+  using value_type = typename ufixed<WL, IWL>::value_type;
+  return ufixed<WL, IWL>::frombits (
+      static_cast<value_type> ((lhs.get () - rhs.get ()) & mask_v<WL>));
+}
+template <size_t WL, size_t IWL>
+constexpr ufixed<WL, IWL> add_sat (ufixed<WL, IWL> const lhs,
+                                   ufixed<WL, IWL> const rhs) {
+  using value_type = typename ufixed<WL, IWL>::value_type;
+  auto const sum = static_cast<value_type> (lhs.get () + rhs.get ());
+  // Overflow either carries out of value_type (so the sum is smaller than
+  // either argument) or past bit WL.
+  return (sum < lhs.get () || sum > mask_v<WL>) ? ufixed<WL, IWL>::max ()
+                                                 : ufixed<WL, IWL>::frombits (sum);
+}
+template <size_t WL, size_t IWL>
+constexpr ufixed<WL, IWL> sub_sat (ufixed<WL, IWL> const lhs,
+                                   ufixed<WL, IWL> const rhs) {
+  return lhs < rhs ? ufixed<WL, IWL>::min () : lhs - rhs;
+}
+
+// Q(a_1, b_1) * Q(a_2, b_2) = Q(a_1 + a_2 + 1, b_1 + b_2)
+template <unsigned LhsTotal, unsigned LhsIntegral, unsigned RhsTotal,
+          unsigned RhsIntegral>
+constexpr decltype (auto) operator* (fixed<LhsTotal, LhsIntegral> const lhs,
+                                     fixed<RhsTotal, RhsIntegral> const rhs) {
+  using result_type =
+      fixed<LhsTotal + RhsTotal, LhsIntegral + RhsIntegral + 1U>;
+  static_assert (result_type::total_bits <= 64U);
+  return result_type::frombits (
+      static_cast<uinteger_t<result_type::total_bits>> (
+          sinteger_t<64>{lhs.get ()} * sinteger_t<64>{rhs.get ()}));
+}
+
+// Rounding multiplication
+// ~~~~~~~~~~~~~~~~~~~~~~~
+// Multiplies two values, rounds the exact product to the number of fractional
+// bits of the Result type, and saturates to its range. The product of the raw
+// values must fit in 64 bits.
+
+template <typename Result, unsigned LhsTotal, unsigned LhsIntegral,
+          unsigned RhsTotal, unsigned RhsIntegral>
+constexpr Result mul_round (fixed<LhsTotal, LhsIntegral> const lhs,
+                            fixed<RhsTotal, RhsIntegral> const rhs) {
+  static_assert (LhsTotal + RhsTotal <= 64U);
+  constexpr auto shift =
+      static_cast<int> (fixed<LhsTotal, LhsIntegral>::fractional_bits +
+                        fixed<RhsTotal, RhsIntegral>::fractional_bits) -
+      static_cast<int> (Result::fractional_bits);
+  auto const product = details::shift_round<shift> (
+      sinteger_t<64>{lhs.get ()} * sinteger_t<64>{rhs.get ()});
+  return Result::frombits (static_cast<uinteger_t<Result::total_bits>> (
+      details::saturate_signed<Result::total_bits> (product)));
+}
+
+template <typename Result, unsigned LhsTotal, unsigned LhsIntegral,
+          size_t RhsWL, size_t RhsIWL>
+constexpr Result mul_round (fixed<LhsTotal, LhsIntegral> const lhs,
+                            ufixed<RhsWL, RhsIWL> const rhs) {
+  static_assert (LhsTotal + RhsWL < 64U);
+  constexpr auto shift =
+      static_cast<int> (fixed<LhsTotal, LhsIntegral>::fractional_bits +
+                        ufixed<RhsWL, RhsIWL>::fractional_bits) -
+      static_cast<int> (Result::fractional_bits);
+  auto const product = details::shift_round<shift> (
+      sinteger_t<64>{lhs.get ()} * static_cast<sinteger_t<64>> (rhs.get ()));
+  return Result::frombits (static_cast<uinteger_t<Result::total_bits>> (
+      details::saturate_signed<Result::total_bits> (product)));
+}
+
+template <typename Result, size_t LhsWL, size_t LhsIWL, size_t RhsWL,
+          size_t RhsIWL>
+constexpr Result mul_round (ufixed<LhsWL, LhsIWL> const lhs,
+                            ufixed<RhsWL, RhsIWL> const rhs) {
+  static_assert (LhsWL + RhsWL <= 64U);
+  constexpr auto shift = static_cast<int> (ufixed<LhsWL, LhsIWL>::fractional_bits +
+                                           ufixed<RhsWL, RhsIWL>::fractional_bits) -
+                         static_cast<int> (Result::fractional_bits);
+  auto const product = details::shift_round<shift> (uinteger_t<64>{lhs.get ()} *
+                                                    uinteger_t<64>{rhs.get ()});
+  return Result::frombits (static_cast<typename Result::value_type> (
+      product > mask_v<Result::total_bits> ? mask_v<Result::total_bits>
+                                           : product));
+}
+
 }  // end namespace synth
 
 #endif  // SYNTH_FIXED_HPP
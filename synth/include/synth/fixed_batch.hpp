@@ -0,0 +1,99 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_FIXED_BATCH_HPP
+#define SYNTH_FIXED_BATCH_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+
+#include "synth/fixed.hpp"
+#include "synth/span.hpp"
+
+namespace synth {
+
+// Batch arithmetic
+// ~~~~~~~~~~~~~~~~
+// Element-wise versions of the wrapping, saturating, and rounding operations
+// from fixed.hpp. Each loop body is branch-free so that the compiler can
+// vectorize it. The element type is deduced from the output span; the input
+// spans may be the same as the output.
+
+namespace details {
+
+template <typename Lhs, typename Rhs, typename Result, typename Function>
+inline void transform2 (span<Lhs const> const lhs, span<Rhs const> const rhs,
+                        span<Result> const out, Function f) {
+  assert (lhs.size () == out.size () && rhs.size () == out.size ());
+  auto const* const l = lhs.data ();
+  auto const* const r = rhs.data ();
+  auto* const o = out.data ();
+  for (auto ctr = size_t{0}, n = out.size (); ctr < n; ++ctr) {
+    o[ctr] = f (l[ctr], r[ctr]);
+  }
+}
+
+}  // end namespace details
+
+/// out[i] = add_wrap(lhs[i], rhs[i])
+template <typename Fixed>
+inline void add_wrap (span<std::add_const_t<Fixed>> const lhs,
+                      span<std::add_const_t<Fixed>> const rhs,
+                      span<Fixed> const out) {
+  details::transform2 (lhs, rhs, out, [] (Fixed const a, Fixed const b) {
+    return add_wrap (a, b);
+  });
+}
+/// out[i] = sub_wrap(lhs[i], rhs[i])
+template <typename Fixed>
+inline void sub_wrap (span<std::add_const_t<Fixed>> const lhs,
+                      span<std::add_const_t<Fixed>> const rhs,
+                      span<Fixed> const out) {
+  details::transform2 (lhs, rhs, out, [] (Fixed const a, Fixed const b) {
+    return sub_wrap (a, b);
+  });
+}
+/// out[i] = add_sat(lhs[i], rhs[i])
+template <typename Fixed>
+inline void add_sat (span<std::add_const_t<Fixed>> const lhs,
+                     span<std::add_const_t<Fixed>> const rhs,
+                     span<Fixed> const out) {
+  details::transform2 (lhs, rhs, out, [] (Fixed const a, Fixed const b) {
+    return add_sat (a, b);
+  });
+}
+/// out[i] = sub_sat(lhs[i], rhs[i])
+template <typename Fixed>
+inline void sub_sat (span<std::add_const_t<Fixed>> const lhs,
+                     span<std::add_const_t<Fixed>> const rhs,
+                     span<Fixed> const out) {
+  details::transform2 (lhs, rhs, out, [] (Fixed const a, Fixed const b) {
+    return sub_sat (a, b);
+  });
+}
+/// out[i] = mul_round<Result>(lhs[i], rhs[i])
+template <typename Result, typename Lhs, typename Rhs>
+inline void mul_round (span<Lhs> const lhs, span<Rhs> const rhs,
+                       span<Result> const out) {
+  using lhs_type = std::remove_const_t<Lhs>;
+  using rhs_type = std::remove_const_t<Rhs>;
+  details::transform2 (span<lhs_type const>{lhs}, span<rhs_type const>{rhs},
+                       out, [] (lhs_type const a, rhs_type const b) {
+                         return mul_round<Result> (a, b);
+                       });
+}
+/// out[i] = mul_round<Result>(lhs[i], rhs): scales each element of an array
+/// by a constant (for example, a gain).
+template <typename Result, typename Lhs, typename Rhs>
+inline void mul_round (span<Lhs> const lhs, Rhs const rhs,
+                       span<Result> const out) {
+  assert (lhs.size () == out.size ());
+  auto const* const l = lhs.data ();
+  auto* const o = out.data ();
+  for (auto ctr = size_t{0}, n = out.size (); ctr < n; ++ctr) {
+    o[ctr] = mul_round<Result> (l[ctr], rhs);
+  }
+}
+
+}  // end namespace synth
+
+#endif  // SYNTH_FIXED_BATCH_HPP
@@ -0,0 +1,44 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_KAISER_HPP
+#define SYNTH_KAISER_HPP
+
+#include <algorithm>
+#include <cmath>
+
+namespace synth {
+
+namespace details {
+
+/// The modified Bessel function of the first kind of order zero.
+inline double bessel_i0 (double const x) noexcept {
+  auto sum = 1.0;
+  auto term = 1.0;
+  for (auto k = 1U; k < 50U && term > sum * 1e-17; ++k) {
+    auto const t = x / (2.0 * k);
+    term *= t * t;
+    sum += term;
+  }
+  return sum;
+}
+
+}  // end namespace details
+
+/// The Kaiser window, used in the design of FIR filters.
+///
+/// \param x  The position within the window: -1 and 1 are its ends.
+/// \param beta  The window parameter. Larger values give greater stop band
+///   attenuation at the expense of a wider transition band.
+inline double kaiser (double const x, double const beta) noexcept {
+  return details::bessel_i0 (beta * std::sqrt (std::max (0.0, 1.0 - x * x))) /
+         details::bessel_i0 (beta);
+}
+
+/// Returns the approximate stop band attenuation (in dB) of a filter designed
+/// with a Kaiser window with parameter \p beta.
+constexpr double kaiser_attenuation (double const beta) noexcept {
+  return beta / 0.1102 + 8.7;
+}
+
+}  // end namespace synth
+
+#endif  // SYNTH_KAISER_HPP
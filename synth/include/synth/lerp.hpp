@@ -1,7 +1,12 @@
 #ifndef SYNTH_LERP_HPP
 #define SYNTH_LERP_HPP
 
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
 #include "synth/fixed.hpp"
+#include "synth/simd.hpp"
 
 namespace synth {
 
@@ -94,6 +99,182 @@ constexpr ufixed<WL, IWL> lerp_b (ufixed<WL, IWL> const hi,
       .template cast<WL, IWL> ();
 }
 
+/// Linear interpolation between two signed fixed-point values. The result is
+/// rounded to the nearest representable value.
+///
+/// \param hi  The value at ratio=1.
+/// \param lo  The value at ratio=0.
+/// \param ratio  The position of the result between \p lo and \p hi.
+template <unsigned TotalBits, unsigned IntegralBits, size_t RatioBits>
+constexpr fixed<TotalBits, IntegralBits> lerp_b (
+    fixed<TotalBits, IntegralBits> const hi,
+    fixed<TotalBits, IntegralBits> const lo, ufixed<RatioBits, 0> const ratio) {
+  static_assert (TotalBits + RatioBits < 64U);
+  using wide = sinteger_t<64>;
+  constexpr auto shift =
+      static_cast<int> (ufixed<RatioBits, 0>::fractional_bits);
+  // The interpolated value lies between lo and hi so it cannot overflow.
+  return fixed<TotalBits, IntegralBits>::frombits (
+      static_cast<uinteger_t<TotalBits>> (
+          lo.get () + details::shift_round<shift> (
+                          (wide{hi.get ()} - wide{lo.get ()}) *
+                          static_cast<wide> (ratio.get ()))));
+}
+
+/// Cubic Hermite (Catmull-Rom) interpolation between \p y0 and \p y1. The
+/// neighbouring values \p ym1 and \p y2 are used to estimate the slope of the
+/// curve at \p y0 and \p y1. The result is saturated to the range of the
+/// fixed-point type because the curve may overshoot its control points.
+///
+/// \param ym1  The value which precedes y0.
+/// \param y0  The value at ratio=0.
+/// \param y1  The value at ratio=1.
+/// \param y2  The value which follows y1.
+/// \param ratio  The position of the result between \p y0 and \p y1.
+template <unsigned TotalBits, unsigned IntegralBits, size_t RatioBits>
+constexpr fixed<TotalBits, IntegralBits> hermite (
+    fixed<TotalBits, IntegralBits> const ym1,
+    fixed<TotalBits, IntegralBits> const y0,
+    fixed<TotalBits, IntegralBits> const y1,
+    fixed<TotalBits, IntegralBits> const y2,
+    ufixed<RatioBits, 0> const ratio) {
+  // The coefficients need four more bits than the samples.
+  static_assert (TotalBits + 4U + RatioBits < 64U);
+  using wide = sinteger_t<64>;
+  constexpr auto shift = ufixed<RatioBits, 0>::fractional_bits;
+  auto const t = static_cast<wide> (ratio.get ());
+  auto const a = wide{ym1.get ()};
+  auto const b = wide{y0.get ()};
+  auto const c = wide{y1.get ()};
+  auto const d = wide{y2.get ()};
+  // Twice the coefficients of the polynomial so that they are all integers.
+  auto const c1 = c - a;
+  auto const c2 = 2 * a - 5 * b + 4 * c - d;
+  auto const c3 = 3 * (b - c) + d - a;
+  // Evaluate the polynomial using Horner's method. The final step removes the
+  // factor of two and rounds to nearest.
+  auto acc = ((c3 * t) >> shift) + c2;
+  acc = ((acc * t) >> shift) + c1;
+  return fixed<TotalBits, IntegralBits>::frombits (
+      static_cast<uinteger_t<TotalBits>> (
+          details::saturate_signed<TotalBits> (
+              b + details::shift_round<static_cast<int> (shift) + 1> (acc * t))));
+}
+
+// Vector forms
+// ~~~~~~~~~~~~
+// These functions operate on vectors of the raw values of 32-bit fixed-point
+// numbers and produce exactly the same results as the scalar functions above.
+// Ratios are unsigned fixed-point values with Shift fractional bits which must
+// be less than 2^31.
+
+namespace details {
+
+#if defined(__AVX2__)
+/// Multiplies the signed 32-bit values \p a and \p b to produce 64-bit
+/// products, adds \p bias (a vector of 64-bit values) and shifts the results
+/// right by \p Shift bits. The results must fit in 32 bits.
+template <unsigned Shift>
+inline __m256i mul_shift (__m256i const a, __m256i const b,
+                          __m256i const bias) {
+  static_assert (Shift <= 32U);
+  // _mm256_mul_epi32 multiplies the even-numbered elements so the odd elements
+  // are moved down, multiplied separately, and moved back again. A logical
+  // shift yields the same low 32 bits as an arithmetic shift.
+  __m256i const even = _mm256_srli_epi64 (
+      _mm256_add_epi64 (_mm256_mul_epi32 (a, b), bias), Shift);
+  __m256i const odd = _mm256_srli_epi64 (
+      _mm256_add_epi64 (_mm256_mul_epi32 (_mm256_srli_epi64 (a, 32),
+                                          _mm256_srli_epi64 (b, 32)),
+                        bias),
+      Shift);
+  return _mm256_blend_epi32 (even, _mm256_slli_epi64 (odd, 32), 0b10101010);
+}
+
+template <unsigned Shift>
+inline __m256i lerp_b (__m256i const hi, __m256i const lo,
+                       __m256i const ratio) {
+  __m256i const round = _mm256_set1_epi64x (int64_t{1} << (Shift - 1U));
+  return _mm256_add_epi32 (
+      lo, mul_shift<Shift> (_mm256_sub_epi32 (hi, lo), ratio, round));
+}
+
+template <unsigned TotalBits, unsigned Shift>
+inline __m256i hermite (__m256i const ym1, __m256i const y0, __m256i const y1,
+                        __m256i const y2, __m256i const ratio) {
+  // The intermediate values must fit in 32 bits.
+  static_assert (TotalBits <= 27U);
+  __m256i const zero = _mm256_setzero_si256 ();
+  __m256i const round = _mm256_set1_epi64x (int64_t{1} << Shift);
+  __m256i const c1 = _mm256_sub_epi32 (y1, ym1);
+  __m256i const c2 = _mm256_sub_epi32 (
+      _mm256_add_epi32 (_mm256_slli_epi32 (ym1, 1), _mm256_slli_epi32 (y1, 2)),
+      _mm256_add_epi32 (_mm256_mullo_epi32 (y0, _mm256_set1_epi32 (5)), y2));
+  __m256i const c3 = _mm256_add_epi32 (
+      _mm256_mullo_epi32 (_mm256_sub_epi32 (y0, y1), _mm256_set1_epi32 (3)),
+      _mm256_sub_epi32 (y2, ym1));
+  __m256i acc = _mm256_add_epi32 (mul_shift<Shift> (c3, ratio, zero), c2);
+  acc = _mm256_add_epi32 (mul_shift<Shift> (acc, ratio, zero), c1);
+  __m256i const result =
+      _mm256_add_epi32 (y0, mul_shift<Shift + 1U> (acc, ratio, round));
+  constexpr auto max = static_cast<int> (mask_v<TotalBits - 1U>);
+  return _mm256_max_epi32 (_mm256_min_epi32 (result, _mm256_set1_epi32 (max)),
+                           _mm256_set1_epi32 (-max - 1));
+}
+#endif  // __AVX2__
+
+#if defined(__AVX512F__)
+SYNTH_AVX512_BEGIN
+template <unsigned Shift>
+inline __m512i mul_shift (__m512i const a, __m512i const b,
+                          __m512i const bias) {
+  static_assert (Shift <= 32U);
+  __m512i const even = _mm512_srli_epi64 (
+      _mm512_add_epi64 (_mm512_mul_epi32 (a, b), bias), Shift);
+  __m512i const odd = _mm512_srli_epi64 (
+      _mm512_add_epi64 (_mm512_mul_epi32 (_mm512_srli_epi64 (a, 32),
+                                          _mm512_srli_epi64 (b, 32)),
+                        bias),
+      Shift);
+  return _mm512_mask_blend_epi32 (__mmask16{0xAAAA}, even,
+                                  _mm512_slli_epi64 (odd, 32));
+}
+
+template <unsigned Shift>
+inline __m512i lerp_b (__m512i const hi, __m512i const lo,
+                       __m512i const ratio) {
+  __m512i const round = _mm512_set1_epi64 (int64_t{1} << (Shift - 1U));
+  return _mm512_add_epi32 (
+      lo, mul_shift<Shift> (_mm512_sub_epi32 (hi, lo), ratio, round));
+}
+
+template <unsigned TotalBits, unsigned Shift>
+inline __m512i hermite (__m512i const ym1, __m512i const y0, __m512i const y1,
+                        __m512i const y2, __m512i const ratio) {
+  // The intermediate values must fit in 32 bits.
+  static_assert (TotalBits <= 27U);
+  __m512i const zero = _mm512_setzero_si512 ();
+  __m512i const round = _mm512_set1_epi64 (int64_t{1} << Shift);
+  __m512i const c1 = _mm512_sub_epi32 (y1, ym1);
+  __m512i const c2 = _mm512_sub_epi32 (
+      _mm512_add_epi32 (_mm512_slli_epi32 (ym1, 1), _mm512_slli_epi32 (y1, 2)),
+      _mm512_add_epi32 (_mm512_mullo_epi32 (y0, _mm512_set1_epi32 (5)), y2));
+  __m512i const c3 = _mm512_add_epi32 (
+      _mm512_mullo_epi32 (_mm512_sub_epi32 (y0, y1), _mm512_set1_epi32 (3)),
+      _mm512_sub_epi32 (y2, ym1));
+  __m512i acc = _mm512_add_epi32 (mul_shift<Shift> (c3, ratio, zero), c2);
+  acc = _mm512_add_epi32 (mul_shift<Shift> (acc, ratio, zero), c1);
+  __m512i const result =
+      _mm512_add_epi32 (y0, mul_shift<Shift + 1U> (acc, ratio, round));
+  constexpr auto max = static_cast<int> (mask_v<TotalBits - 1U>);
+  return _mm512_max_epi32 (_mm512_min_epi32 (result, _mm512_set1_epi32 (max)),
+                           _mm512_set1_epi32 (-max - 1));
+}
+SYNTH_AVX512_END
+#endif  // __AVX512F__
+
+}  // end namespace details
+
 #if 0
 int main (/*int argc, char const * argv[]*/) {
   using ftype = ufixed<24, 3>;
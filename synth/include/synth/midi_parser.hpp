@@ -0,0 +1,206 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_MIDI_PARSER_HPP
+#define SYNTH_MIDI_PARSER_HPP
+
+#include <cstdint>
+
+#include "synth/span.hpp"
+
+namespace synth {
+
+/// The types of message produced by midi_parser. The values of the channel
+/// message kinds are those of the upper nibble of their status byte; the values
+/// of system messages are their status byte.
+enum class midi_kind : uint8_t {
+  note_off = 0x80,
+  note_on = 0x90,
+  poly_pressure = 0xA0,
+  control_change = 0xB0,
+  program_change = 0xC0,
+  channel_pressure = 0xD0,
+  pitch_bend = 0xE0,
+
+  // System common messages.
+  mtc_quarter_frame = 0xF1,
+  song_position = 0xF2,
+  song_select = 0xF3,
+  tune_request = 0xF6,
+
+  // System real-time messages.
+  timing_clock = 0xF8,
+  start = 0xFA,
+  continue_ = 0xFB,
+  stop = 0xFC,
+  active_sensing = 0xFE,
+  system_reset = 0xFF,
+};
+
+/// A complete MIDI message.
+struct midi_message {
+  midi_kind kind = midi_kind::note_off;
+  /// The channel (0-15) of a channel message. Zero for system messages.
+  uint8_t channel = 0;
+  /// The data bytes of the message. Unused bytes are zero.
+  uint8_t data1 = 0;
+  uint8_t data2 = 0;
+
+  constexpr unsigned note () const noexcept { return data1; }
+  constexpr unsigned velocity () const noexcept { return data2; }
+  /// The 14-bit value of a pitch bend or song position message.
+  constexpr unsigned value14 () const noexcept {
+    return (unsigned{data2} << 7U) | data1;
+  }
+
+  friend constexpr bool operator== (midi_message const& a,
+                                    midi_message const& b) noexcept {
+    return a.kind == b.kind && a.channel == b.channel && a.data1 == b.data1 &&
+           a.data2 == b.data2;
+  }
+  friend constexpr bool operator!= (midi_message const& a,
+                                    midi_message const& b) noexcept {
+    return !(a == b);
+  }
+};
+
+/// An incremental decoder for a stream of MIDI bytes.
+///
+/// Bytes may be supplied in chunks of any size: a message which is split
+/// between chunks is completed by the next call. The parser handles:
+///
+/// - Running status: data bytes which follow a complete channel message reuse
+///   its status byte.
+/// - Real-time messages, which may appear between any two bytes (including
+///   in the middle of another message or of a system exclusive message)
+///   without disturbing it.
+/// - System exclusive messages, which are skipped.
+/// - Malformed input. A data byte without a status byte is discarded, as is an
+///   incomplete message that is interrupted by a new status byte. The parser
+///   never reads or produces a data value with bit 7 set.
+///
+/// A note-on with zero velocity is reported as a note-off (with zero
+/// velocity). The parser has no dynamic storage: its state is four bytes.
+class midi_parser {
+public:
+  /// Decodes a chunk of bytes, calling \p handler with each message as it is
+  /// completed.
+  ///
+  /// \param bytes  The bytes to be decoded.
+  /// \param handler  A function compatible with void(midi_message const&).
+  template <typename Handler>
+  void parse (span<uint8_t const> const bytes, Handler&& handler) {
+    for (auto const b : bytes) {
+      this->parse (b, handler);
+    }
+  }
+
+  /// Decodes a single byte, calling \p handler if it completes a message.
+  template <typename Handler>
+  void parse (uint8_t byte, Handler&& handler);
+
+  /// Discards any partial message and running status.
+  constexpr void reset () noexcept {
+    status_ = 0;
+    count_ = 0;
+    sysex_ = false;
+  }
+
+  /// Returns the status byte of the message being assembled or, between
+  /// channel messages, the running status. Zero if there is none.
+  constexpr uint8_t status () const noexcept { return status_; }
+
+private:
+  static constexpr auto sysex_start = uint8_t{0xF0};
+
+  /// Returns the number of data bytes which follow \p status.
+  static constexpr unsigned data_length (uint8_t const status) noexcept {
+    switch (status >> 4U) {
+    case 0xCU:
+    case 0xDU: return 1U;
+    case 0xFU:
+      if (status == 0xF2U) {
+        return 2U;  // Song position pointer.
+      }
+      return status == 0xF1U || status == 0xF3U ? 1U : 0U;
+    default: return 2U;
+    }
+  }
+
+  /// The status byte of the message being assembled or, for channel messages,
+  /// the running status. Zero if there is none.
+  uint8_t status_ = 0;
+  /// The first data byte of the message being assembled.
+  uint8_t data1_ = 0;
+  /// The number of data bytes received so far for the message being
+  /// assembled.
+  uint8_t count_ = 0;
+  /// True while inside a system exclusive message.
+  bool sysex_ = false;
+};
+
+// parse
+// ~~~~~
+template <typename Handler>
+void midi_parser::parse (uint8_t const byte, Handler&& handler) {
+  if (byte >= 0xF8U) {
+    // Real-time messages have no data bytes and leave all other state
+    // untouched. 0xF9 and 0xFD are undefined and are ignored.
+    if (byte != 0xF9U && byte != 0xFDU) {
+      midi_message m;
+      m.kind = static_cast<midi_kind> (byte);
+      handler (static_cast<midi_message const&> (m));
+    }
+    return;
+  }
+
+  if ((byte & 0x80U) != 0U) {
+    // A status byte ends any system exclusive message or partial message.
+    sysex_ = byte == sysex_start;
+    count_ = 0;
+    status_ = 0;
+    if (byte < 0xF0U) {
+      status_ = byte;  // A channel message.
+    } else if (byte == 0xF6U) {
+      midi_message m;
+      m.kind = midi_kind::tune_request;
+      handler (static_cast<midi_message const&> (m));
+    } else if (data_length (byte) > 0U) {
+      status_ = byte;  // A system common message with data.
+    }
+    // Anything else (0xF0, 0xF4, 0xF5, 0xF7) has no message of its own.
+    return;
+  }
+
+  // A data byte.
+  if (sysex_ || status_ == 0U) {
+    return;
+  }
+  if (count_ == 0U && data_length (status_) == 2U) {
+    data1_ = byte;
+    count_ = 1U;
+    return;
+  }
+
+  midi_message m;
+  if (count_ == 0U) {
+    m.data1 = byte;
+  } else {
+    m.data1 = data1_;
+    m.data2 = byte;
+  }
+  count_ = 0;
+  if (status_ >= 0xF0U) {
+    m.kind = static_cast<midi_kind> (status_);
+    status_ = 0;  // System common messages don't set running status.
+  } else {
+    m.kind = static_cast<midi_kind> (status_ & 0xF0U);
+    m.channel = static_cast<uint8_t> (status_ & 0x0FU);
+    if (m.kind == midi_kind::note_on && m.data2 == 0U) {
+      m.kind = midi_kind::note_off;
+    }
+  }
+  handler (static_cast<midi_message const&> (m));
+}
+
+}  // end namespace synth
+
+#endif  // SYNTH_MIDI_PARSER_HPP
@@ -0,0 +1,197 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_MIPMAP_WAVETABLE_HPP
+#define SYNTH_MIPMAP_WAVETABLE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "synth/span.hpp"
+#include "synth/wavetable.hpp"
+
+namespace synth {
+
+/// A band-limited waveform: a set of wavetables ("levels"), one per octave,
+/// each of which contains only those harmonics that can be reproduced without
+/// aliasing over that octave.
+///
+/// Level l contains harmonics 1 to 2^(N-1-l) (where N is
+/// Traits::wavetable_N) and may be played at any phase increment up to
+/// 2^(M-N+l): that is, a fundamental frequency of up to sample_rate/2^(N-l).
+/// Level 0 holds every harmonic that a table of 2^N entries can represent; the
+/// final level is a pure sine wave. An oscillator picks the level from its
+/// phase increment when its frequency is set so there is no per-sample cost.
+///
+/// The levels are held in a single contiguous array so that an
+/// oscillator_bank can read a different level in each lane with one vector
+/// gather.
+template <typename Traits>
+class mipmap_wavetable {
+public:
+  /// The traits type with which this wavetable is associated.
+  using traits = Traits;
+  using phase_index_type = typename oscillator_info<Traits>::phase_index_type;
+  using level_type = wavetable<Traits>;
+
+  /// The number of levels (octaves) in the mipmap.
+  static constexpr auto levels = size_t{Traits::wavetable_N};
+
+  /// \tparam Spectrum  A function with signature equivalent to
+  ///   std::pair<double, double>(unsigned).
+  /// \param spectrum  A function which returns the amplitudes of the cosine and
+  ///   sine components of harmonic h (h > 0) of the waveform.
+  template <typename Spectrum>
+  explicit mipmap_wavetable (Spectrum spectrum)
+      : levels_{make_levels (synthesize (spectrum),
+                             std::make_index_sequence<levels>{})} {}
+
+  /// Returns the index of the level to be used by an oscillator whose phase
+  /// increment is \p increment.
+  static constexpr size_t level (phase_index_type increment) noexcept;
+  /// Returns the number of harmonics in level \p l.
+  static constexpr size_t harmonics (size_t const l) noexcept {
+    assert (l < levels);
+    return size_t{1} << (levels - 1U - l);
+  }
+
+  /// Returns the table to be used by an oscillator whose phase increment is
+  /// \p increment.
+  constexpr level_type const* NONNULL
+  select (phase_index_type const increment) const noexcept {
+    return &levels_[level (increment)];
+  }
+
+  constexpr level_type const& operator[] (size_t const l) const noexcept {
+    assert (l < levels);
+    return levels_[l];
+  }
+  /// Returns the first entry of level 0. The levels follow one another in
+  /// memory.
+  constexpr amplitude const* NONNULL data () const noexcept {
+    return levels_.front ().data ();
+  }
+
+private:
+  static constexpr auto table_size_ = level_type::size ();
+  static_assert (Traits::wavetable_N >= 2U,
+                 "The mipmap needs tables of at least four entries");
+  // The levels must be packed with no padding so that together they form a
+  // single array of amplitudes.
+  static_assert (sizeof (level_type) == table_size_ * sizeof (amplitude));
+  std::array<level_type, levels> levels_;
+
+  /// Returns the samples of all of the levels, one after another.
+  template <typename Spectrum>
+  static std::vector<double> synthesize (Spectrum spectrum);
+
+  template <size_t... Levels>
+  static std::array<level_type, levels> make_levels (
+      std::vector<double> const& samples, std::index_sequence<Levels...>) {
+    return {{level_type{span<double const>{
+        samples.data () + Levels * table_size_, table_size_}}...}};
+  }
+};
+
+// level
+// ~~~~~
+template <typename Traits>
+constexpr size_t mipmap_wavetable<Traits>::level (
+    phase_index_type const increment) noexcept {
+  using value_type = typename phase_index_type::value_type;
+  auto const inc = increment.get ();
+  if (inc == 0U) {
+    return 0U;
+  }
+  // Level l is alias-free for increments up to 2^(M-N+l), so the result is the
+  // number of significant bits in (inc-1)/2^(M-N).
+  auto q = static_cast<value_type> (static_cast<value_type> (inc - 1U) >>
+                                    (Traits::M - Traits::wavetable_N));
+  auto result = size_t{0};
+  for (; q != 0U && result < levels - 1U; q >>= 1U) {
+    ++result;
+  }
+  return result;
+}
+
+// synthesize
+// ~~~~~~~~~~
+template <typename Traits>
+template <typename Spectrum>
+std::vector<double> mipmap_wavetable<Traits>::synthesize (Spectrum spectrum) {
+  // Entry i of a table is at θ=2πi/size so harmonic h needs sin(2π(h*i)/size).
+  // A single cycle of a sine wave therefore supplies every value that's
+  // needed.
+  std::vector<double> sine (table_size_);
+  for (auto k = size_t{0}; k < table_size_; ++k) {
+    sine[k] = std::sin (two_pi * static_cast<double> (k) /
+                        static_cast<double> (table_size_));
+  }
+  constexpr auto mask = table_size_ - 1U;
+  constexpr auto quarter = table_size_ / 4U;  // cos(θ) = sin(θ+π/2)
+
+  // Work from the final level (a single harmonic) towards level 0, adding
+  // harmonics to a running sum and recording it as each level is completed.
+  std::vector<double> sum (table_size_, 0.0);
+  std::vector<double> result (levels * table_size_);
+  auto h = size_t{1};
+  for (auto l = levels; l > 0U; --l) {
+    for (; h <= harmonics (l - 1U); ++h) {
+      auto const [a, b] = spectrum (static_cast<unsigned> (h));
+      for (auto i = size_t{0}; i < table_size_; ++i) {
+        auto const k = h * i;
+        sum[i] += a * sine[(k + quarter) & mask] + b * sine[k & mask];
+      }
+    }
+    std::copy (std::begin (sum), std::end (sum),
+               std::begin (result) +
+                   static_cast<std::ptrdiff_t> ((l - 1U) * table_size_));
+  }
+
+  // A band-limited waveform overshoots at its discontinuities (the Gibbs
+  // phenomenon). Scale every level by the same amount so that the loudness
+  // doesn't change from one octave to the next.
+  auto const peak = std::abs (*std::max_element (
+      std::begin (result), std::end (result),
+      [] (double const x, double const y) { return std::abs (x) < std::abs (y); }));
+  if (peak > 1.0) {
+    for (auto& v : result) {
+      v /= peak;
+    }
+  }
+  return result;
+}
+
+template <typename Traits>
+mipmap_wavetable<Traits> const bandlimited_square{[] (unsigned const h) {
+  // The Fourier series of the square wave is (4/π)Σsin(hθ)/h for odd h.
+  return std::make_pair (
+      0.0, h % 2U == 1U ? 4.0 / (pi * static_cast<double> (h)) : 0.0);
+}};
+
+template <typename Traits>
+mipmap_wavetable<Traits> const bandlimited_triangle{[] (unsigned const h) {
+  // The Fourier series of the triangle wave is -(8/π²)Σcos(hθ)/h² for odd h.
+  auto const hd = static_cast<double> (h);
+  return std::make_pair (h % 2U == 1U ? -8.0 / (pi * pi * hd * hd) : 0.0, 0.0);
+}};
+
+template <typename Traits>
+mipmap_wavetable<Traits> const bandlimited_sawtooth{[] (unsigned const h) {
+  // The Fourier series of the sawtooth wave is -(2/π)Σsin(hθ)/h.
+  return std::make_pair (0.0, -2.0 / (pi * static_cast<double> (h)));
+}};
+
+template <typename Traits>
+struct default_wavetable<mipmap_wavetable<Traits>> {
+  mipmap_wavetable<Traits> const* operator() () {
+    return &bandlimited_sawtooth<Traits>;
+  }
+};
+
+}  // end namespace synth
+
+#endif  // SYNTH_MIPMAP_WAVETABLE_HPP
@@ -7,66 +7,71 @@
 #include <cassert>
 #include <cmath>
 #include <limits>
+#include <type_traits>
 
 #include "synth/fixed.hpp"
+#include "synth/span.hpp"
 #include "synth/uint.hpp"
 #include "synth/wavetable.hpp"
 
-#if !defined(__clang_major__) || __clang_major__ < 7
-#define NONNULL
-#else
-#define NONNULL _Nonnull
-#endif
-
 namespace synth {
 
+namespace details {
+
+/// A wavetable type which holds several tables, such as mipmap_wavetable,
+/// provides a level_type member type and a select() member function which
+/// returns the table to be used for a given phase increment. Any other
+/// wavetable is its own table.
+template <typename Wavetable, typename = void>
+struct wavetable_level {
+  using type = Wavetable;
+  template <typename PhaseIndex>
+  static constexpr type const* NONNULL
+  select (Wavetable const* const NONNULL w, PhaseIndex /*increment*/) {
+    return w;
+  }
+};
+template <typename Wavetable>
+struct wavetable_level<Wavetable,
+                       std::void_t<typename Wavetable::level_type>> {
+  using type = typename Wavetable::level_type;
+  template <typename PhaseIndex>
+  static constexpr type const* NONNULL
+  select (Wavetable const* const NONNULL w, PhaseIndex const increment) {
+    return w->select (increment);
+  }
+};
+
+}  // end namespace details
+
 template <unsigned SampleRate, typename Traits,
           typename Wavetable = wavetable<Traits>>
 class oscillator {
 public:
   using traits = Traits;
   static constexpr const auto sample_rate = SampleRate;
+  using phase_index_type = typename oscillator_info<traits>::phase_index_type;
 
-  constexpr oscillator () : w_{default_wavetable<Wavetable>{}()} {}
-  constexpr explicit oscillator (Wavetable const* const NONNULL w) : w_{w} {}
+  constexpr oscillator () : oscillator (default_wavetable<Wavetable>{}()) {}
+  constexpr explicit oscillator (Wavetable const* const NONNULL w)
+      : w_{w}, table_{level::select (w, increment_)} {}
 
-  void set_wavetable (Wavetable const* const NONNULL w) { w_ = w; }
+  void set_wavetable (Wavetable const* const NONNULL w) {
+    w_ = w;
+    table_ = level::select (w, increment_);
+  }
   void set_frequency (frequency const f) {
     increment_ = oscillator::phase_increment (f);
+    // A band-limited wavetable offers a different table for each octave.
+    table_ = level::select (w_, increment_);
   }
 
-  amplitude tick () {
-    return w_->phase_to_amplitude (this->phase_accumulator ());
-  }
-
-private:
-  static_assert (traits::wavetable_N == Wavetable::traits::wavetable_N,
-                 "The wavetable traits and oscillator traits must match");
-  static_assert (traits::M == Wavetable::traits::M,
-                 "The wavetable traits and oscillator traits must match");
-
-  /// phase_increment() wants to compute f/(S*r) where S is the sample rate and
-  /// r is the number of entries in a wavetable. Everything but f is constant
-  /// and we'd like to eliminate the division, so rearrange to get f*(r/S).
-  static constexpr auto C =
-      ufixed<oscillator_info<traits>::C_fractional_bits, 0>::fromfp (
-          static_cast<double> (1U << traits::wavetable_N) / sample_rate);
-  static_assert (C.get () > 0U,
-                 "There are insufficient fractional bits for the phase "
-                 "accumulator constant");
-
-  using phase_index_type = typename oscillator_info<traits>::phase_index_type;
-
-  Wavetable const* NONNULL w_;
-  phase_index_type increment_;
-  phase_index_type phase_;
+  /// Fills the buffer \p out with consecutive samples from the oscillator.
+  void render (span<amplitude> out);
 
-  phase_index_type phase_accumulator () {
-    auto const result = phase_;
-    // TODO: need a "wrapping add" method. Plain operator+ returns a wider type
-    // to correctly handle overflow, but wrapping/modulo overflow is exactly
-    // what we want here!
-    phase_ = (phase_ + increment_).template cast<phase_index_type> ();
+  amplitude tick () {
+    amplitude result;
+    this->render (span<amplitude>{&result, 1U});
     return result;
   }
 
@@ -86,8 +91,56 @@ private:
         static_cast<typename phase_index_type::value_type> (f.get () *
                                                             C.get ()));
   }
+
+private:
+  /// phase_increment() wants to compute f/(S*r) where S is the sample rate and
+  /// r is the number of entries in a wavetable. Everything but f is constant
+  /// and we'd like to eliminate the division, so rearrange to get f*(r/S).
+  static constexpr auto C =
+      ufixed<oscillator_info<traits>::C_fractional_bits, 0>::fromfp (
+          static_cast<double> (1U << traits::wavetable_N) / sample_rate);
+  static_assert (C.get () > 0U,
+                 "There are insufficient fractional bits for the phase "
+                 "accumulator constant");
+
+  static_assert (traits::wavetable_N == Wavetable::traits::wavetable_N,
+                 "The wavetable traits and oscillator traits must match");
+  static_assert (traits::M == Wavetable::traits::M,
+                 "The wavetable traits and oscillator traits must match");
+
+  using level = details::wavetable_level<Wavetable>;
+
+  Wavetable const* NONNULL w_;
+  phase_index_type increment_;
+  phase_index_type phase_;
+  /// The table selected from w_ for the current phase increment.
+  typename level::type const* NONNULL table_;
+
+  static constexpr phase_index_type phase_accumulator (
+      phase_index_type const phase, phase_index_type const increment) {
+    // Plain operator+ returns a wider type to correctly handle overflow, but
+    // wrapping/modulo overflow is exactly what we want here!
+    return add_wrap (phase, increment);
+  }
 };
 
+// render
+// ~~~~~~
+template <unsigned SampleRate, typename Traits, typename Wavetable>
+void oscillator<SampleRate, Traits, Wavetable>::render (
+    span<amplitude> const out) {
+  // Work on local copies of the oscillator state so that the compiler is free
+  // to keep them in registers for the duration of the loop.
+  auto const* const NONNULL w = table_;
+  auto const increment = increment_;
+  auto phase = phase_;
+  for (amplitude& a : out) {
+    a = w->phase_to_amplitude (phase);
+    phase = phase_accumulator (phase, increment);
+  }
+  phase_ = phase;
+}
+
 }  // end namespace synth
 
 #endif  // SYNTH_NCO_HPP
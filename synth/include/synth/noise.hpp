@@ -0,0 +1,129 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_NOISE_HPP
+#define SYNTH_NOISE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "synth/span.hpp"
+#include "synth/wavetable.hpp"
+
+namespace synth {
+
+/// The spectra produced by noise_generator.
+enum class noise_color : uint8_t {
+  /// Uniformly distributed in [-1, 1) with a flat spectrum.
+  white,
+  /// A spectrum which falls at 3dB per octave (Voss-McCartney).
+  pink,
+  /// White noise passed through a one-pole low-pass filter whose cut-off is
+  /// set by noise_generator::set_cutoff().
+  filtered,
+};
+
+/// A source of noise with its own state, so that each voice (and each thread)
+/// can have an independent generator.
+///
+/// The random numbers come from #lanes interleaved xoshiro128++ generators:
+/// output sample i of each step is the next value from generator i. A whole
+/// step is computed at once using AVX-512 or AVX2 where they are available;
+/// the scalar code produces identical values.
+///
+/// The sequence is determined entirely by the seed and stream passed to the
+/// constructor (or seed()). Giving each voice the same seed and its index as
+/// the stream makes the voices independent but reproducible.
+class noise_generator {
+public:
+  /// The number of samples produced by each step of the generators.
+  static constexpr auto lanes = size_t{16};
+
+  explicit noise_generator (uint64_t seed = 0U, uint64_t stream = 0U) noexcept;
+
+  /// Restarts the generator in the state following construction with the same
+  /// arguments. The color and cut-off are unchanged.
+  void seed (uint64_t seed, uint64_t stream = 0U) noexcept;
+
+  noise_color color () const noexcept { return color_; }
+  void set_color (noise_color const c) noexcept { color_ = c; }
+  /// Sets the cut-off of the noise_color::filtered low-pass filter.
+  ///
+  /// \param cutoff  The cut-off frequency as a fraction of the sample rate in
+  ///   the range (0, 0.5].
+  void set_cutoff (double cutoff) noexcept;
+
+  /// Fills the buffer \p out with noise of the selected color.
+  void render (span<amplitude> out) noexcept;
+
+  amplitude tick () noexcept {
+    amplitude result;
+    this->render (span<amplitude>{&result, 1U});
+    return result;
+  }
+
+private:
+  /// The number of Voss-McCartney rows used for pink noise. With the white
+  /// term there are 16 values in the sum, so it is scaled by a shift.
+  static constexpr auto pink_rows = size_t{15};
+  /// The number of fractional bits of the low-pass filter coefficient.
+  static constexpr auto coefficient_bits = 16U;
+
+  /// Fills \p out with white noise.
+  void white (span<amplitude> out) noexcept;
+  /// Advances each of the generators and writes their outputs, as white noise,
+  /// to \p out.
+  void step (amplitude *NONNULL out) noexcept;
+  void pink (span<amplitude> out) noexcept;
+  void filtered (span<amplitude> out) noexcept;
+
+  /// The generators' state held as structure of arrays: s_[k][i] is word k of
+  /// generator i.
+  alignas (64) std::array<std::array<uint32_t, lanes>, 4> s_;
+  /// Generated samples which have not yet been returned: those at index used_
+  /// and above.
+  std::array<amplitude, lanes> pending_;
+  size_t used_ = lanes;
+
+  noise_color color_ = noise_color::white;
+
+  std::array<int32_t, pink_rows> rows_;
+  int32_t rows_sum_ = 0;
+  uint32_t counter_ = 0;
+
+  /// The low-pass filter's coefficient and output.
+  uint32_t coefficient_ = 1U << coefficient_bits;
+  int32_t lowpass_ = 0;
+};
+
+/// A "wavetable" which ignores the phase and returns white noise, so that an
+/// oscillator can be used as a noise source.
+///
+/// Each instance owns a noise_generator seeded with the seed and stream passed
+/// to its constructor. Give each voice its own instance with the voice's index
+/// as the stream: the voices' noise is then independent and is the same
+/// whichever thread renders them. An instance must only be used by one thread
+/// at a time.
+template <typename Traits>
+class noise_wavetable {
+public:
+  /// The traits type with which this wavetable is associated.
+  using traits = Traits;
+
+  explicit noise_wavetable (uint64_t const seed = 0U,
+                            uint64_t const stream = 0U) noexcept
+      : generator_{seed, stream} {}
+
+  amplitude phase_to_amplitude (
+      typename oscillator_info<Traits>::phase_index_type const /*phase*/)
+      const noexcept {
+    return generator_.tick ();
+  }
+
+private:
+  /// Oscillators refer to their wavetable through a pointer to const.
+  mutable noise_generator generator_;
+};
+
+}  // end namespace synth
+
+#endif  // SYNTH_NOISE_HPP
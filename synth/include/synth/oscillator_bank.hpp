@@ -0,0 +1,337 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_OSCILLATOR_BANK_HPP
+#define SYNTH_OSCILLATOR_BANK_HPP
+
+#include <array>
+#include <bitset>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "synth/mipmap_wavetable.hpp"
+#include "synth/nco.hpp"
+#include "synth/simd.hpp"
+#include "synth/span.hpp"
+#include "synth/wavetable.hpp"
+
+namespace synth {
+
+/// A collection of oscillators ("lanes") which share a single wavetable.
+///
+/// Rather than holding an array of oscillator instances, each with its own
+/// phase accumulator, increment, and wavetable pointer, the phases and
+/// increments of all of the lanes are held in contiguous arrays. This allows
+/// a group of lanes to be advanced with a single vector instruction and their
+/// wavetable lookups to be performed with a vector gather.
+///
+/// When the bank uses a mipmap_wavetable, each lane reads the level which suits
+/// its own frequency. The levels are contiguous in memory so a single gather
+/// can still serve every lane.
+///
+/// \tparam SampleRate  The sample rate in Hertz.
+/// \tparam Traits  The oscillator traits.
+/// \tparam Lanes  The number of oscillators in the bank.
+template <unsigned SampleRate, typename Traits, size_t Lanes>
+class oscillator_bank {
+public:
+  using traits = Traits;
+  static constexpr const auto sample_rate = SampleRate;
+  static constexpr const auto lanes = Lanes;
+  using phase_index_type = typename oscillator_info<traits>::phase_index_type;
+
+  oscillator_bank () : w_{default_wavetable<wavetable<Traits>>{}()} {}
+  explicit oscillator_bank (wavetable<Traits> const* const NONNULL w)
+      : w_{w} {}
+  explicit oscillator_bank (mipmap_wavetable<Traits> const* const NONNULL m)
+      : w_{&(*m)[0]}, mipmap_{m} {}
+
+  void set_wavetable (wavetable<Traits> const* NONNULL w);
+  void set_wavetable (mipmap_wavetable<Traits> const* NONNULL m);
+  void set_frequency (size_t lane, frequency f);
+
+  /// Renders out.size()/lanes consecutive samples from each of the oscillators
+  /// in the bank. The output is frame-major: sample f of lane k is written to
+  /// out[f * lanes + k], so each step of a group of vector lanes is a single
+  /// vector store.
+  ///
+  /// \param out  The buffer to which samples are written. Its size must be a
+  ///   multiple of the number of lanes.
+  void render (span<amplitude> out);
+  /// As render(), but only the lanes whose bit is set in \p active need
+  /// produce output: the contents of the other lanes' columns in \p out are
+  /// unspecified. Lanes are rendered in vector-sized groups and a group is
+  /// skipped only if none of its lanes is active. The phases of skipped lanes
+  /// are still advanced so that the output does not depend on which lanes were
+  /// rendered.
+  void render (span<amplitude> out, std::bitset<Lanes> const& active);
+  /// As render(out, active), but only the lanes [first_lane, last_lane) are
+  /// rendered or advanced. Calls which cover disjoint ranges of lanes may be
+  /// made concurrently.
+  void render (span<amplitude> out, std::bitset<Lanes> const& active,
+               size_t first_lane, size_t last_lane);
+
+private:
+  using value_type = typename phase_index_type::value_type;
+
+  /// True if the vector implementations may be used.
+  static constexpr bool vectorizable_ = wavetable<Traits>::vectorizable;
+
+  /// The wavetable or, if mipmap_ is not null, its first level.
+  wavetable<Traits> const* NONNULL w_;
+  mipmap_wavetable<Traits> const* mipmap_ = nullptr;
+  alignas (64) std::array<value_type, lanes> increments_{};
+  alignas (64) std::array<value_type, lanes> phases_{};
+  /// The mipmap level used by each lane. Always 0 if mipmap_ is null.
+  alignas (64) std::array<int32_t, lanes> levels_{};
+
+  /// Sets the mipmap level of lane \p lane to match its phase increment.
+  void select_level (size_t const lane) {
+    levels_[lane] =
+        mipmap_ == nullptr
+            ? 0
+            : static_cast<int32_t> (mipmap_wavetable<Traits>::level (
+                  phase_index_type::frombits (increments_[lane])));
+  }
+
+  static constexpr value_type wrap (value_type const phase) {
+    return static_cast<value_type> (phase & mask_v<traits::M>);
+  }
+
+  /// Returns true if any of the \p count lanes starting at \p lane are set in
+  /// \p active.
+  static bool any (std::bitset<Lanes> const& active, size_t const lane,
+                   size_t const count) {
+    for (auto l = lane; l < lane + count; ++l) {
+      if (active[l]) {
+        return true;
+      }
+    }
+    return false;
+  }
+  /// Advances the phases of \p count lanes starting at \p lane by \p frames
+  /// samples without producing any output.
+  void skip (size_t lane, size_t count, size_t frames);
+
+  /// Renders the lanes from \p lane onwards using scalar code.
+  void render_scalar (wavetable<Traits> const* NONNULL w, size_t lane,
+                      size_t frames, amplitude* NONNULL out);
+  /// Renders the single lane \p lane using scalar code.
+  void render_lane (wavetable<Traits> const* NONNULL w, size_t lane,
+                    size_t frames, amplitude* NONNULL out);
+#if defined(__AVX512F__)
+  /// Renders 16 lanes starting at \p lane. The phases of all 16 lanes are
+  /// advanced by a single instruction.
+  void render16 (wavetable<Traits> const* NONNULL w, size_t lane,
+                 size_t frames, amplitude* NONNULL out);
+#endif
+#if defined(__AVX2__)
+  /// Renders 8 lanes starting at \p lane. The phases of all 8 lanes are
+  /// advanced by a single instruction.
+  void render8 (wavetable<Traits> const* NONNULL w, size_t lane,
+                size_t frames, amplitude* NONNULL out);
+#endif
+};
+
+// set wavetable
+// ~~~~~~~~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Lanes>
+void oscillator_bank<SampleRate, Traits, Lanes>::set_wavetable (
+    wavetable<Traits> const* const NONNULL w) {
+  w_ = w;
+  mipmap_ = nullptr;
+  levels_.fill (0);
+}
+template <unsigned SampleRate, typename Traits, size_t Lanes>
+void oscillator_bank<SampleRate, Traits, Lanes>::set_wavetable (
+    mipmap_wavetable<Traits> const* const NONNULL m) {
+  w_ = &(*m)[0];
+  mipmap_ = m;
+  for (auto lane = size_t{0}; lane < lanes; ++lane) {
+    this->select_level (lane);
+  }
+}
+
+// set frequency
+// ~~~~~~~~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Lanes>
+void oscillator_bank<SampleRate, Traits, Lanes>::set_frequency (
+    size_t const lane, frequency const f) {
+  assert (lane < lanes);
+  increments_[lane] =
+      oscillator<SampleRate, Traits>::phase_increment (f).get ();
+  this->select_level (lane);
+}
+
+// render
+// ~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Lanes>
+void oscillator_bank<SampleRate, Traits, Lanes>::render (
+    span<amplitude> const out) {
+  assert (out.size () % lanes == 0U);
+  auto const frames = out.size () / lanes;
+  wavetable<Traits> const* const NONNULL w = w_;
+  auto lane = size_t{0};
+  if constexpr (vectorizable_) {
+#if defined(__AVX512F__)
+    for (; lane + 16U <= lanes; lane += 16U) {
+      this->render16 (w, lane, frames, out.data ());
+    }
+#endif
+#if defined(__AVX2__)
+    for (; lane + 8U <= lanes; lane += 8U) {
+      this->render8 (w, lane, frames, out.data ());
+    }
+#endif
+  }
+  this->render_scalar (w, lane, frames, out.data ());
+}
+
+template <unsigned SampleRate, typename Traits, size_t Lanes>
+void oscillator_bank<SampleRate, Traits, Lanes>::render (
+    span<amplitude> const out, std::bitset<Lanes> const& active) {
+  this->render (out, active, 0U, lanes);
+}
+
+template <unsigned SampleRate, typename Traits, size_t Lanes>
+void oscillator_bank<SampleRate, Traits, Lanes>::render (
+    span<amplitude> const out, std::bitset<Lanes> const& active,
+    size_t const first_lane, size_t const last_lane) {
+  assert (out.size () % lanes == 0U);
+  assert (first_lane <= last_lane && last_lane <= lanes);
+  auto const frames = out.size () / lanes;
+  wavetable<Traits> const* const NONNULL w = w_;
+  auto lane = first_lane;
+  if constexpr (vectorizable_) {
+#if defined(__AVX512F__)
+    for (; lane + 16U <= last_lane; lane += 16U) {
+      if (any (active, lane, 16U)) {
+        this->render16 (w, lane, frames, out.data ());
+      } else {
+        this->skip (lane, 16U, frames);
+      }
+    }
+#endif
+#if defined(__AVX2__)
+    for (; lane + 8U <= last_lane; lane += 8U) {
+      if (any (active, lane, 8U)) {
+        this->render8 (w, lane, frames, out.data ());
+      } else {
+        this->skip (lane, 8U, frames);
+      }
+    }
+#endif
+  }
+  for (; lane < last_lane; ++lane) {
+    if (active[lane]) {
+      this->render_lane (w, lane, frames, out.data ());
+    } else {
+      this->skip (lane, 1U, frames);
+    }
+  }
+}
+
+// skip
+// ~~~~
+template <unsigned SampleRate, typename Traits, size_t Lanes>
+void oscillator_bank<SampleRate, Traits, Lanes>::skip (size_t const lane,
+                                                      size_t const count,
+                                                      size_t const frames) {
+  // The phase arithmetic is modular so n increments can be applied at once.
+  auto const n = static_cast<value_type> (frames);
+  for (auto l = lane; l < lane + count; ++l) {
+    phases_[l] = wrap (static_cast<value_type> (phases_[l] + increments_[l] * n));
+  }
+}
+
+// render scalar
+// ~~~~~~~~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Lanes>
+void oscillator_bank<SampleRate, Traits, Lanes>::render_scalar (
+    wavetable<Traits> const* const NONNULL w, size_t lane, size_t const frames,
+    amplitude* const NONNULL out) {
+  for (; lane < lanes; ++lane) {
+    this->render_lane (w, lane, frames, out);
+  }
+}
+
+// render lane
+// ~~~~~~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Lanes>
+void oscillator_bank<SampleRate, Traits, Lanes>::render_lane (
+    wavetable<Traits> const* const NONNULL w, size_t const lane,
+    size_t const frames, amplitude* const NONNULL out) {
+  auto phase = phases_[lane];
+  auto const increment = increments_[lane];
+  // The levels of a mipmap are consecutive elements of an array.
+  wavetable<Traits> const* const NONNULL table = w + levels_[lane];
+  for (auto frame = size_t{0}; frame < frames; ++frame) {
+    out[frame * lanes + lane] =
+        table->phase_to_amplitude (phase_index_type::frombits (phase));
+    phase = wrap (phase + increment);
+  }
+  phases_[lane] = phase;
+}
+
+#if defined(__AVX512F__)
+SYNTH_AVX512_BEGIN
+// render16
+// ~~~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Lanes>
+void oscillator_bank<SampleRate, Traits, Lanes>::render16 (
+    wavetable<Traits> const* const NONNULL w, size_t const lane,
+    size_t const frames, amplitude* const NONNULL out) {
+  auto* const phases = &phases_[lane];
+  auto const* const increments = &increments_[lane];
+  __m512i phase = _mm512_loadu_si512 (phases);
+  __m512i const increment = _mm512_loadu_si512 (increments);
+  // The offset of each lane's mipmap level from the first.
+  __m512i const table_offset = _mm512_slli_epi32 (
+      _mm512_loadu_si512 (&levels_[lane]), traits::wavetable_N);
+  amplitude const* const NONNULL base = w->data ();
+  auto* column = out + lane;
+  for (auto frame = size_t{0}; frame < frames; ++frame) {
+    _mm512_storeu_si512 (column,
+                         wavetable<Traits>::lookup (base, phase, table_offset));
+    phase = _mm512_add_epi32 (phase, increment);
+    column += lanes;
+  }
+  _mm512_storeu_si512 (phases, phase);
+}
+SYNTH_AVX512_END
+#endif  // __AVX512F__
+
+#if defined(__AVX2__)
+// render8
+// ~~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Lanes>
+void oscillator_bank<SampleRate, Traits, Lanes>::render8 (
+    wavetable<Traits> const* const NONNULL w, size_t const lane,
+    size_t const frames, amplitude* const NONNULL out) {
+  auto* const phases = reinterpret_cast<__m256i*> (&phases_[lane]);
+  auto const* const increments =
+      reinterpret_cast<__m256i const*> (&increments_[lane]);
+  __m256i phase = _mm256_loadu_si256 (phases);
+  __m256i const increment = _mm256_loadu_si256 (increments);
+  // The offset of each lane's mipmap level from the first.
+  __m256i const table_offset = _mm256_slli_epi32 (
+      _mm256_loadu_si256 (reinterpret_cast<__m256i const*> (&levels_[lane])),
+      traits::wavetable_N);
+  amplitude const* const NONNULL base = w->data ();
+  auto* column = out + lane;
+  for (auto frame = size_t{0}; frame < frames; ++frame) {
+    _mm256_storeu_si256 (reinterpret_cast<__m256i*> (column),
+                         wavetable<Traits>::lookup (base, phase, table_offset));
+    phase = _mm256_add_epi32 (phase, increment);
+    column += lanes;
+  }
+  _mm256_storeu_si256 (phases, phase);
+}
+#endif  // __AVX2__
+
+}  // end namespace synth
+
+#endif  // SYNTH_OSCILLATOR_BANK_HPP
@@ -0,0 +1,305 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_OVERSAMPLER_HPP
+#define SYNTH_OVERSAMPLER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "synth/envelope.hpp"
+#include "synth/kaiser.hpp"
+#include "synth/span.hpp"
+#include "synth/voice_assigner.hpp"
+#include "synth/wavetable.hpp"
+
+namespace synth {
+
+/// A 2:1 decimator: a half-band low-pass FIR filter which removes the upper
+/// half of the input spectrum followed by the discarding of every other
+/// sample.
+///
+/// The filter has 4K-1 taps. Those at an even distance from the center are
+/// zero (apart from the center tap itself, which is exactly 0.5) so the filter
+/// is evaluated in polyphase form: the odd input samples pass through a
+/// symmetric K-pair filter and the even samples are simply delayed. Only the
+/// samples which are kept are computed, so each output costs K
+/// multiplications.
+///
+/// The arithmetic is fixed point: the samples are amplitude values and the
+/// coefficients have #coefficient_bits fractional bits. Products are summed in
+/// 64 bits and the result is rounded once. The output is clamped to [-1, 1].
+///
+/// \tparam K  The number of coefficient pairs. More pairs give a narrower
+///   transition band and greater stop band attenuation.
+template <size_t K>
+class halfband_decimator {
+public:
+  static_assert (K > 0U);
+  /// The number of taps of the (non-polyphase) filter.
+  static constexpr auto taps = 4U * K - 1U;
+  /// The delay introduced by the filter measured in input samples.
+  static constexpr auto delay = 2U * K - 1U;
+  static constexpr auto coefficient_bits = 30U;
+
+  /// \param beta  The Kaiser window parameter used in the design of the
+  ///   filter.
+  explicit halfband_decimator (double beta = 8.0) noexcept;
+
+  /// Decimates in.size() samples from \p in to in.size()/2 samples in \p out.
+  /// The filter state carries across calls so a stream may be processed in
+  /// blocks of any (even) size. \p out may start at the same address as \p in
+  /// to decimate in place.
+  void process (span<amplitude const> in, span<amplitude> out) noexcept;
+  /// Clears the filter's history.
+  void reset () noexcept;
+
+  /// The filter coefficients of the odd taps: the coefficient at a distance of
+  /// 2k+1 taps from the center is coefficients()[k].
+  std::array<int32_t, K> const& coefficients () const noexcept { return g_; }
+
+private:
+  /// The number of outputs which are computed by each call to process_block().
+  static constexpr auto block_size = size_t{64};
+  static constexpr auto half = int32_t{1} << (coefficient_bits - 1U);
+  static constexpr auto one = int32_t{1} << amplitude::fractional_bits;
+
+  /// The filter computes the output sample m from the odd and even input
+  /// sequences o and e as:
+  ///
+  ///   y[m] = 0.5 * e[m+1-K] + sum_{k=1}^{K} g[k-1] * (o[m-K+k] + o[m-K+1-k])
+  ///
+  /// odd_ holds 2K-1 odd samples of history followed by those of the current
+  /// block, even_ holds K-1 even samples of history followed by those of the
+  /// current block.
+  void process_block (amplitude const* NONNULL in, amplitude* NONNULL out,
+                      size_t n) noexcept;
+  /// Returns the rounded and clamped output value for an accumulated sum.
+  static constexpr int32_t finish (int64_t const acc) noexcept {
+    auto const v = static_cast<int32_t> (
+        (acc + (int64_t{1} << (coefficient_bits - 1U))) >> coefficient_bits);
+    return std::clamp (v, -one, one);
+  }
+
+  std::array<int32_t, K> g_{};
+  alignas (32) std::array<int32_t, 2U * K - 1U + block_size> odd_{};
+  alignas (32) std::array<int32_t, K - 1U + block_size> even_{};
+};
+
+// (ctor)
+// ~~~~~~
+template <size_t K>
+halfband_decimator<K>::halfband_decimator (double const beta) noexcept {
+  // A Kaiser-windowed sinc with its cut-off at a quarter of the input sample
+  // rate. The odd taps are scaled so that their sum is exactly 0.5 which
+  // (with the 0.5 center tap) gives unity gain at DC.
+  std::array<double, K> g;
+  auto sum = 0.0;
+  for (auto k = size_t{0}; k < K; ++k) {
+    auto const d = static_cast<double> (2U * k + 1U);
+    auto const sinc = (k % 2U == 0U ? 1.0 : -1.0) / (pi * d);
+    g[k] = sinc * kaiser (d / static_cast<double> (2U * K), beta);
+    sum += g[k];
+  }
+  constexpr auto scale = static_cast<double> (int64_t{1} << coefficient_bits);
+  for (auto k = size_t{0}; k < K; ++k) {
+    g_[k] = static_cast<int32_t> (std::lround (g[k] * 0.25 / sum * scale));
+  }
+}
+
+// reset
+// ~~~~~
+template <size_t K>
+void halfband_decimator<K>::reset () noexcept {
+  odd_.fill (0);
+  even_.fill (0);
+}
+
+// process
+// ~~~~~~~
+template <size_t K>
+void halfband_decimator<K>::process (span<amplitude const> const in,
+                                     span<amplitude> const out) noexcept {
+  assert (in.size () == out.size () * 2U);
+  for (auto first = size_t{0}, size = out.size (); first < size;) {
+    auto const n = std::min (block_size, size - first);
+    this->process_block (in.data () + 2U * first, out.data () + first, n);
+    first += n;
+  }
+}
+
+// process block
+// ~~~~~~~~~~~~~
+template <size_t K>
+void halfband_decimator<K>::process_block (amplitude const* const NONNULL in,
+                                           amplitude* const NONNULL out,
+                                           size_t const n) noexcept {
+  assert (n <= block_size);
+  // Split the input into its even and odd phases after the history.
+  int32_t* const NONNULL odd = odd_.data ();
+  int32_t* const NONNULL even = even_.data ();
+  for (auto m = size_t{0}; m < n; ++m) {
+    even[K - 1U + m] = in[2U * m].get ();
+    odd[2U * K - 1U + m] = in[2U * m + 1U].get ();
+  }
+
+  auto m = size_t{0};
+#if defined(__AVX2__)
+  // Four outputs at a time. _mm256_mul_epi32 produces the full 64-bit product
+  // of the low 32 bits of each 64-bit lane.
+  auto* const y = reinterpret_cast<int32_t*> (out);
+  __m256i const round = _mm256_set1_epi64x (int64_t{1}
+                                            << (coefficient_bits - 1U));
+  __m256i const even_lanes = _mm256_setr_epi32 (0, 2, 4, 6, 0, 0, 0, 0);
+  __m128i const hi = _mm_set1_epi32 (one);
+  __m128i const lo = _mm_set1_epi32 (-one);
+  for (; m + 4U <= n; m += 4U) {
+    __m256i acc = _mm256_mul_epi32 (
+        _mm256_cvtepi32_epi64 (
+            _mm_loadu_si128 (reinterpret_cast<__m128i const*> (even + m))),
+        _mm256_set1_epi64x (half));
+    for (auto k = size_t{1}; k <= K; ++k) {
+      __m128i const pair = _mm_add_epi32 (
+          _mm_loadu_si128 (
+              reinterpret_cast<__m128i const*> (odd + m + K - 1U + k)),
+          _mm_loadu_si128 (reinterpret_cast<__m128i const*> (odd + m + K - k)));
+      acc = _mm256_add_epi64 (
+          acc, _mm256_mul_epi32 (_mm256_cvtepi32_epi64 (pair),
+                                 _mm256_set1_epi64x (g_[k - 1U])));
+    }
+    // A logical shift gives the same low 32 bits as an arithmetic shift
+    // because the shift is less than 32 bits.
+    acc = _mm256_srli_epi64 (_mm256_add_epi64 (acc, round), coefficient_bits);
+    __m128i const v = _mm256_castsi256_si128 (
+        _mm256_permutevar8x32_epi32 (acc, even_lanes));
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (y + m),
+                      _mm_min_epi32 (_mm_max_epi32 (v, lo), hi));
+  }
+#endif  // __AVX2__
+  for (; m < n; ++m) {
+    auto acc = int64_t{half} * even[m];
+    for (auto k = size_t{1}; k <= K; ++k) {
+      acc += int64_t{g_[k - 1U]} * (odd[m + K - 1U + k] + odd[m + K - k]);
+    }
+    out[m] = amplitude::frombits (static_cast<uint32_t> (finish (acc)));
+  }
+
+  // Keep the most recent samples as history for the next block.
+  std::copy_n (odd + n, 2U * K - 1U, odd);
+  std::copy_n (even + n, K - 1U, even);
+}
+
+/// Renders a voice_assigner at Factor times the output sample rate and
+/// decimates the result. The oscillators, their waveshaping, and the
+/// envelopes all run at the higher rate, so the aliases which they generate
+/// fall above the output band where the decimation filters remove them.
+///
+/// The voices are mixed before they are decimated so the cost of the filters
+/// does not depend on the number of voices. The decimation is a cascade of
+/// 2:1 half-band stages. Only the last stage has to protect the whole of the
+/// output pass band: the earlier stages, which run at higher rates, only have
+/// to remove the images that would fold into it and use shorter filters.
+///
+/// \tparam SampleRate  The output sample rate in Hertz.
+/// \tparam Traits  The oscillator traits.
+/// \tparam Factor  The oversampling factor: 2, 4, or 8.
+/// \tparam Polyphony  The number of voices.
+template <unsigned SampleRate, typename Traits, unsigned Factor,
+          size_t Polyphony = 8>
+class oversampled_voice_assigner {
+public:
+  static_assert (Factor == 2U || Factor == 4U || Factor == 8U,
+                 "Factor must be 2, 4, or 8");
+  static constexpr auto sample_rate = SampleRate;
+  static constexpr auto factor = Factor;
+  using voices_type = voice_assigner<SampleRate * Factor, Traits, Polyphony>;
+  using phase = typename envelope<SampleRate>::phase;
+
+  void note_on (unsigned const note) { voices_.note_on (note); }
+  void note_off (unsigned const note) { voices_.note_off (note); }
+  void set_wavetable (wavetable<Traits> const *const w) {
+    voices_.set_wavetable (w);
+  }
+  void set_wavetable (mipmap_wavetable<Traits> const *const w) {
+    voices_.set_wavetable (w);
+  }
+  /// Envelope times are given in seconds so they are unaffected by the
+  /// oversampling.
+  void set_envelope (phase const stage, double const value) {
+    voices_.set_envelope (stage, value);
+  }
+  auto active_voices () const { return voices_.active_voices (); }
+
+  /// The oversampled voices, for the use of settings not forwarded by this
+  /// class.
+  voices_type &voices () noexcept { return voices_; }
+
+  /// Fills the buffer \p out with the mixed and decimated output of the
+  /// voices, saturated to the range [-1, 1].
+  void render (span<amplitude> out);
+  /// Fills the buffer \p out with the mixed and decimated output of the
+  /// voices, saturated to the range [-1, 1].
+  void render (span<double> out);
+
+private:
+  static constexpr auto block_size = size_t{64};
+  /// The number of coefficient pairs used by the final and the earlier
+  /// decimation stages.
+  static constexpr auto final_pairs = size_t{12};
+  static constexpr auto early_pairs = size_t{4};
+  static constexpr auto early_stages =
+      Factor == 8U ? size_t{2} : Factor == 4U ? size_t{1} : size_t{0};
+
+  voices_type voices_;
+  std::array<halfband_decimator<early_pairs>, early_stages> early_;
+  halfband_decimator<final_pairs> final_;
+  std::array<amplitude, block_size * Factor> buffer_;
+};
+
+// render
+// ~~~~~~
+template <unsigned SampleRate, typename Traits, unsigned Factor,
+          size_t Polyphony>
+void oversampled_voice_assigner<SampleRate, Traits, Factor, Polyphony>::render (
+    span<amplitude> const out) {
+  for (auto first = size_t{0}, size = out.size (); first < size;) {
+    auto const n = std::min (block_size, size - first);
+    auto length = n * Factor;
+    voices_.render (span<amplitude>{buffer_.data (), length});
+    // Each stage halves the length of the buffer in place.
+    for (auto &stage : early_) {
+      stage.process (span<amplitude const>{buffer_.data (), length},
+                     span<amplitude>{buffer_.data (), length / 2U});
+      length /= 2U;
+    }
+    final_.process (span<amplitude const>{buffer_.data (), length},
+                    out.subspan (first, n));
+    first += n;
+  }
+}
+
+template <unsigned SampleRate, typename Traits, unsigned Factor,
+          size_t Polyphony>
+void oversampled_voice_assigner<SampleRate, Traits, Factor, Polyphony>::render (
+    span<double> const out) {
+  std::array<amplitude, block_size> block;
+  for (auto first = size_t{0}, size = out.size (); first < size;) {
+    auto const n = std::min (block_size, size - first);
+    this->render (span<amplitude>{block.data (), n});
+    std::transform (std::begin (block), std::begin (block) + n,
+                    std::begin (out) + first,
+                    [] (amplitude const a) { return a.as_double (); });
+    first += n;
+  }
+}
+
+}  // end namespace synth
+
+#endif  // SYNTH_OVERSAMPLER_HPP
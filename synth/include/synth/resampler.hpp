@@ -0,0 +1,97 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_RESAMPLER_HPP
+#define SYNTH_RESAMPLER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "synth/span.hpp"
+
+namespace synth {
+
+/// A streaming sample rate converter for a rational ratio of rates.
+///
+/// The ratio of the output and input rates is reduced to L/M. Conceptually,
+/// the input is upsampled by L, low-pass filtered, and downsampled by M. Only
+/// the samples which are kept are computed: each output sample is the dot
+/// product of taps_per_phase input samples with one of L "phases" of the
+/// filter. The filter is a Kaiser-windowed sinc whose cut-off is just below the
+/// lower of the two Nyquist frequencies. The phases are computed once, by the
+/// constructor, for the pair of rates.
+///
+/// The arithmetic is single precision floating point. The dot products use
+/// AVX2 where it is available.
+///
+/// Each output sample depends on taps_per_phase/2 input samples which follow
+/// it: the output is delayed by latency() input samples.
+class resampler {
+public:
+  /// The largest permitted value of L: the number of filter phases.
+  static constexpr auto max_phases = 2048U;
+
+  /// \param in_rate  The input sample rate in Hertz.
+  /// \param out_rate  The output sample rate in Hertz. The rates must be such
+  ///   that out_rate/gcd(in_rate, out_rate) does not exceed #max_phases.
+  /// \param taps_per_phase  The length of each filter phase. It must be a
+  ///   multiple of 8. Longer filters have a narrower transition band.
+  /// \throws std::invalid_argument  If is_supported(in_rate, out_rate) is
+  ///   false.
+  resampler (unsigned in_rate, unsigned out_rate, size_t taps_per_phase = 128U);
+
+  /// Returns true if both rates are non-zero and their ratio can be converted:
+  /// that is, out_rate/gcd(in_rate, out_rate) does not exceed #max_phases.
+  static bool is_supported (unsigned in_rate, unsigned out_rate) noexcept;
+
+  unsigned in_rate () const noexcept { return in_rate_; }
+  unsigned out_rate () const noexcept { return out_rate_; }
+  /// The delay of the output measured in input samples.
+  size_t latency () const noexcept { return taps_ / 2U; }
+
+  /// Returns the largest number of samples produced by a call to process()
+  /// with \p input samples.
+  size_t max_output (size_t input) const noexcept;
+
+  /// Converts a block of samples.
+  ///
+  /// \param in  The input samples.
+  /// \param out  The buffer to which the output is written. It must have room
+  ///   for at least max_output(in.size()) samples.
+  /// \returns  The number of samples written to \p out.
+  size_t process (span<double const> in, span<double> out) noexcept;
+
+  /// Discards the input history, returning to the state following
+  /// construction.
+  void reset () noexcept;
+
+private:
+  /// The number of input samples consumed by each step of process().
+  static constexpr auto block_size = size_t{256};
+
+  /// Produces the outputs which can be computed from the samples in history_.
+  size_t run (double* out) noexcept;
+
+  unsigned in_rate_;
+  unsigned out_rate_;
+  /// The reduced ratio of out_rate_ to in_rate_ is L/M.
+  unsigned l_;
+  unsigned m_;
+  size_t taps_;
+  /// The L filter phases, each of taps_ coefficients, one after another. Phase
+  /// p is used for output samples which fall p/L of an input sample after an
+  /// input sample.
+  std::vector<float> phases_;
+
+  /// Input samples: those still needed by future outputs followed by new
+  /// input. The first used_ elements are valid.
+  std::vector<float> history_;
+  size_t used_ = 0;
+  /// The first sample in history_ of the filter window for the next output.
+  /// That output falls phase_/L of a sample after the middle of the window.
+  size_t position_ = 0;
+  unsigned phase_ = 0;
+};
+
+}  // end namespace synth
+
+#endif  // SYNTH_RESAMPLER_HPP
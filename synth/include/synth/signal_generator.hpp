@@ -0,0 +1,162 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_SIGNAL_GENERATOR_HPP
+#define SYNTH_SIGNAL_GENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "synth/span.hpp"
+
+namespace synth {
+
+// Generators of test signals for measurement.
+//
+// Each generator's render() member function writes the next samples of its
+// signal. The whole signal may be written by one call (block form) or by a
+// series of calls of any size (streaming form); the output is the same. This
+// is because each sample is computed as a function of its index rather than
+// of its predecessor, which also allows the loops to be vectorized.
+//
+// Sines are evaluated from a phase measured in cycles using a polynomial whose
+// error is below 1e-9. There are no calls to std::pow() or std::sin() per
+// sample.
+
+/// How the frequency of a chirp changes with time.
+enum class chirp_shape : uint8_t {
+  /// The frequency changes by the same number of Hertz in each second.
+  linear,
+  /// The frequency changes by the same ratio in each second: each octave takes
+  /// the same time.
+  exponential,
+};
+
+/// A sine sweep from one frequency to another.
+class chirp {
+public:
+  /// \param shape  How the frequency changes with time.
+  /// \param f0  The frequency of the first sample in Hertz. It must be greater
+  ///   than zero for an exponential chirp.
+  /// \param f1  The frequency of the last sample in Hertz. It must be greater
+  ///   than zero for an exponential chirp.
+  /// \param samples  The length of the chirp. It must be at least 2.
+  /// \param sample_rate  The sample rate in Hertz.
+  /// \param peak  The peak amplitude of the output.
+  chirp (chirp_shape shape, double f0, double f1, size_t samples,
+         double sample_rate, double peak = 1.0);
+
+  /// The length of the chirp in samples.
+  size_t size () const noexcept { return samples_; }
+  /// The index of the next sample to be rendered.
+  size_t position () const noexcept { return position_; }
+
+  /// Writes the next out.size() samples. Samples beyond the end of the chirp
+  /// are zero.
+  void render (span<double> out) noexcept;
+  /// Returns to the first sample.
+  void reset () noexcept { position_ = 0; }
+
+private:
+  /// An exponential chirp's phase is computed using powers of its ratio which
+  /// are either a multiple of stride or less than it.
+  static constexpr auto stride = size_t{1024};
+
+  void render_linear (span<double> out) const noexcept;
+  void render_exponential (span<double> out) const noexcept;
+
+  chirp_shape shape_;
+  size_t samples_;
+  double amplitude_;
+  size_t position_ = 0;
+
+  /// The phase of sample n in cycles is n * (a_ + b_ * (n - 1)) for a linear
+  /// chirp and a_ * (r^n - 1) for an exponential chirp, whose ratio of
+  /// frequencies between successive samples is r.
+  double a_ = 0.0;
+  double b_ = 0.0;
+  double log_ratio_ = 0.0;
+  /// r^j - 1 for j in [0, stride).
+  std::vector<double> powers_;
+};
+
+/// A sine wave component of a multitone signal.
+struct tone {
+  /// The frequency in Hertz.
+  double frequency = 0.0;
+  /// The peak amplitude.
+  double amplitude = 1.0;
+  /// The phase of the first sample in cycles.
+  double phase = 0.0;
+};
+
+/// The sum of a number of sines.
+class multitone {
+public:
+  /// \param tones  The components of the signal.
+  /// \param sample_rate  The sample rate in Hertz.
+  multitone (span<tone const> tones, double sample_rate);
+
+  void render (span<double> out) noexcept;
+  void reset () noexcept { position_ = 0; }
+
+private:
+  /// The tones with frequencies measured in cycles per sample.
+  std::vector<tone> tones_;
+  size_t position_ = 0;
+};
+
+/// A sequence of sines whose frequencies are spaced logarithmically. Each
+/// frequency is held for a fixed number of samples. The phase is continuous
+/// from one step to the next.
+class stepped_sine {
+public:
+  /// \param f0  The first frequency in Hertz.
+  /// \param f1  The last frequency in Hertz.
+  /// \param steps  The number of frequencies. It must be at least 2.
+  /// \param samples_per_step  The number of samples for which each frequency
+  ///   is held.
+  /// \param sample_rate  The sample rate in Hertz.
+  /// \param peak  The peak amplitude of the output.
+  stepped_sine (double f0, double f1, size_t steps, size_t samples_per_step,
+                double sample_rate, double peak = 1.0);
+
+  /// The length of the signal in samples.
+  size_t size () const noexcept { return increments_.size () * per_step_; }
+
+  /// Writes the next out.size() samples. Samples beyond the end of the last
+  /// step are zero.
+  void render (span<double> out) noexcept;
+  void reset () noexcept { position_ = 0; }
+
+private:
+  size_t per_step_;
+  double amplitude_;
+  size_t position_ = 0;
+  /// The phase increment in cycles per sample of each step.
+  std::vector<double> increments_;
+  /// The phase of the first sample of each step in cycles.
+  std::vector<double> starts_;
+};
+
+/// A single impulse or a train of impulses.
+class impulse {
+public:
+  /// \param period  The distance between impulses in samples or 0 for a single
+  ///   impulse at the first sample.
+  /// \param peak  The value of each impulse.
+  explicit impulse (size_t const period = 0U,
+                    double const peak = 1.0) noexcept
+      : period_{period}, amplitude_{peak} {}
+
+  void render (span<double> out) noexcept;
+  void reset () noexcept { position_ = 0; }
+
+private:
+  size_t period_;
+  double amplitude_;
+  size_t position_ = 0;
+};
+
+}  // end namespace synth
+
+#endif  // SYNTH_SIGNAL_GENERATOR_HPP
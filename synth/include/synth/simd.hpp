@@ -0,0 +1,24 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_SIMD_HPP
+#define SYNTH_SIMD_HPP
+
+// SYNTH_AVX512_BEGIN and SYNTH_AVX512_END bracket code which uses AVX-512
+// intrinsics.
+//
+// GCC implements the unmasked AVX-512 intrinsics in terms of masked builtins
+// with an undefined passthrough operand. Once they are inlined, GCC 12 reports
+// that operand as uninitialized. The warning is a false positive (every lane
+// of the passthrough is masked off) so the macros suppress -Wuninitialized and
+// -Wmaybe-uninitialized between them. Other compilers don't need them.
+#if defined(__GNUC__) && !defined(__clang__)
+#define SYNTH_AVX512_BEGIN                                \
+  _Pragma ("GCC diagnostic push")                         \
+  _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")  \
+  _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+#define SYNTH_AVX512_END _Pragma ("GCC diagnostic pop")
+#else
+#define SYNTH_AVX512_BEGIN
+#define SYNTH_AVX512_END
+#endif
+
+#endif  // SYNTH_SIMD_HPP
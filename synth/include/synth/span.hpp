@@ -0,0 +1,97 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_SPAN_HPP
+#define SYNTH_SPAN_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace synth {
+
+/// A minimal stand-in for C++20's std::span<> with dynamic extent: a
+/// non-owning view of a contiguous sequence of objects of type \p T.
+///
+/// \tparam T  The element type. May be const-qualified to produce a read-only
+///   view.
+template <typename T>
+class span {
+public:
+  using element_type = T;
+  using value_type = std::remove_cv_t<T>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using pointer = T*;
+  using reference = T&;
+  using iterator = T*;
+
+  constexpr span () noexcept = default;
+  constexpr span (pointer const first, size_type const count) noexcept
+      : data_{first}, size_{count} {}
+  constexpr span (pointer const first, pointer const last) noexcept
+      : data_{first}, size_{static_cast<size_type> (last - first)} {
+    assert (last >= first);
+  }
+  template <std::size_t N>
+  constexpr span (element_type (&arr)[N]) noexcept : data_{arr}, size_{N} {}
+
+  /// Constructs a span from a contiguous container such as std::array<> or
+  /// std::vector<>.
+  template <typename Container,
+            typename = std::enable_if_t<
+                !std::is_base_of_v<span, std::decay_t<Container>> &&
+                std::is_convertible_v<
+                    std::remove_pointer_t<decltype (
+                        std::data (std::declval<Container&> ()))> (*)[],
+                    element_type (*)[]>>>
+  constexpr span (Container&& c) noexcept
+      : data_{std::data (c)}, size_{std::size (c)} {}
+
+  /// Allows a span<T> to be converted to span<T const>.
+  template <typename U, typename = std::enable_if_t<
+                            std::is_convertible_v<U (*)[], element_type (*)[]>>>
+  constexpr span (span<U> const& other) noexcept
+      : data_{other.data ()}, size_{other.size ()} {}
+
+  constexpr pointer data () const noexcept { return data_; }
+  constexpr size_type size () const noexcept { return size_; }
+  constexpr bool empty () const noexcept { return size_ == 0U; }
+
+  constexpr iterator begin () const noexcept { return data_; }
+  constexpr iterator end () const noexcept { return data_ + size_; }
+
+  constexpr reference operator[] (size_type const index) const noexcept {
+    assert (index < size_);
+    return data_[index];
+  }
+
+  /// Returns a view of the first \p count elements of this span.
+  constexpr span first (size_type const count) const noexcept {
+    assert (count <= size_);
+    return {data_, count};
+  }
+  /// Returns a view of the last \p count elements of this span.
+  constexpr span last (size_type const count) const noexcept {
+    assert (count <= size_);
+    return {data_ + (size_ - count), count};
+  }
+  /// Returns a view of the \p count elements of this span starting at
+  /// \p offset. If \p count is omitted, the view extends to the end of the
+  /// span.
+  constexpr span subspan (
+      size_type const offset,
+      size_type const count = static_cast<size_type> (-1)) const noexcept {
+    assert (offset <= size_);
+    return {data_ + offset,
+            count == static_cast<size_type> (-1) ? size_ - offset : count};
+  }
+
+private:
+  pointer data_ = nullptr;
+  size_type size_ = 0;
+};
+
+}  // end namespace synth
+
+#endif  // SYNTH_SPAN_HPP
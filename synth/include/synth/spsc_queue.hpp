@@ -0,0 +1,141 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_SPSC_QUEUE_HPP
+#define SYNTH_SPSC_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+
+namespace synth {
+
+/// A bounded, wait-free queue with a single producer and a single consumer.
+///
+/// This is the channel from the control threads (MIDI input, user interface)
+/// to the audio thread. Neither side ever takes a lock or waits for the other:
+/// push() fails if the queue is full and pop() fails if it is empty, each
+/// after a fixed number of steps. This means that a burst of control events
+/// can never delay the rendering of audio.
+///
+/// The queue is a ring of Capacity slots indexed by two free-running
+/// counters: the producer owns the tail and the consumer owns the head. Each
+/// side also keeps a private copy of the other's counter which it refreshes
+/// only when the ring appears full (or empty), so that most operations touch
+/// only cache lines belonging to that side.
+///
+/// \tparam T  The type of the queue elements. Elements are copied into and
+///   out of the ring, so copying must not throw.
+/// \tparam Capacity  The maximum number of elements in the queue. Must be a
+///   power of two.
+template <typename T, size_t Capacity>
+class spsc_queue {
+  static_assert (Capacity > 0U && (Capacity & (Capacity - 1U)) == 0U,
+                 "Capacity must be a power of two");
+  static_assert (std::is_nothrow_copy_assignable_v<T>,
+                 "spsc_queue elements must be nothrow copy-assignable");
+  static_assert (std::atomic<size_t>::is_always_lock_free,
+                 "spsc_queue requires lock-free atomic counters");
+
+public:
+  using value_type = T;
+  static constexpr auto capacity = Capacity;
+
+  /// Adds \p v to the back of the queue. Must only be called by the producer.
+  ///
+  /// \returns  True if the element was added, false if the queue was full.
+  bool push (T const& v) noexcept;
+
+  /// Removes the element at the front of the queue. Must only be called by the
+  /// consumer.
+  ///
+  /// \returns  The element or std::nullopt if the queue was empty.
+  std::optional<T> pop () noexcept;
+
+  /// Removes each of the elements which were in the queue at the time of the
+  /// call and passes them in turn to \p f. Elements pushed while the queue is
+  /// being drained are left for the next call so that the amount of work is
+  /// bounded. Must only be called by the consumer.
+  ///
+  /// \param f  A function called with each element removed from the queue.
+  /// \returns  The number of elements removed.
+  template <typename Function>
+  size_t drain (Function f);
+
+  /// Returns true if the queue was empty at the time of the call. The result
+  /// may be stale by the time it is seen by a caller other than the consumer.
+  bool empty () const noexcept {
+    return head_.load (std::memory_order_acquire) ==
+           tail_.load (std::memory_order_acquire);
+  }
+
+private:
+  static constexpr auto mask = Capacity - 1U;
+  /// Keeps members written by the producer and those written by the consumer
+  /// on different cache lines.
+  static constexpr auto cache_line = size_t{64};
+
+  /// The index of the next element to be read. Written by the consumer.
+  alignas (cache_line) std::atomic<size_t> head_{0};
+  /// The consumer's most recent copy of tail_.
+  size_t tail_cache_ = 0;
+
+  /// The index of the next slot to be written. Written by the producer.
+  alignas (cache_line) std::atomic<size_t> tail_{0};
+  /// The producer's most recent copy of head_.
+  size_t head_cache_ = 0;
+
+  alignas (cache_line) std::array<T, Capacity> slots_{};
+};
+
+// push
+// ~~~~
+template <typename T, size_t Capacity>
+bool spsc_queue<T, Capacity>::push (T const& v) noexcept {
+  auto const tail = tail_.load (std::memory_order_relaxed);
+  if (tail - head_cache_ == Capacity) {
+    head_cache_ = head_.load (std::memory_order_acquire);
+    if (tail - head_cache_ == Capacity) {
+      return false;  // Full.
+    }
+  }
+  slots_[tail & mask] = v;
+  tail_.store (tail + 1U, std::memory_order_release);
+  return true;
+}
+
+// pop
+// ~~~
+template <typename T, size_t Capacity>
+std::optional<T> spsc_queue<T, Capacity>::pop () noexcept {
+  auto const head = head_.load (std::memory_order_relaxed);
+  if (head == tail_cache_) {
+    tail_cache_ = tail_.load (std::memory_order_acquire);
+    if (head == tail_cache_) {
+      return std::nullopt;  // Empty.
+    }
+  }
+  std::optional<T> result{slots_[head & mask]};
+  head_.store (head + 1U, std::memory_order_release);
+  return result;
+}
+
+// drain
+// ~~~~~
+template <typename T, size_t Capacity>
+template <typename Function>
+size_t spsc_queue<T, Capacity>::drain (Function f) {
+  auto head = head_.load (std::memory_order_relaxed);
+  tail_cache_ = tail_.load (std::memory_order_acquire);
+  auto const count = tail_cache_ - head;
+  for (; head != tail_cache_; ++head) {
+    f (static_cast<T const&> (slots_[head & mask]));
+  }
+  // Release the slots all at once.
+  head_.store (head, std::memory_order_release);
+  return count;
+}
+
+}  // end namespace synth
+
+#endif  // SYNTH_SPSC_QUEUE_HPP
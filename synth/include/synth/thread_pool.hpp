@@ -0,0 +1,125 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_THREAD_POOL_HPP
+#define SYNTH_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace synth {
+
+/// A persistent pool of worker threads which execute a set of tasks in
+/// fork/join style: run() hands out the tasks and returns once every one of
+/// them has been completed. It is intended for splitting the work of a single
+/// audio block, so it never allocates once constructed and its waits are
+/// tuned for latency.
+///
+/// The tasks are divided into contiguous ranges: one for each worker and one
+/// for the thread which calls run(), which also executes tasks. Each thread
+/// takes tasks from the front of its own range. A thread whose range is
+/// exhausted steals from the back of the others' until no tasks remain, so an
+/// uneven division of the work is rebalanced.
+///
+/// Between calls to run(), workers spin (yielding the processor) for a short
+/// time before going to sleep. A block that follows soon after its predecessor
+/// therefore finds the workers awake.
+///
+/// run() must not be called concurrently from more than one thread, nor from
+/// within a task.
+class thread_pool {
+public:
+  /// \param workers  The number of worker threads. Tasks are also executed by
+  ///   the thread that calls run() so, for example, 3 workers allow 4 tasks to
+  ///   execute at once. With no workers, run() executes all of the tasks
+  ///   itself.
+  explicit thread_pool (unsigned workers);
+  thread_pool (thread_pool const&) = delete;
+  thread_pool (thread_pool&&) noexcept = delete;
+  ~thread_pool () noexcept;
+
+  thread_pool& operator= (thread_pool const&) = delete;
+  thread_pool& operator= (thread_pool&&) noexcept = delete;
+
+  /// The number of threads which execute tasks: the workers and the caller of
+  /// run().
+  unsigned concurrency () const noexcept {
+    return static_cast<unsigned> (threads_.size ()) + 1U;
+  }
+
+  /// Calls \p f once with each of the values [0, tasks) and returns when all
+  /// of the calls have returned. The calls are made in no particular order
+  /// and on any of the pool's threads.
+  ///
+  /// \param tasks  The number of tasks.
+  /// \param f  A function compatible with void(size_t) noexcept.
+  template <typename Function>
+  void run (size_t tasks, Function&& f);
+
+private:
+  using task_function = void (*) (void* context, size_t task);
+
+  /// The tasks which remain in a thread's range: the first is in the low 32
+  /// bits, the end in the high 32 bits. Packing both into one atomic word
+  /// allows the owner (taking from the front) and thieves (taking from the
+  /// back) to update the range without a lock.
+  struct alignas (64) range {
+    std::atomic<uint64_t> bounds{0};
+  };
+  static constexpr uint64_t pack (uint64_t const first, uint64_t const last) {
+    return first | (last << 32U);
+  }
+  static constexpr size_t first (uint64_t const b) { return b & 0xFFFFFFFFU; }
+  static constexpr size_t last (uint64_t const b) { return b >> 32U; }
+
+  /// The number of times that an idle worker checks for new work before
+  /// sleeping.
+  static constexpr auto spin_count = 4096U;
+
+  void run (size_t tasks, task_function f, void* context);
+  void worker (size_t self);
+  /// Executes tasks on behalf of thread \p self until none remain.
+  void participate (size_t self);
+  /// Takes the first task from the range of thread \p self.
+  bool pop (size_t self, size_t* task);
+  /// Takes the last task from the range of thread \p victim.
+  bool steal (size_t victim, size_t* task);
+
+  std::unique_ptr<range[]> ranges_;
+  task_function function_ = nullptr;
+  void* context_ = nullptr;
+
+  /// Incremented to start each run.
+  alignas (64) std::atomic<uint32_t> epoch_{0};
+  /// The number of workers which have yet to finish the current run.
+  alignas (64) std::atomic<unsigned> busy_{0};
+  /// The number of workers which are asleep (or about to sleep) on cv_.
+  std::atomic<unsigned> sleeping_{0};
+  std::atomic<bool> stop_{false};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<std::thread> threads_;
+};
+
+// run
+// ~~~
+template <typename Function>
+void thread_pool::run (size_t const tasks, Function&& f) {
+  using function_type = std::remove_reference_t<Function>;
+  auto* const fn = std::addressof (f);
+  this->run (
+      tasks,
+      [] (void* const context, size_t const task) {
+        (*static_cast<function_type*> (context)) (task);
+      },
+      const_cast<void*> (static_cast<void const*> (fn)));
+}
+
+}  // end namespace synth
+
+#endif  // SYNTH_THREAD_POOL_HPP
@@ -2,11 +2,12 @@
 #ifndef SYNTH_VOICE_HPP
 #define SYNTH_VOICE_HPP
 
+#include <algorithm>
 #include <array>
-#include <numeric>
 
 #include "synth/envelope.hpp"
 #include "synth/nco.hpp"
+#include "synth/span.hpp"
 
 namespace synth {
 
@@ -37,40 +38,92 @@ public:
   void set_wavetable (Wavetable const* const NONNULL w);
   void set_envelope (typename envelope<SampleRate>::phase stage, double value);
 
-  amplitude tick ();
+  /// Fills the buffer \p out with consecutive samples from the voice.
+  void render (span<amplitude> out);
+
+  amplitude tick () {
+    amplitude result;
+    this->render (span<amplitude>{&result, 1U});
+    return result;
+  }
+
+  /// The maximum number of samples that are rendered in one go. Larger buffers
+  /// are processed in chunks of this size.
+  static constexpr auto block_size = size_t{64};
+  /// The number of oscillators that make up each voice.
+  static constexpr auto oscillators = size_t{2};
+
+  /// Returns the frequencies of each of a voice's oscillators when playing
+  /// MIDI note number \p note.
+  static std::array<frequency, oscillators> note_frequencies (unsigned note);
+
+  /// Mixes the output of a voice's oscillators.
+  ///
+  /// \param in  The oscillator output. This holds #oscillators consecutive
+  ///   rows of samples, each of which contains out.size() samples.
+  /// \param out  The buffer to which the mixed samples are written.
+  static void mix (span<amplitude const> in, span<amplitude> out);
+  /// Mixes the output of a voice's oscillators which is interleaved with that
+  /// of other oscillators, as produced by oscillator_bank.
+  ///
+  /// \param in  The oscillator output. Sample k of oscillator o is
+  ///   in[k * stride + o].
+  /// \param stride  The distance between consecutive samples of an oscillator.
+  /// \param out  The buffer to which the mixed samples are written.
+  static void mix (amplitude const* NONNULL in, size_t stride,
+                   span<amplitude> out);
 
 private:
-  static constexpr auto oscillators_ = size_t{2};
   static constexpr auto hard_clip_ = false;
-  std::array<oscillator_type, oscillators_> osc_;
+  /// Sample k of oscillator o is in[k * frame_stride + o * osc_stride].
+  static void mix (amplitude const* NONNULL in, size_t frame_stride,
+                   size_t osc_stride, span<amplitude> out);
+  std::array<oscillator_type, oscillators> osc_;
   envelope<SampleRate> env_;
 
-  static constexpr double saturate (double const a) {
-    assert (std::isfinite (a));
-    if (a > 1.0) {
-      return 1.0;
+  /// A soft clipper: values outside of [-1, 1] are clamped; those within are
+  /// shaped by f(a)=a(2-|a|) unless hard_clip_ is set.
+  static constexpr amplitude saturate (amplitude const a) {
+    constexpr auto one = amplitude::fromint (1U);
+    if (a >= one) {
+      return one;
     }
-    if (a < -1.0) {
-      return -1.0;
+    if (a <= -one) {
+      return -one;
     }
     if constexpr (hard_clip_) {
       return a;
     }
-    return a * (2.0 - (a >= 0.0 ? a : -a));
+    // a(2-|a|) = 2a - a|a|. a is negative half of the time, so 2a is formed by
+    // addition rather than a (signed) left shift. It can't overflow: |a| < 1.
+    return (a + a) - mul_round<amplitude> (a, a < amplitude{} ? -a : a);
   }
 };
 
+// note frequencies
+// ~~~~~~~~~~~~~~~~
+template <unsigned SampleRate, typename Traits, typename Wavetable>
+auto voice<SampleRate, Traits, Wavetable>::note_frequencies (
+    unsigned const note) -> std::array<frequency, oscillators> {
+  constexpr auto master_tune = 440.0;
+  constexpr auto detune = 4.0;
+  std::array<frequency, oscillators> result;
+  result[0] =
+      frequency::fromfp (midi_note_to_frequency (master_tune, note));  // 8'
+  if constexpr (oscillators > 1) {
+    result[1] =
+        frequency::fromfp (midi_note_to_frequency (master_tune + detune, note));
+  }
+  return result;
+}
+
 // note on
 // ~~~~~~~
 template <unsigned SampleRate, typename Traits, typename Wavetable>
 void voice<SampleRate, Traits, Wavetable>::note_on (unsigned const note) {
-  constexpr auto master_tune = 440.0;
-  constexpr auto detune = 4.0;
-  osc_[0].set_frequency (
-      frequency::fromfp (midi_note_to_frequency (master_tune, note)));  // 8'
-  if constexpr (oscillators_ > 0) {
-    osc_[1].set_frequency (frequency::fromfp (
-        midi_note_to_frequency (master_tune + detune, note)));
+  auto const f = note_frequencies (note);
+  for (auto ctr = size_t{0}; ctr < oscillators; ++ctr) {
+    osc_[ctr].set_frequency (f[ctr]);
   }
   env_.note_on ();
 }
@@ -100,37 +153,55 @@ void voice<SampleRate, Traits, Wavetable>::set_envelope (
   env_.set (stage, value);
 }
 
-// Saturating unsigned addition.
-template <unsigned Bits>
-constexpr uinteger_t<Bits> sat_addu (uinteger_t<Bits> const a,
-                                     uinteger_t<Bits> const b) {
-  uinteger_t<Bits> const c = a + b;
-  return (c > mask_v<Bits> || c < a) ? mask_v<Bits> : c;
+// mix
+// ~~~
+template <unsigned SampleRate, typename Traits, typename Wavetable>
+void voice<SampleRate, Traits, Wavetable>::mix (span<amplitude const> const in,
+                                                span<amplitude> const out) {
+  assert (in.size () == oscillators * out.size ());
+  mix (in.data (), 1U, out.size (), out);
+}
+template <unsigned SampleRate, typename Traits, typename Wavetable>
+void voice<SampleRate, Traits, Wavetable>::mix (
+    amplitude const* const NONNULL in, size_t const stride,
+    span<amplitude> const out) {
+  assert (stride >= oscillators);
+  mix (in, stride, 1U, out);
+}
+template <unsigned SampleRate, typename Traits, typename Wavetable>
+void voice<SampleRate, Traits, Wavetable>::mix (
+    amplitude const* const NONNULL in, size_t const frame_stride,
+    size_t const osc_stride, span<amplitude> const out) {
+  auto const n = out.size ();
+  for (auto ctr = size_t{0}; ctr < n; ++ctr) {
+    amplitude a;
+    for (auto osc = size_t{0}; osc < oscillators; ++osc) {
+      a = saturate (a + in[ctr * frame_stride + osc * osc_stride]);
+    }
+    out[ctr] = a;
+  }
 }
 
-// tick
-// ~~~~
+// render
+// ~~~~~~
 template <unsigned SampleRate, typename Traits, typename Wavetable>
-auto voice<SampleRate, Traits, Wavetable>::tick () -> amplitude {
+void voice<SampleRate, Traits, Wavetable>::render (span<amplitude> const out) {
   if (!env_.active ()) {
-    return amplitude::fromfp (0.0);
+    std::fill (std::begin (out), std::end (out), amplitude::fromfp (0.0));
+    return;
   }
 
-  // Mix the output from the oscillators.
-#if 1
-  double const a =
-      std::accumulate (std::begin (osc_), std::end (osc_), 0.0,
-                       [] (double const acc, oscillator_type& osc) {
-                         return saturate (acc + osc.tick ().as_double ());
-                       });
-  return env_.tick (amplitude::fromfp (a));
-#else
-  amplitude a;
-  for (auto osc : osc_) {
-    a = sat_add (a, osc.tick ());
+  std::array<amplitude, oscillators * block_size> osc_out;
+  for (auto first = size_t{0}, size = out.size (); first < size;) {
+    auto const n = std::min (block_size, size - first);
+    auto const chunk = out.subspan (first, n);
+    for (auto osc = size_t{0}; osc < oscillators; ++osc) {
+      osc_[osc].render (span<amplitude>{osc_out.data () + osc * n, n});
+    }
+    mix (span<amplitude const>{osc_out.data (), oscillators * n}, chunk);
+    env_.render (chunk);
+    first += n;
   }
-  return env_.tick (a);
-#endif
 }
 
 }  // end namespace synth
@@ -2,107 +2,593 @@
 #ifndef SYNTH_VOICE_ASSIGNER_HPP
 #define SYNTH_VOICE_ASSIGNER_HPP
 
+#include <algorithm>
 #include <array>
+#include <bitset>
+#include <cassert>
+#include <cstdint>
 #include <limits>
-#include <numeric>
 
+#include "synth/mipmap_wavetable.hpp"
+#include "synth/oscillator_bank.hpp"
+#include "synth/span.hpp"
+#include "synth/thread_pool.hpp"
 #include "synth/voice.hpp"
 
 namespace synth {
 
-template <unsigned SampleRate, typename Traits>
+/// How voice_assigner chooses the voice to be reused for a new note when every
+/// voice is in use.
+enum class steal_policy : uint8_t {
+  /// The voice whose note started longest ago.
+  oldest,
+  /// The voice with the lowest envelope level.
+  quietest,
+  /// The voice which was released longest ago or, if no voice has been
+  /// released, the oldest.
+  releasing_first,
+};
+
+namespace details {
+
+/// An intrusive doubly-linked list of integers in the range [0, N). Each
+/// integer may be a member of the list at most once. All operations take
+/// constant time.
+template <size_t N>
+class index_list {
+public:
+  using index = uint16_t;
+  static_assert (N < std::numeric_limits<index>::max (), "N is too large");
+  /// A value which is never a list member: marks the ends of the list.
+  static constexpr auto none = std::numeric_limits<index>::max ();
+
+  constexpr bool empty () const noexcept { return head_ == none; }
+  constexpr index front () const noexcept { return head_; }
+  /// Returns the member which follows \p i or #none if \p i is the last.
+  constexpr index next (index const i) const noexcept { return next_[i]; }
+
+  void push_back (index i) noexcept;
+  void remove (index i) noexcept;
+
+private:
+  index head_ = none;
+  index tail_ = none;
+  std::array<index, N> prev_{};
+  std::array<index, N> next_{};
+};
+
+// push back
+// ~~~~~~~~~
+template <size_t N>
+void index_list<N>::push_back (index const i) noexcept {
+  assert (i < N);
+  prev_[i] = tail_;
+  next_[i] = none;
+  if (tail_ == none) {
+    head_ = i;
+  } else {
+    next_[tail_] = i;
+  }
+  tail_ = i;
+}
+
+// remove
+// ~~~~~~
+template <size_t N>
+void index_list<N>::remove (index const i) noexcept {
+  assert (i < N);
+  auto const p = prev_[i];
+  auto const n = next_[i];
+  (p == none ? head_ : next_[p]) = n;
+  (n == none ? tail_ : prev_[n]) = p;
+}
+
+}  // end namespace details
+
+/// Assigns notes to a fixed collection of voices and mixes their output.
+///
+/// The oscillators of all of the voices are held in a single oscillator_bank
+/// so that they can be rendered together: voice v owns lanes
+/// [v*voice_type::oscillators, (v+1)*voice_type::oscillators) of the bank.
+///
+/// Note handling takes constant time regardless of the number of voices. A
+/// table maps each note to the voice playing it. Voices are kept on lists:
+/// the free voices, the voices which are releasing (in the order in which they
+/// were released), and all voices in use (in the order in which their notes
+/// started). A new note takes a free voice if there is one. Otherwise a voice
+/// is stolen according to the steal_policy. A stolen voice which is still
+/// sounding is first quenched (faded out over envelope::quench_time) to avoid
+/// a click; the new note starts in the first block after the quench
+/// completes.
+///
+/// Only the voices which are in use are rendered. The oscillator lanes of the
+/// voices in use are recorded in a bitmask which is updated as voices are
+/// started and freed, so an idle voice costs nothing beyond the advance of its
+/// oscillator phases.
+///
+/// If a thread_pool is supplied with set_thread_pool(), the voices are divided
+/// into chunks of #chunk_voices and each chunk which contains an active voice
+/// is rendered as a separate task. The chunks' outputs are summed in chunk
+/// order after all of the tasks have completed. The sum is exact integer
+/// arithmetic, so the result is bit-identical to rendering on one thread
+/// regardless of the number of threads.
+///
+/// \tparam SampleRate  The sample rate in Hertz.
+/// \tparam Traits  The oscillator traits.
+/// \tparam Polyphony  The number of voices.
+template <unsigned SampleRate, typename Traits, size_t Polyphony = 8>
 class voice_assigner {
 public:
-  voice_assigner () = default;
+  static constexpr auto polyphony = Polyphony;
+  /// The value returned by note() for a voice with no note.
+  static constexpr auto no_note = std::numeric_limits<unsigned>::max ();
+  /// The number of voices rendered by each task when using a thread_pool.
+  static constexpr auto chunk_voices = size_t{32};
+
+  voice_assigner ();
 
   void note_on (unsigned note);
   void note_off (unsigned note);
 
-  double tick ();
+  /// Fills the buffer \p out with the mixed output of all of the voices.
+  void render (span<double> out);
+  /// Fills the buffer \p out with the mixed output of all of the voices
+  /// saturated to the range [-1, 1]. Only integer arithmetic is used.
+  void render (span<amplitude> out);
+
+  double tick () {
+    double result;
+    this->render (span<double>{&result, 1U});
+    return result;
+  }
 
   void set_wavetable (wavetable<Traits> const *w);
+  void set_wavetable (mipmap_wavetable<Traits> const *w);
   void set_envelope (typename envelope<SampleRate>::phase stage, double value);
+  void set_steal_policy (steal_policy const p) noexcept { policy_ = p; }
+  /// Renders the voices using the threads of \p pool or, if it is null, on the
+  /// calling thread alone. The pool must outlive its use by the assigner.
+  void set_thread_pool (thread_pool *const pool) noexcept { pool_ = pool; }
 
-  uint16_t active_voices () const;
+  /// Returns a bitmask which describes the active voices. Bit 0 (LSB)
+  /// corresponds to the first voice, bit 1 to the second, and so on.
+  std::bitset<Polyphony> active_voices () const;
+  /// Returns the note assigned to voice \p v or #no_note. A voice which is
+  /// being quenched reports the note it will play next.
+  unsigned note (size_t const v) const noexcept { return notes_[v]; }
 
 private:
-  static constexpr auto unassigned = std::numeric_limits<unsigned>::max ();
-  struct vm {
-    using wt = wavetable<Traits>;
-    voice<SampleRate, Traits, wt> v;
-    unsigned note = unassigned;
+  using voice_type = voice<SampleRate, Traits>;
+  using list_type = details::index_list<Polyphony>;
+  using index = typename list_type::index;
+  static constexpr auto none = list_type::none;
+  static constexpr auto lanes = Polyphony * voice_type::oscillators;
+  /// The number of MIDI note numbers.
+  static constexpr auto notes = size_t{128};
+  static constexpr auto unassigned = no_note;
+  /// The voices are summed in an accumulator that is wide enough that the
+  /// total can never overflow.
+  using accumulator = sinteger_t<64>;
+  static constexpr auto chunks = (Polyphony + chunk_voices - 1U) / chunk_voices;
+
+  enum class state : uint8_t {
+    free,
+    held,
+    releasing,
+    /// Fading out before starting a new note (or, if that note has already
+    /// been released, before becoming free).
+    quenching,
   };
-  std::array<vm, 8> voices_;
-  unsigned next_ = 0U;
+
+  oscillator_bank<SampleRate, Traits, lanes> oscillators_;
+  std::array<envelope<SampleRate>, Polyphony> envelopes_;
+  /// The note being played by each voice (or, if quenching, the note it will
+  /// play next).
+  std::array<unsigned, Polyphony> notes_;
+  std::array<state, Polyphony> states_;
+  /// The voice playing each note.
+  std::array<index, notes> note_voice_;
+  list_type free_;
+  list_type releasing_;
+  list_type quenching_;
+  /// All voices which aren't free, oldest first.
+  list_type age_;
+  /// The oscillator lanes of the voices which aren't free.
+  std::bitset<lanes> active_lanes_;
+  steal_policy policy_ = steal_policy::oldest;
+  thread_pool *pool_ = nullptr;
+
+  /// Starts voice \p v playing note notes_[v].
+  void start (index v);
+  /// Chooses a voice to be stolen when none is free.
+  index victim () const;
+  /// Detaches voice \p v from its current note and returns it to the free list.
+  void make_free (index v);
+  /// Sets or clears the bits of active_lanes_ which belong to voice \p v.
+  void set_active (index const v, bool const active) {
+    for (auto osc = size_t{0}; osc < voice_type::oscillators; ++osc) {
+      active_lanes_[v * voice_type::oscillators + osc] = active;
+    }
+  }
+  /// Frees voices whose release has ended and starts the notes of those which
+  /// have finished quenching.
+  void update_voices ();
+  /// Renders the next out.size() samples from each of the active voices and
+  /// sums them into \p out. out.size() must not exceed voice_type::block_size.
+  void mix_voices (span<accumulator> out);
+  /// Renders voice \p v from the oscillator output in osc_out_ and adds it to
+  /// \p out.
+  void mix_voice (index v, span<accumulator> out);
+  /// As mix_voices() but dividing the work between the threads of pool_.
+  void mix_voices_parallel (span<accumulator> out);
+  /// Renders the voices of chunk \p c into chunk_out_[c]. Called concurrently
+  /// for different chunks.
+  void render_chunk (size_t c, size_t n);
+
+  /// The output of oscillators_: sample k of lane l is osc_out_[k * lanes + l].
+  alignas (64) std::array<amplitude, lanes * voice_type::block_size> osc_out_;
+  /// The output of each chunk when rendering with pool_.
+  std::array<std::array<accumulator, voice_type::block_size>, chunks>
+      chunk_out_;
+  /// The chunks which contain an active voice.
+  std::array<size_t, chunks> busy_chunks_;
 };
 
+// (ctor)
+// ~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+voice_assigner<SampleRate, Traits, Polyphony>::voice_assigner () {
+  notes_.fill (unassigned);
+  states_.fill (state::free);
+  note_voice_.fill (none);
+  for (auto v = index{0}; v < Polyphony; ++v) {
+    free_.push_back (v);
+  }
+}
+
+// start
+// ~~~~~
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::start (index const v) {
+  auto const f = voice_type::note_frequencies (notes_[v]);
+  for (auto osc = size_t{0}; osc < voice_type::oscillators; ++osc) {
+    oscillators_.set_frequency (v * voice_type::oscillators + osc, f[osc]);
+  }
+  envelopes_[v].note_on ();
+  states_[v] = state::held;
+}
+
+// victim
+// ~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+auto voice_assigner<SampleRate, Traits, Polyphony>::victim () const -> index {
+  assert (free_.empty () && !age_.empty ());
+  switch (policy_) {
+  case steal_policy::oldest: break;
+  case steal_policy::releasing_first:
+    if (!releasing_.empty ()) {
+      return releasing_.front ();
+    }
+    break;
+  case steal_policy::quietest: {
+    // Levels change with every sample so this policy needs a scan.
+    auto result = age_.front ();
+    for (auto v = age_.front (); v != none; v = age_.next (v)) {
+      if (envelopes_[v].level () < envelopes_[result].level ()) {
+        result = v;
+      }
+    }
+    return result;
+  }
+  }
+  return age_.front ();
+}
+
+// make free
+// ~~~~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::make_free (index const v) {
+  switch (states_[v]) {
+  case state::free: return;
+  case state::held: break;
+  case state::releasing: releasing_.remove (v); break;
+  case state::quenching: quenching_.remove (v); break;
+  }
+  if (notes_[v] != unassigned && note_voice_[notes_[v]] == v) {
+    note_voice_[notes_[v]] = none;
+  }
+  notes_[v] = unassigned;
+  age_.remove (v);
+  states_[v] = state::free;
+  free_.push_back (v);
+  this->set_active (v, false);
+}
+
 // note on
 // ~~~~~~~
-template <unsigned SampleRate, typename Traits>
-void voice_assigner<SampleRate, Traits>::note_on (unsigned const note) {
-  if (voices_[next_].note != unassigned) {
-    voices_[next_].v.note_off ();
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::note_on (
+    unsigned const note) {
+  assert (note < notes);
+  if (note >= notes) {
+    return;
   }
-  voices_[next_].note = note;
-  voices_[next_].v.note_on (note);
-  ++next_;
-  if (next_ >= voices_.size ()) {
-    next_ = 0U;
+  if (auto const v = note_voice_[note]; v != none) {
+    // The note is already sounding: retrigger its voice.
+    if (states_[v] == state::releasing) {
+      releasing_.remove (v);
+      envelopes_[v].note_on ();
+      states_[v] = state::held;
+    } else if (states_[v] == state::held) {
+      envelopes_[v].note_on ();
+    }
+    age_.remove (v);
+    age_.push_back (v);
+    return;
+  }
+
+  index v;
+  if (!free_.empty ()) {
+    v = free_.front ();
+    free_.remove (v);
+  } else {
+    v = this->victim ();
+    auto const quench = envelopes_[v].active () &&
+                        !envelopes_[v].level ().is_zero ();
+    auto const was_quenching = states_[v] == state::quenching;
+    this->make_free (v);
+    free_.remove (v);
+    if (quench || was_quenching) {
+      notes_[v] = note;
+      note_voice_[note] = v;
+      age_.push_back (v);
+      envelopes_[v].quench ();
+      states_[v] = state::quenching;
+      quenching_.push_back (v);
+      this->set_active (v, true);
+      return;
+    }
   }
+  notes_[v] = note;
+  note_voice_[note] = v;
+  age_.push_back (v);
+  this->set_active (v, true);
+  this->start (v);
 }
 
 // note off
 // ~~~~~~~~
-template <unsigned SampleRate, typename Traits>
-void voice_assigner<SampleRate, Traits>::note_off (unsigned const note) {
-  for (auto &voice : voices_) {
-    if (voice.note == note) {
-      voice.v.note_off ();
-      voice.note = unassigned;
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::note_off (
+    unsigned const note) {
+  if (note >= notes) {
+    return;
+  }
+  auto const v = note_voice_[note];
+  if (v == none) {
+    return;
+  }
+  switch (states_[v]) {
+  case state::held:
+    envelopes_[v].note_off ();
+    states_[v] = state::releasing;
+    releasing_.push_back (v);
+    break;
+  case state::quenching:
+    // The note was released before it started: the voice becomes free once
+    // the quench is complete.
+    note_voice_[note] = none;
+    notes_[v] = unassigned;
+    break;
+  case state::free:
+  case state::releasing: break;
+  }
+}
+
+// update voices
+// ~~~~~~~~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::update_voices () {
+  for (auto v = releasing_.front (); v != none;) {
+    auto const next = releasing_.next (v);
+    if (!envelopes_[v].active ()) {
+      this->make_free (v);
     }
+    v = next;
+  }
+  for (auto v = quenching_.front (); v != none;) {
+    auto const next = quenching_.next (v);
+    if (!envelopes_[v].active ()) {
+      if (notes_[v] == unassigned) {
+        this->make_free (v);
+      } else {
+        quenching_.remove (v);
+        this->start (v);
+      }
+    }
+    v = next;
   }
 }
 
 // active voices
 // ~~~~~~~~~~~~~
-template <unsigned SampleRate, typename Traits>
-uint16_t voice_assigner<SampleRate, Traits>::active_voices () const {
-  auto result = uint16_t{0};
-  auto count = 0U;
-  for (vm const &voice : voices_) {
-    result |= static_cast<uint16_t> (voice.v.active ()) << count++;
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+std::bitset<Polyphony>
+voice_assigner<SampleRate, Traits, Polyphony>::active_voices () const {
+  std::bitset<Polyphony> result;
+  for (auto v = size_t{0}; v < Polyphony; ++v) {
+    result[v] = envelopes_[v].active ();
   }
   return result;
 }
 
 // set wavetable
 // ~~~~~~~~~~~~~
-template <unsigned SampleRate, typename Traits>
-void voice_assigner<SampleRate, Traits>::set_wavetable (
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::set_wavetable (
     wavetable<Traits> const *const w) {
-  for (auto &voice : voices_) {
-    voice.v.set_wavetable (w);
-  }
+  oscillators_.set_wavetable (w);
+}
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::set_wavetable (
+    mipmap_wavetable<Traits> const *const w) {
+  oscillators_.set_wavetable (w);
 }
 
 // set envelope
 // ~~~~~~~~~~~~
-template <unsigned SampleRate, typename Traits>
-void voice_assigner<SampleRate, Traits>::set_envelope (
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::set_envelope (
     typename envelope<SampleRate>::phase const stage, double const value) {
-  for (auto &voice : voices_) {
-    voice.v.set_envelope (stage, value);
+  for (auto &env : envelopes_) {
+    env.set (stage, value);
   }
 }
 
-// tick
-// ~~~~
-template <unsigned SampleRate, typename Traits>
-double voice_assigner<SampleRate, Traits>::tick () {
-  return std::accumulate (std::begin (voices_), std::end (voices_), 0.0,
-                          [] (double acc, vm &voice) {
-                            return acc + voice.v.tick ().as_double ();
-                          });
+// mix voice
+// ~~~~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::mix_voice (
+    index const v, span<accumulator> const out) {
+  constexpr auto oscillators = voice_type::oscillators;
+  auto &env = envelopes_[v];
+  if (!env.active ()) {
+    return;
+  }
+  auto const n = out.size ();
+  std::array<amplitude, voice_type::block_size> buffer;
+  auto const voice_out = span<amplitude>{buffer.data (), n};
+  // The bank's output is frame-major: the voice's oscillators are adjacent
+  // columns of each frame.
+  voice_type::mix (osc_out_.data () + size_t{v} * oscillators, lanes,
+                   voice_out);
+  env.render (voice_out);
+  std::transform (std::begin (out), std::end (out), std::begin (voice_out),
+                  std::begin (out),
+                  [] (accumulator const acc, amplitude const a) {
+                    return acc + a.get ();
+                  });
+}
+
+// mix voices
+// ~~~~~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::mix_voices (
+    span<accumulator> const out) {
+  auto const n = out.size ();
+  assert (n <= voice_type::block_size);
+  if (chunks > 1U && pool_ != nullptr && pool_->concurrency () > 1U) {
+    this->mix_voices_parallel (out);
+  } else {
+    std::fill (std::begin (out), std::end (out), accumulator{0});
+    oscillators_.render (span<amplitude>{osc_out_.data (), lanes * n},
+                         active_lanes_);
+    for (auto v = age_.front (); v != none; v = age_.next (v)) {
+      this->mix_voice (v, out);
+    }
+  }
+  this->update_voices ();
+}
+
+// mix voices parallel
+// ~~~~~~~~~~~~~~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::mix_voices_parallel (
+    span<accumulator> const out) {
+  auto const n = out.size ();
+  // Fork: one task for each chunk that has work to do.
+  auto busy = size_t{0};
+  for (auto c = size_t{0}; c < chunks; ++c) {
+    auto const last = std::min (Polyphony, (c + 1U) * chunk_voices);
+    for (auto v = c * chunk_voices; v < last; ++v) {
+      if (active_lanes_[v * voice_type::oscillators]) {
+        busy_chunks_[busy++] = c;
+        break;
+      }
+    }
+  }
+  pool_->run (busy, [this, n] (size_t const task) noexcept {
+    this->render_chunk (busy_chunks_[task], n);
+  });
+
+  // Join: sum the chunks in a fixed order. Idle chunks still advance their
+  // oscillators' phases.
+  std::fill (std::begin (out), std::end (out), accumulator{0});
+  auto next_busy = size_t{0};
+  for (auto c = size_t{0}; c < chunks; ++c) {
+    if (next_busy < busy && busy_chunks_[next_busy] == c) {
+      ++next_busy;
+      std::transform (std::begin (out), std::end (out),
+                      std::begin (chunk_out_[c]), std::begin (out),
+                      [] (accumulator const a, accumulator const b) {
+                        return a + b;
+                      });
+    } else {
+      auto const first = c * chunk_voices;
+      auto const last = std::min (Polyphony, first + chunk_voices);
+      oscillators_.render (span<amplitude>{osc_out_.data (), lanes * n},
+                           active_lanes_, first * voice_type::oscillators,
+                           last * voice_type::oscillators);
+    }
+  }
+}
+
+// render chunk
+// ~~~~~~~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::render_chunk (
+    size_t const c, size_t const n) {
+  auto const first = c * chunk_voices;
+  auto const last = std::min (Polyphony, first + chunk_voices);
+  oscillators_.render (span<amplitude>{osc_out_.data (), lanes * n},
+                       active_lanes_, first * voice_type::oscillators,
+                       last * voice_type::oscillators);
+  auto const out = span<accumulator>{chunk_out_[c].data (), n};
+  std::fill (std::begin (out), std::end (out), accumulator{0});
+  for (auto v = first; v < last; ++v) {
+    if (active_lanes_[v * voice_type::oscillators]) {
+      this->mix_voice (static_cast<index> (v), out);
+    }
+  }
+}
+
+// render
+// ~~~~~~
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::render (
+    span<double> const out) {
+  constexpr auto block_size = voice_type::block_size;
+  constexpr auto scale =
+      1.0 / static_cast<double> (accumulator{1} << amplitude::fractional_bits);
+  std::array<accumulator, block_size> acc;
+  for (auto first = size_t{0}, size = out.size (); first < size;) {
+    auto const n = std::min (block_size, size - first);
+    this->mix_voices (span<accumulator>{acc.data (), n});
+    std::transform (std::begin (acc), std::begin (acc) + n,
+                    std::begin (out) + first, [] (accumulator const a) {
+                      return static_cast<double> (a) * scale;
+                    });
+    first += n;
+  }
+}
+
+template <unsigned SampleRate, typename Traits, size_t Polyphony>
+void voice_assigner<SampleRate, Traits, Polyphony>::render (
+    span<amplitude> const out) {
+  constexpr auto block_size = voice_type::block_size;
+  static constexpr auto one = accumulator{1} << amplitude::fractional_bits;
+  std::array<accumulator, block_size> acc;
+  for (auto first = size_t{0}, size = out.size (); first < size;) {
+    auto const n = std::min (block_size, size - first);
+    this->mix_voices (span<accumulator>{acc.data (), n});
+    std::transform (std::begin (acc), std::begin (acc) + n,
+                    std::begin (out) + first, [] (accumulator const a) {
+                      return amplitude::frombits (
+                          static_cast<uinteger_t<amplitude::total_bits>> (
+                              std::clamp (a, -one, one)));
+                    });
+    first += n;
+  }
 }
 
 }  // end namespace synth
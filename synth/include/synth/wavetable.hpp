@@ -5,8 +5,22 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
 
 #include "synth/fixed.hpp"
+#include "synth/lerp.hpp"
+#include "synth/simd.hpp"
+#include "synth/span.hpp"
+
+#if !defined(__clang_major__) || __clang_major__ < 7
+#define NONNULL
+#else
+#define NONNULL _Nonnull
+#endif
 
 namespace synth {
 
@@ -23,6 +37,54 @@ constexpr inline double half_pi = pi / 2.0;
 #endif
 constexpr inline double two_pi = 2.0 * pi;
 
+namespace details {
+
+/// Evaluates the Taylor series of sin(x). Accurate to double precision for
+/// |x| <= π/4.
+constexpr double sin_series (double const x) noexcept {
+  auto const x2 = x * x;
+  auto term = x;
+  auto sum = x;
+  for (auto n = 1U; n < 10U; ++n) {
+    term *= -x2 / static_cast<double> ((2U * n) * (2U * n + 1U));
+    sum += term;
+  }
+  return sum;
+}
+/// Evaluates the Taylor series of cos(x). Accurate to double precision for
+/// |x| <= π/4.
+constexpr double cos_series (double const x) noexcept {
+  auto const x2 = x * x;
+  auto term = 1.0;
+  auto sum = 1.0;
+  for (auto n = 1U; n < 10U; ++n) {
+    term *= -x2 / static_cast<double> ((2U * n - 1U) * (2U * n));
+    sum += term;
+  }
+  return sum;
+}
+
+/// A constexpr sine function which allows tables to be generated at compile
+/// time. Intended for arguments of modest size such as those in [0, 2π).
+constexpr double sin (double x) noexcept {
+  // Reduce x to [0, 2π) and then to [-π/4, π/4] about the nearest multiple of
+  // π/2.
+  x -= static_cast<double> (static_cast<sinteger_t<64>> (x / two_pi)) * two_pi;
+  if (x < 0.0) {
+    x += two_pi;
+  }
+  auto const quadrant = static_cast<unsigned> (x / half_pi + 0.5);
+  auto const r = x - static_cast<double> (quadrant) * half_pi;
+  switch (quadrant % 4U) {
+  case 0U: return sin_series (r);
+  case 1U: return cos_series (r);
+  case 2U: return -sin_series (r);
+  default: return -cos_series (r);
+  }
+}
+
+}  // end namespace details
+
 using frequency = ufixed<32, 25>;  // 32-bit unsigned fixed, UQ25.7.
 
 static_assert (std::is_same_v<frequency::value_type, uint32_t>);
@@ -33,6 +95,17 @@ static_assert (mask_v<frequency::integral_bits> >= 20U * 1000U,
 // some of our precious bits.
 using amplitude = fixed<24, 1>;
 
+/// The methods by which a wavetable can compute the amplitude for a phase which
+/// lies between two of its entries.
+enum class interpolation : uint8_t {
+  /// The phase is truncated to the preceding entry.
+  none,
+  /// Linear interpolation between the two neighbouring entries.
+  linear,
+  /// Cubic Hermite interpolation using the four surrounding entries.
+  cubic,
+};
+
 struct nco_traits {
   /// The number of entries in a wavetable is 2^wavetable_N.
   static constexpr auto wavetable_N = 11U;
@@ -40,8 +113,24 @@ struct nco_traits {
   /// Phase accumulation is performed in an M-bit integer register.
   static constexpr auto M = 32U;
   static_assert (M >= wavetable_N);
+
+  /// The wavetable lookup method. This member is optional: traits which do
+  /// not define it use interpolation::none.
+  static constexpr auto interpolation = synth::interpolation::none;
 };
 
+namespace details {
+
+template <typename Traits, typename = void>
+struct traits_interpolation
+    : std::integral_constant<interpolation, interpolation::none> {};
+template <typename Traits>
+struct traits_interpolation<Traits,
+                            std::void_t<decltype (Traits::interpolation)>>
+    : std::integral_constant<interpolation, Traits::interpolation> {};
+
+}  // end namespace details
+
 /// A collection of types and constants that are derived from the specified
 /// traits type to produce types and constants that are used by both the
 /// oscillator and wavetables.
@@ -65,6 +154,13 @@ struct oscillator_info {
       ufixed<Traits::M, Traits::M - accumulator_fractional_bits>;
   static_assert (phase_index_type::total_bits == Traits::M);
   static_assert (phase_index_type::integral_bits == Traits::wavetable_N);
+
+  /// The method used to compute values which lie between wavetable entries.
+  static constexpr auto interpolation =
+      details::traits_interpolation<Traits>::value;
+  static_assert (interpolation == synth::interpolation::none ||
+                     accumulator_fractional_bits > 0U,
+                 "Interpolation requires phase bits below the table index");
 };
 
 template <typename Traits>
@@ -72,83 +168,253 @@ class wavetable {
 public:
   /// The traits type with which this wavetable is associated.
   using traits = Traits;
+  using phase_index_type = typename oscillator_info<Traits>::phase_index_type;
+
+  /// True if phase and amplitude values are both 32-bit integers whose natural
+  /// modulo arithmetic is that of the phase accumulator. This is the
+  /// requirement for the vector forms of phase_to_amplitude().
+  static constexpr bool vectorizable =
+      Traits::M == 32U &&
+      sizeof (typename phase_index_type::value_type) == sizeof (int32_t) &&
+      sizeof (amplitude) == sizeof (int32_t);
 
   /// \tparam Function  A function with signature equivalent to double(double).
   /// \param f A function f(θ) which will be invoked with θ from [0..2π).
+  ///
+  /// If \p f is constexpr, the wavetable may be computed at compile time.
   template <typename Function>
-  explicit wavetable (Function f) {
+  constexpr explicit wavetable (Function f) {
     // Initialize the lookup table with exactly one cycle of our waveform.
-    auto k = size_t{0};
     constexpr double delta = two_pi / table_size_;
-    std::generate (std::begin (y_), std::end (y_), [&] {
-      return amplitude::fromfp (f (static_cast<double> (k++) * delta));
-    });
+    for (auto k = size_t{0}; k < table_size_; ++k) {
+      y_[k] = amplitude::fromfp (f (static_cast<double> (k) * delta));
+    }
+  }
+  /// \param samples  Exactly one cycle of the waveform: 2^wavetable_N values
+  ///   in the range [-1, 1].
+  constexpr explicit wavetable (span<double const> const samples) {
+    assert (samples.size () == table_size_);
+    for (auto k = size_t{0}; k < table_size_; ++k) {
+      y_[k] = amplitude::fromfp (samples[k]);
+    }
   }
 
   constexpr amplitude phase_to_amplitude (
-      typename oscillator_info<Traits>::phase_index_type const phase)
-      const noexcept {
+      phase_index_type const phase) const noexcept {
     // The most significant (wavetable_N) bits of the phase accumulator output
     // provide the index into the lookup table.
-    auto const index = static_cast<uinteger_t<Traits::wavetable_N>> (
-        (phase.get () >> oscillator_info<Traits>::accumulator_fractional_bits) &
-        mask_v<Traits::wavetable_N>);
-
+    auto const index = wavetable::index (phase.get ());
     assert (index < table_size_);
-    return y_[index];
+    if constexpr (interpolation_ == interpolation::none) {
+      return y_[index];
+    } else {
+      // The remaining bits give the position between entry 'index' and its
+      // successor.
+      auto const r = ratio_type::frombits (
+          static_cast<typename ratio_type::value_type> (phase.get () &
+                                                        mask_v<shift_>));
+      if constexpr (interpolation_ == interpolation::linear) {
+        return lerp_b (y_[wrap (index + 1U)], y_[index], r);
+      } else {
+        return hermite (y_[wrap (index + table_size_ - 1U)], y_[index],
+                        y_[wrap (index + 1U)], y_[wrap (index + 2U)], r);
+      }
+    }
   }
 
+  /// Computes the amplitude for each of the phase values in \p phases and
+  /// writes them to the corresponding element of \p out.
+  void phase_to_amplitude (span<phase_index_type const> phases,
+                           span<amplitude> out) const noexcept;
+
+#if defined(__AVX2__)
+  /// Computes the amplitude for each of the 8 phase values in \p phase. May
+  /// only be used if the wavetable is vectorizable.
+  __m256i phase_to_amplitude (__m256i const phase) const noexcept {
+    return wavetable::lookup (y_.data (), phase, _mm256_setzero_si256 ());
+  }
+  /// Looks up the 8 phase values in \p phase in a group of tables which are
+  /// contiguous in memory starting at \p base. The index of each lane is
+  /// displaced by the corresponding element of \p offset, which must be a
+  /// multiple of the table size.
+  static __m256i lookup (amplitude const* NONNULL base, __m256i phase,
+                         __m256i offset) noexcept;
+#endif
+#if defined(__AVX512F__)
+  /// Computes the amplitude for each of the 16 phase values in \p phase. May
+  /// only be used if the wavetable is vectorizable.
+  __m512i phase_to_amplitude (__m512i const phase) const noexcept {
+    SYNTH_AVX512_BEGIN
+    return wavetable::lookup (y_.data (), phase, _mm512_setzero_si512 ());
+    SYNTH_AVX512_END
+  }
+  /// Looks up the 16 phase values in \p phase in a group of tables which are
+  /// contiguous in memory starting at \p base. The index of each lane is
+  /// displaced by the corresponding element of \p offset, which must be a
+  /// multiple of the table size.
+  static __m512i lookup (amplitude const* NONNULL base, __m512i phase,
+                         __m512i offset) noexcept;
+#endif
+
   constexpr auto begin () const { return std::begin (y_); }
   constexpr auto end () const { return std::end (y_); }
+  constexpr amplitude const* data () const noexcept { return y_.data (); }
+
+  /// The number of entries in the wavetable.
+  static constexpr auto size () noexcept { return table_size_; }
 
 private:
   // The number of entries in the wavetable is 2^N.
   static constexpr auto N = Traits::wavetable_N;
   static constexpr auto table_size_ = size_t{1} << N;
-  std::array<amplitude, table_size_> y_;
+  std::array<amplitude, table_size_> y_{};
+
+  static constexpr auto interpolation_ = oscillator_info<Traits>::interpolation;
+  /// The number of phase bits below the table index.
+  static constexpr auto shift_ =
+      oscillator_info<Traits>::accumulator_fractional_bits;
+  /// The position of a phase between two table entries.
+  using ratio_type = ufixed<shift_, 0>;
+
+  static constexpr size_t index (
+      typename phase_index_type::value_type const phase) noexcept {
+    return static_cast<size_t> ((phase >> shift_) & mask_v<N>);
+  }
+  static constexpr size_t wrap (size_t const index) noexcept {
+    return index & mask_v<N>;
+  }
 };
 
+// phase to amplitude
+// ~~~~~~~~~~~~~~~~~~
 template <typename Traits>
-wavetable<Traits> const sine{
-    [] (double const theta) { return std::sin (theta); }};
+void wavetable<Traits>::phase_to_amplitude (
+    span<phase_index_type const> const phases,
+    span<amplitude> const out) const noexcept {
+  assert (phases.size () == out.size ());
+  auto const size = std::min (phases.size (), out.size ());
+  auto ctr = size_t{0};
+  if constexpr (vectorizable) {
+#if defined(__AVX512F__)
+    SYNTH_AVX512_BEGIN
+    for (; ctr + 16U <= size; ctr += 16U) {
+      _mm512_storeu_si512 (
+          out.data () + ctr,
+          this->phase_to_amplitude (_mm512_loadu_si512 (phases.data () + ctr)));
+    }
+    SYNTH_AVX512_END
+#endif
+#if defined(__AVX2__)
+    for (; ctr + 8U <= size; ctr += 8U) {
+      _mm256_storeu_si256 (
+          reinterpret_cast<__m256i*> (out.data () + ctr),
+          this->phase_to_amplitude (_mm256_loadu_si256 (
+              reinterpret_cast<__m256i const*> (phases.data () + ctr))));
+    }
+#endif
+  }
+  for (; ctr < size; ++ctr) {
+    out[ctr] = this->phase_to_amplitude (phases[ctr]);
+  }
+}
 
+#if defined(__AVX2__)
+// lookup
+// ~~~~~~
 template <typename Traits>
-wavetable<Traits> const square{
-    [] (double const theta) { return theta <= pi ? 1.0 : -1.0; }};
+__m256i wavetable<Traits>::lookup (amplitude const* const NONNULL base,
+                                   __m256i const phase,
+                                   __m256i const offset) noexcept {
+  static_assert (vectorizable);
+  auto const* const table = reinterpret_cast<int const*> (base);
+  __m256i const mask = _mm256_set1_epi32 (static_cast<int> (mask_v<N>));
+  __m256i const index =
+      _mm256_and_si256 (_mm256_srli_epi32 (phase, shift_), mask);
+  __m256i const y0 = _mm256_i32gather_epi32 (
+      table, _mm256_add_epi32 (index, offset), sizeof (amplitude));
+  if constexpr (interpolation_ == interpolation::none) {
+    return y0;
+  } else {
+    // Returns the table entries at index+k.
+    auto const at = [&] (int const k) {
+      return _mm256_i32gather_epi32 (
+          table,
+          _mm256_add_epi32 (
+              _mm256_and_si256 (_mm256_add_epi32 (index, _mm256_set1_epi32 (k)),
+                                mask),
+              offset),
+          sizeof (amplitude));
+    };
+    __m256i const r = _mm256_and_si256 (
+        phase, _mm256_set1_epi32 (static_cast<int> (mask_v<shift_>)));
+    if constexpr (interpolation_ == interpolation::linear) {
+      return details::lerp_b<shift_> (at (1), y0, r);
+    } else {
+      return details::hermite<amplitude::total_bits, shift_> (at (-1), y0,
+                                                              at (1), at (2), r);
+    }
+  }
+}
+#endif  // __AVX2__
 
+#if defined(__AVX512F__)
+SYNTH_AVX512_BEGIN
+// lookup
+// ~~~~~~
 template <typename Traits>
-wavetable<Traits> const triangle{[] (double const theta) {
-  return (theta <= pi ? theta : (two_pi - theta)) / half_pi - 1.0;
-}};
+__m512i wavetable<Traits>::lookup (amplitude const* const NONNULL base,
+                                   __m512i const phase,
+                                   __m512i const offset) noexcept {
+  static_assert (vectorizable);
+  __m512i const mask = _mm512_set1_epi32 (static_cast<int> (mask_v<N>));
+  __m512i const index =
+      _mm512_and_si512 (_mm512_srli_epi32 (phase, shift_), mask);
+  __m512i const y0 = _mm512_i32gather_epi32 (_mm512_add_epi32 (index, offset),
+                                             base, sizeof (amplitude));
+  if constexpr (interpolation_ == interpolation::none) {
+    return y0;
+  } else {
+    // Returns the table entries at index+k.
+    auto const at = [&] (int const k) {
+      return _mm512_i32gather_epi32 (
+          _mm512_add_epi32 (
+              _mm512_and_si512 (_mm512_add_epi32 (index, _mm512_set1_epi32 (k)),
+                                mask),
+              offset),
+          base, sizeof (amplitude));
+    };
+    __m512i const r = _mm512_and_si512 (
+        phase, _mm512_set1_epi32 (static_cast<int> (mask_v<shift_>)));
+    if constexpr (interpolation_ == interpolation::linear) {
+      return details::lerp_b<shift_> (at (1), y0, r);
+    } else {
+      return details::hermite<amplitude::total_bits, shift_> (at (-1), y0,
+                                                              at (1), at (2), r);
+    }
+  }
+}
+SYNTH_AVX512_END
+#endif  // __AVX512F__
 
-template <typename Traits>
-wavetable<Traits> const sawtooth{
-    [] (double const theta) { return theta / pi - 1.0; }};
+// The standard wavetables are computed at compile time so that they can be
+// placed in read-only data rather than being built by static constructors.
 
 template <typename Traits>
-class noise_wavetable {
-public:
-  /// The traits type with which this wavetable is associated.
-  using traits = Traits;
-
-  amplitude phase_to_amplitude (
-      typename oscillator_info<Traits>::phase_index_type const /*phase*/)
-      const noexcept {
-    // A simple Linear congruential generator is used to produce random(ish)
-    // values as our noise source.
-    next_ = next_ * 1103515245 + 12345;
-    return amplitude::frombits (next_);
-  }
+inline constexpr wavetable<Traits> sine{
+    [] (double const theta) { return details::sin (theta); }};
 
-private:
-  static uint32_t next_;
-};
+template <typename Traits>
+inline constexpr wavetable<Traits> square{
+    [] (double const theta) { return theta <= pi ? 1.0 : -1.0; }};
 
 template <typename Traits>
-uint32_t noise_wavetable<Traits>::next_ = 1;
+inline constexpr wavetable<Traits> triangle{[] (double const theta) {
+  return (theta <= pi ? theta : (two_pi - theta)) / half_pi - 1.0;
+}};
 
 template <typename Traits>
-noise_wavetable<Traits> const noise;
+inline constexpr wavetable<Traits> sawtooth{
+    [] (double const theta) { return theta / pi - 1.0; }};
 
 template <typename Wavetable>
 struct default_wavetable {};
@@ -158,11 +424,6 @@ struct default_wavetable<wavetable<Traits>> {
   wavetable<Traits> const* operator() () { return &sawtooth<Traits>; }
 };
 
-template <typename Traits>
-struct default_wavetable<noise_wavetable<Traits>> {
-  noise_wavetable<Traits> const* operator() () { return &noise<Traits>; }
-};
-
 }  // end namespace synth
 
 #endif  // SYNTH_WAVETABLE_HPP
@@ -0,0 +1,235 @@
+#include "synth/noise.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "synth/simd.hpp"
+
+namespace {
+
+/// The SplitMix64 generator, used to expand a seed into the generators'
+/// state.
+uint64_t splitmix64 (uint64_t& x) noexcept {
+  x += 0x9E3779B97F4A7C15U;
+  auto z = x;
+  z = (z ^ (z >> 30U)) * 0xBF58476D1CE4E5B9U;
+  z = (z ^ (z >> 27U)) * 0x94D049BB133111EBU;
+  return z ^ (z >> 31U);
+}
+
+constexpr uint32_t rotl (uint32_t const x, unsigned const k) noexcept {
+  return (x << k) | (x >> (32U - k));
+}
+
+/// Returns the number of trailing zero bits in \p x, which must not be zero.
+unsigned trailing_zeros (uint32_t x) noexcept {
+  assert (x != 0U);
+#if defined(__GNUC__)
+  return static_cast<unsigned> (__builtin_ctz (x));
+#else
+  auto n = 0U;
+  for (; (x & 1U) == 0U; x >>= 1U) {
+    ++n;
+  }
+  return n;
+#endif
+}
+
+/// Random values are reduced to amplitudes in [-1, 1) by an arithmetic shift.
+constexpr auto white_shift = 32U - 1U - synth::amplitude::fractional_bits;
+
+}  // end anonymous namespace
+
+namespace synth {
+
+// (ctor)
+// ~~~~~~
+noise_generator::noise_generator (uint64_t const seed,
+                                  uint64_t const stream) noexcept {
+  this->seed (seed, stream);
+}
+
+// seed
+// ~~~~
+void noise_generator::seed (uint64_t const seed,
+                            uint64_t const stream) noexcept {
+  auto s = stream;
+  auto x = seed ^ splitmix64 (s);
+  for (auto lane = size_t{0}; lane < lanes; ++lane) {
+    auto const a = splitmix64 (x);
+    auto const b = splitmix64 (x);
+    s_[0][lane] = static_cast<uint32_t> (a);
+    s_[1][lane] = static_cast<uint32_t> (a >> 32U);
+    s_[2][lane] = static_cast<uint32_t> (b);
+    s_[3][lane] = static_cast<uint32_t> (b >> 32U);
+    // xoshiro must not be given an all-zero state.
+    if ((a | b) == 0U) {
+      s_[0][lane] = 1U;
+    }
+  }
+  used_ = lanes;
+  rows_.fill (0);
+  rows_sum_ = 0;
+  counter_ = 0U;
+  lowpass_ = 0;
+}
+
+// set cutoff
+// ~~~~~~~~~~
+void noise_generator::set_cutoff (double const cutoff) noexcept {
+  assert (cutoff > 0.0 && cutoff <= 0.5);
+  auto const k = 1.0 - std::exp (-two_pi * cutoff);
+  coefficient_ = static_cast<uint32_t> (
+      std::lround (k * static_cast<double> (1U << coefficient_bits)));
+}
+
+// step
+// ~~~~
+void noise_generator::step (amplitude* const NONNULL out) noexcept {
+  auto* const s0 = s_[0].data ();
+  auto* const s1 = s_[1].data ();
+  auto* const s2 = s_[2].data ();
+  auto* const s3 = s_[3].data ();
+#if defined(__AVX512F__)
+  static_assert (lanes == 16U);
+  SYNTH_AVX512_BEGIN
+  __m512i a = _mm512_load_si512 (s0);
+  __m512i b = _mm512_load_si512 (s1);
+  __m512i c = _mm512_load_si512 (s2);
+  __m512i d = _mm512_load_si512 (s3);
+  __m512i const r = _mm512_add_epi32 (
+      _mm512_rol_epi32 (_mm512_add_epi32 (a, d), 7), a);
+  __m512i const t = _mm512_slli_epi32 (b, 9);
+  c = _mm512_xor_si512 (c, a);
+  d = _mm512_xor_si512 (d, b);
+  b = _mm512_xor_si512 (b, c);
+  a = _mm512_xor_si512 (a, d);
+  c = _mm512_xor_si512 (c, t);
+  d = _mm512_rol_epi32 (d, 11);
+  _mm512_store_si512 (s0, a);
+  _mm512_store_si512 (s1, b);
+  _mm512_store_si512 (s2, c);
+  _mm512_store_si512 (s3, d);
+  _mm512_storeu_si512 (out, _mm512_srai_epi32 (r, white_shift));
+  SYNTH_AVX512_END
+#elif defined(__AVX2__)
+  static_assert (lanes % 8U == 0U);
+  auto const rol = [] (__m256i const x, int const k) {
+    return _mm256_or_si256 (_mm256_slli_epi32 (x, k),
+                            _mm256_srli_epi32 (x, 32 - k));
+  };
+  for (auto lane = size_t{0}; lane < lanes; lane += 8U) {
+    __m256i a =
+        _mm256_load_si256 (reinterpret_cast<__m256i const*> (s0 + lane));
+    __m256i b =
+        _mm256_load_si256 (reinterpret_cast<__m256i const*> (s1 + lane));
+    __m256i c =
+        _mm256_load_si256 (reinterpret_cast<__m256i const*> (s2 + lane));
+    __m256i d =
+        _mm256_load_si256 (reinterpret_cast<__m256i const*> (s3 + lane));
+    __m256i const r = _mm256_add_epi32 (rol (_mm256_add_epi32 (a, d), 7), a);
+    __m256i const t = _mm256_slli_epi32 (b, 9);
+    c = _mm256_xor_si256 (c, a);
+    d = _mm256_xor_si256 (d, b);
+    b = _mm256_xor_si256 (b, c);
+    a = _mm256_xor_si256 (a, d);
+    c = _mm256_xor_si256 (c, t);
+    d = rol (d, 11);
+    _mm256_store_si256 (reinterpret_cast<__m256i*> (s0 + lane), a);
+    _mm256_store_si256 (reinterpret_cast<__m256i*> (s1 + lane), b);
+    _mm256_store_si256 (reinterpret_cast<__m256i*> (s2 + lane), c);
+    _mm256_store_si256 (reinterpret_cast<__m256i*> (s3 + lane), d);
+    _mm256_storeu_si256 (reinterpret_cast<__m256i*> (out + lane),
+                         _mm256_srai_epi32 (r, white_shift));
+  }
+#else
+  for (auto lane = size_t{0}; lane < lanes; ++lane) {
+    auto const r = rotl (s0[lane] + s3[lane], 7U) + s0[lane];
+    auto const t = s1[lane] << 9U;
+    s2[lane] ^= s0[lane];
+    s3[lane] ^= s1[lane];
+    s1[lane] ^= s2[lane];
+    s0[lane] ^= s3[lane];
+    s2[lane] ^= t;
+    s3[lane] = rotl (s3[lane], 11U);
+    out[lane] = amplitude::frombits (
+        static_cast<uint32_t> (static_cast<int32_t> (r) >> white_shift));
+  }
+#endif  // __AVX512F__
+}
+
+// white
+// ~~~~~
+void noise_generator::white (span<amplitude> const out) noexcept {
+  auto* first = out.begin ();
+  auto* const last = out.end ();
+  // Start with the samples left over from the previous call.
+  auto const n = std::min (lanes - used_, out.size ());
+  first = std::copy_n (pending_.data () + used_, n, first);
+  used_ += n;
+  // Then whole steps.
+  for (; static_cast<size_t> (last - first) >= lanes; first += lanes) {
+    this->step (first);
+  }
+  // Keep whatever the last step does not use.
+  if (first != last) {
+    this->step (pending_.data ());
+    used_ = static_cast<size_t> (last - first);
+    std::copy_n (pending_.data (), used_, first);
+  }
+}
+
+// pink
+// ~~~~
+void noise_generator::pink (span<amplitude> const out) noexcept {
+  static_assert (pink_rows + 1U == 16U, "The sum is scaled by a shift of 4");
+  // Each output sample uses two white values: one to replace a row and one
+  // which is added to the sum of the rows.
+  std::array<amplitude, 128> w;
+  for (auto pos = size_t{0}; pos < out.size ();) {
+    auto const n = std::min (w.size () / 2U, out.size () - pos);
+    this->white (span<amplitude>{w.data (), 2U * n});
+    for (auto k = size_t{0}; k < n; ++k) {
+      // Row r changes every 2^(r+1) samples.
+      ++counter_;
+      auto const row = counter_ == 0U ? pink_rows : trailing_zeros (counter_);
+      if (row < pink_rows) {
+        auto const v = w[2U * k].get ();
+        rows_sum_ += v - rows_[row];
+        rows_[row] = v;
+      }
+      out[pos + k] = amplitude::frombits (
+          static_cast<uint32_t> ((rows_sum_ + w[2U * k + 1U].get ()) >> 4));
+    }
+    pos += n;
+  }
+}
+
+// filtered
+// ~~~~~~~~
+void noise_generator::filtered (span<amplitude> const out) noexcept {
+  this->white (out);
+  auto y = int64_t{lowpass_};
+  for (auto& x : out) {
+    y += ((x.get () - y) * int64_t{coefficient_}) >> coefficient_bits;
+    x = amplitude::frombits (static_cast<uint32_t> (y));
+  }
+  lowpass_ = static_cast<int32_t> (y);
+}
+
+// render
+// ~~~~~~
+void noise_generator::render (span<amplitude> const out) noexcept {
+  switch (color_) {
+  case noise_color::white: this->white (out); break;
+  case noise_color::pink: this->pink (out); break;
+  case noise_color::filtered: this->filtered (out); break;
+  }
+}
+
+}  // end namespace synth
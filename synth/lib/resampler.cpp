@@ -0,0 +1,185 @@
+#include "synth/resampler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "synth/kaiser.hpp"
+#include "synth/wavetable.hpp"
+
+namespace {
+
+/// The Kaiser window parameter used by the filter design: approximately 80dB
+/// of stop band attenuation.
+constexpr auto beta = 8.0;
+
+double sinc (double const x) {
+  return x == 0.0 ? 1.0 : std::sin (synth::pi * x) / (synth::pi * x);
+}
+
+/// Returns the greatest common divisor of the two rates after checking that the
+/// resampler can convert between them.
+unsigned checked_gcd (unsigned const in_rate, unsigned const out_rate) {
+  if (in_rate == 0U || out_rate == 0U) {
+    throw std::invalid_argument{"sample rates must be greater than zero"};
+  }
+  if (!synth::resampler::is_supported (in_rate, out_rate)) {
+    throw std::invalid_argument{"the ratio of the sample rates is too complex"};
+  }
+  return std::gcd (in_rate, out_rate);
+}
+
+/// Returns the dot product of the \p n values at \p a and \p b. \p n must be a
+/// multiple of 8.
+float dot (float const* const a, float const* const b, size_t const n) {
+  assert (n % 8U == 0U);
+#if defined(__AVX2__)
+  __m256 acc = _mm256_setzero_ps ();
+  for (auto k = size_t{0}; k < n; k += 8U) {
+    acc = _mm256_add_ps (
+        acc, _mm256_mul_ps (_mm256_loadu_ps (a + k), _mm256_loadu_ps (b + k)));
+  }
+  __m128 sum = _mm_add_ps (_mm256_castps256_ps128 (acc),
+                           _mm256_extractf128_ps (acc, 1));
+  sum = _mm_add_ps (sum, _mm_movehl_ps (sum, sum));
+  sum = _mm_add_ss (sum, _mm_shuffle_ps (sum, sum, 1));
+  return _mm_cvtss_f32 (sum);
+#else
+  // Eight partial sums allow the compiler to vectorize the loop.
+  std::array<float, 8> acc{};
+  for (auto k = size_t{0}; k < n; k += 8U) {
+    for (auto j = size_t{0}; j < 8U; ++j) {
+      acc[j] += a[k + j] * b[k + j];
+    }
+  }
+  return std::accumulate (std::begin (acc), std::end (acc), 0.0F);
+#endif  // __AVX2__
+}
+
+}  // end anonymous namespace
+
+namespace synth {
+
+// (ctor)
+// ~~~~~~
+resampler::resampler (unsigned const in_rate, unsigned const out_rate,
+                      size_t const taps_per_phase)
+    : in_rate_{in_rate},
+      out_rate_{out_rate},
+      // checked_gcd() throws if the rates can't be converted. l_ is
+      // initialized first so m_ can use std::gcd() directly.
+      l_{out_rate / checked_gcd (in_rate, out_rate)},
+      m_{in_rate / std::gcd (in_rate, out_rate)},
+      taps_{taps_per_phase},
+      phases_ (size_t{l_} * taps_per_phase),
+      history_ (taps_per_phase + block_size) {
+  assert (taps_ >= 8U && taps_ % 8U == 0U);
+
+  // The transition band of the filter (in cycles per input sample) follows
+  // from its length and the Kaiser window's attenuation. It is placed just
+  // below the lower of the two Nyquist frequencies so that nothing aliases.
+  auto const taps = static_cast<double> (taps_);
+  auto const transition =
+      (kaiser_attenuation (beta) - 8.0) / (2.285 * two_pi * taps);
+  auto const nyquist =
+      0.5 * std::min (1.0, static_cast<double> (l_) / static_cast<double> (m_));
+  auto const cutoff = 2.0 * std::max (nyquist - transition / 2.0, 0.1 * nyquist);
+
+  auto const half = taps / 2.0;
+  std::vector<double> h (taps_);
+  for (auto p = size_t{0}; p < l_; ++p) {
+    auto sum = 0.0;
+    for (auto r = size_t{0}; r < taps_; ++r) {
+      // The distance from input sample r of the window to the output sample.
+      auto const d = (half - 1.0) +
+                     static_cast<double> (p) / static_cast<double> (l_) -
+                     static_cast<double> (r);
+      h[r] = cutoff * sinc (cutoff * d) * kaiser (d / half, beta);
+      sum += h[r];
+    }
+    // Normalize each phase for unity gain at DC.
+    std::transform (std::begin (h), std::end (h),
+                    std::begin (phases_) + static_cast<std::ptrdiff_t> (p * taps_),
+                    [sum] (double const c) { return static_cast<float> (c / sum); });
+  }
+  this->reset ();
+}
+
+// is supported
+// ~~~~~~~~~~~~
+bool resampler::is_supported (unsigned const in_rate,
+                              unsigned const out_rate) noexcept {
+  return in_rate > 0U && out_rate > 0U &&
+         out_rate / std::gcd (in_rate, out_rate) <= max_phases;
+}
+
+// reset
+// ~~~~~
+void resampler::reset () noexcept {
+  // The window for the first output (which coincides with the first input
+  // sample) starts half a window before the stream.
+  std::fill (std::begin (history_), std::end (history_), 0.0F);
+  used_ = taps_ / 2U - 1U;
+  position_ = 0;
+  phase_ = 0;
+}
+
+// max output
+// ~~~~~~~~~~
+size_t resampler::max_output (size_t const input) const noexcept {
+  return input * l_ / m_ + 2U;
+}
+
+// process
+// ~~~~~~~
+size_t resampler::process (span<double const> const in,
+                           span<double> const out) noexcept {
+  assert (out.size () >= this->max_output (in.size ()));
+  auto produced = size_t{0};
+  for (auto first = size_t{0}, size = in.size (); first < size;) {
+    auto const n = std::min (block_size, size - first);
+    std::transform (std::begin (in) + static_cast<std::ptrdiff_t> (first),
+                    std::begin (in) + static_cast<std::ptrdiff_t> (first + n),
+                    std::begin (history_) + static_cast<std::ptrdiff_t> (used_),
+                    [] (double const x) { return static_cast<float> (x); });
+    used_ += n;
+    produced += this->run (out.data () + produced);
+    first += n;
+  }
+  return produced;
+}
+
+// run
+// ~~~
+size_t resampler::run (double* const out) noexcept {
+  auto const step = m_ / l_;
+  auto const step_phase = m_ % l_;
+  auto produced = size_t{0};
+  for (; position_ + taps_ <= used_; ++produced) {
+    out[produced] =
+        dot (&phases_[phase_ * taps_], &history_[position_], taps_);
+    position_ += step;
+    phase_ += step_phase;
+    if (phase_ >= l_) {
+      phase_ -= l_;
+      ++position_;
+    }
+  }
+  // Discard the samples which are no longer needed.
+  auto const discard = std::min (position_, used_);
+  std::copy (std::begin (history_) + static_cast<std::ptrdiff_t> (discard),
+             std::begin (history_) + static_cast<std::ptrdiff_t> (used_),
+             std::begin (history_));
+  used_ -= discard;
+  position_ -= discard;
+  return produced;
+}
+
+}  // end namespace synth
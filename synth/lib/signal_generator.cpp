@@ -0,0 +1,218 @@
+#include "synth/signal_generator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "synth/wavetable.hpp"
+
+namespace {
+
+/// Returns sin(2πx). The polynomial is accurate to better than 1e-9 and the
+/// function has no branches so that loops which call it can be vectorized.
+inline double sin_cycles (double x) noexcept {
+  // Reduce x to [-0.5, 0.5] by subtracting the nearest integer. Adding and
+  // subtracting 1.5*2^52 rounds to an integer in the current rounding mode
+  // (|x| must be less than 2^51).
+  constexpr auto round_magic = 6755399441055744.0;
+  x -= (x + round_magic) - round_magic;
+  // Reflect into [-0.25, 0.25] using sin(2πx) = sin(2π(±0.5 - x)).
+  x = std::copysign (0.25 - std::abs (std::abs (x) - 0.25), x);
+  // The Taylor series of sin(t) for t in [-π/2, π/2] up to t^15.
+  auto const t = synth::two_pi * x;
+  auto const t2 = t * t;
+  auto p = -1.0 / 1307674368000.0;
+  p = p * t2 + 1.0 / 6227020800.0;
+  p = p * t2 - 1.0 / 39916800.0;
+  p = p * t2 + 1.0 / 362880.0;
+  p = p * t2 - 1.0 / 5040.0;
+  p = p * t2 + 1.0 / 120.0;
+  p = p * t2 - 1.0 / 6.0;
+  return t + t * t2 * p;
+}
+
+/// Calls f(x, out[k]) for each k in [0, n) where x is first + k. The loop
+/// counter is a 32-bit integer because, unlike a 64-bit integer, its conversion
+/// to double can be vectorized.
+template <typename Function>
+void for_each_sample (double* const NONNULL out, size_t const n,
+                      double const first, Function const f) noexcept {
+  constexpr auto chunk = size_t{1} << 30U;
+  for (auto pos = size_t{0}; pos < n; pos += chunk) {
+    auto const count = static_cast<uint32_t> (std::min (chunk, n - pos));
+    auto const base = first + static_cast<double> (pos);
+    auto* const o = out + pos;
+    for (auto k = uint32_t{0}; k < count; ++k) {
+      f (base + static_cast<double> (static_cast<int32_t> (k)), o[k]);
+    }
+  }
+}
+
+}  // end anonymous namespace
+
+namespace synth {
+
+// (ctor)
+// ~~~~~~
+chirp::chirp (chirp_shape const shape, double const f0, double const f1,
+              size_t const samples, double const sample_rate,
+              double const peak)
+    : shape_{shape}, samples_{samples}, amplitude_{peak} {
+  assert (samples >= 2U && sample_rate > 0.0);
+  auto const intervals = static_cast<double> (samples - 1U);
+  if (shape == chirp_shape::exponential && f0 != f1) {
+    assert (f0 > 0.0 && f1 > 0.0);
+    log_ratio_ = std::log (f1 / f0) / intervals;
+    a_ = f0 / sample_rate / std::expm1 (log_ratio_);
+    powers_.resize (stride);
+    for (auto j = size_t{0}; j < stride; ++j) {
+      powers_[j] = std::expm1 (static_cast<double> (j) * log_ratio_);
+    }
+  } else {
+    // A sweep whose frequency does not change is linear whatever its shape.
+    shape_ = chirp_shape::linear;
+    a_ = f0 / sample_rate;
+    b_ = (f1 - f0) / (2.0 * intervals * sample_rate);
+  }
+}
+
+// render linear
+// ~~~~~~~~~~~~~
+void chirp::render_linear (span<double> const out) const noexcept {
+  auto const a = a_;
+  auto const b = b_;
+  auto const peak = amplitude_;
+  for_each_sample (out.data (), out.size (), static_cast<double> (position_),
+                   [=] (double const x, double& y) {
+                     y = peak * sin_cycles (x * (a + b * (x - 1.0)));
+                   });
+}
+
+// render exponential
+// ~~~~~~~~~~~~~~~~~~
+void chirp::render_exponential (span<double> const out) const noexcept {
+  // The phase of sample n is a*(r^n - 1). Writing n as m*stride + j, r^n - 1
+  // is (R - 1) + R*(r^j - 1) where R = r^(m*stride). This costs one call to
+  // std::expm1() per stride samples and loses no precision when r is close to
+  // 1.
+  auto const a = a_;
+  auto const peak = amplitude_;
+  auto n = position_;
+  for (auto pos = size_t{0}; pos < out.size ();) {
+    auto const j0 = n % stride;
+    auto const count = std::min (stride - j0, out.size () - pos);
+    auto const r1 = std::expm1 (static_cast<double> (n - j0) * log_ratio_);
+    auto const r = r1 + 1.0;
+    auto const* const powers = powers_.data () + j0;
+    auto* const o = out.data () + pos;
+    for (auto k = size_t{0}; k < count; ++k) {
+      o[k] = peak * sin_cycles (a * (r1 + r * powers[k]));
+    }
+    pos += count;
+    n += count;
+  }
+}
+
+// render
+// ~~~~~~
+void chirp::render (span<double> const out) noexcept {
+  auto const n =
+      std::min (out.size (), samples_ - std::min (position_, samples_));
+  if (shape_ == chirp_shape::linear) {
+    this->render_linear (out.first (n));
+  } else {
+    this->render_exponential (out.first (n));
+  }
+  std::fill (out.begin () + n, out.end (), 0.0);
+  position_ += out.size ();
+}
+
+// (ctor)
+// ~~~~~~
+multitone::multitone (span<tone const> const tones, double const sample_rate)
+    : tones_ (tones.begin (), tones.end ()) {
+  assert (sample_rate > 0.0);
+  for (auto& t : tones_) {
+    t.frequency /= sample_rate;
+  }
+}
+
+// render
+// ~~~~~~
+void multitone::render (span<double> const out) noexcept {
+  std::fill (out.begin (), out.end (), 0.0);
+  for (auto const& t : tones_) {
+    for_each_sample (out.data (), out.size (), static_cast<double> (position_),
+                     [t] (double const x, double& y) {
+                       y += t.amplitude *
+                            sin_cycles (t.phase + x * t.frequency);
+                     });
+  }
+  position_ += out.size ();
+}
+
+// (ctor)
+// ~~~~~~
+stepped_sine::stepped_sine (double const f0, double const f1,
+                            size_t const steps, size_t const samples_per_step,
+                            double const sample_rate, double const peak)
+    : per_step_{samples_per_step},
+      amplitude_{peak},
+      increments_ (steps),
+      starts_ (steps) {
+  assert (f0 > 0.0 && f1 > 0.0 && steps >= 2U && samples_per_step > 0U);
+  auto const ratio =
+      std::pow (f1 / f0, 1.0 / static_cast<double> (steps - 1U));
+  auto phase = 0.0;
+  for (auto s = size_t{0}; s < steps; ++s) {
+    increments_[s] =
+        f0 * std::pow (ratio, static_cast<double> (s)) / sample_rate;
+    starts_[s] = phase;
+    phase += increments_[s] * static_cast<double> (samples_per_step);
+    phase -= std::floor (phase);
+  }
+}
+
+// render
+// ~~~~~~
+void stepped_sine::render (span<double> const out) noexcept {
+  auto const end = this->size ();
+  auto n = position_;
+  auto pos = size_t{0};
+  while (pos < out.size () && n < end) {
+    auto const step = n / per_step_;
+    auto const j0 = n % per_step_;
+    auto const count = std::min (per_step_ - j0, out.size () - pos);
+    auto const start = starts_[step];
+    auto const increment = increments_[step];
+    auto const peak = amplitude_;
+    for_each_sample (out.data () + pos, count, static_cast<double> (j0),
+                     [=] (double const x, double& y) {
+                       y = peak * sin_cycles (start + x * increment);
+                     });
+    pos += count;
+    n += count;
+  }
+  std::fill (out.begin () + pos, out.end (), 0.0);
+  position_ += out.size ();
+}
+
+// render
+// ~~~~~~
+void impulse::render (span<double> const out) noexcept {
+  std::fill (out.begin (), out.end (), 0.0);
+  auto const n = out.size ();
+  if (period_ == 0U) {
+    if (position_ == 0U && n > 0U) {
+      out[0] = amplitude_;
+    }
+  } else {
+    for (auto k = (period_ - position_ % period_) % period_; k < n;
+         k += period_) {
+      out[k] = amplitude_;
+    }
+  }
+  position_ += n;
+}
+
+}  // end namespace synth
@@ -0,0 +1,151 @@
+#include "synth/thread_pool.hpp"
+
+#include <cassert>
+#include <limits>
+
+namespace synth {
+
+// (ctor)
+// ~~~~~~
+thread_pool::thread_pool (unsigned const workers)
+    : ranges_{std::make_unique<range[]> (workers + 1U)} {
+  threads_.reserve (workers);
+  for (auto self = size_t{1}; self <= workers; ++self) {
+    threads_.emplace_back ([this, self] { this->worker (self); });
+  }
+}
+
+// (dtor)
+// ~~~~~~
+thread_pool::~thread_pool () noexcept {
+  stop_.store (true);
+  {
+    std::lock_guard<std::mutex> const lock{mutex_};
+    epoch_.fetch_add (1U);
+  }
+  cv_.notify_all ();
+  for (auto& t : threads_) {
+    t.join ();
+  }
+}
+
+// run
+// ~~~
+void thread_pool::run (size_t const tasks, task_function const f,
+                       void* const context) {
+  assert (tasks <= std::numeric_limits<uint32_t>::max ());
+  if (threads_.empty () || tasks <= 1U) {
+    for (auto task = size_t{0}; task < tasks; ++task) {
+      f (context, task);
+    }
+    return;
+  }
+
+  // Divide the tasks evenly between the threads.
+  auto const threads = size_t{this->concurrency ()};
+  for (auto t = size_t{0}; t < threads; ++t) {
+    ranges_[t].bounds.store (
+        pack (tasks * t / threads, tasks * (t + 1U) / threads),
+        std::memory_order_relaxed);
+  }
+  function_ = f;
+  context_ = context;
+  busy_.store (static_cast<unsigned> (threads_.size ()),
+               std::memory_order_relaxed);
+
+  // Start the run. A worker which is about to sleep either sees the new epoch
+  // or is counted by sleeping_ (both are sequentially consistent), so it
+  // cannot miss the notification.
+  epoch_.fetch_add (1U);
+  if (sleeping_.load () > 0U) {
+    { std::lock_guard<std::mutex> const lock{mutex_}; }
+    cv_.notify_all ();
+  }
+
+  this->participate (0U);
+  // Join: wait for the workers to finish their tasks.
+  while (busy_.load (std::memory_order_acquire) > 0U) {
+    std::this_thread::yield ();
+  }
+}
+
+// worker
+// ~~~~~~
+void thread_pool::worker (size_t const self) {
+  auto seen = uint32_t{0};
+  for (;;) {
+    // Wait for the next run.
+    auto spins = 0U;
+    while (epoch_.load (std::memory_order_acquire) == seen) {
+      if (++spins < spin_count) {
+        std::this_thread::yield ();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock{mutex_};
+      sleeping_.fetch_add (1U);
+      cv_.wait (lock, [this, seen] { return epoch_.load () != seen; });
+      sleeping_.fetch_sub (1U);
+    }
+    if (stop_.load ()) {
+      return;
+    }
+    seen = epoch_.load (std::memory_order_acquire);
+    this->participate (self);
+    busy_.fetch_sub (1U, std::memory_order_release);
+  }
+}
+
+// participate
+// ~~~~~~~~~~~
+void thread_pool::participate (size_t const self) {
+  auto const threads = size_t{this->concurrency ()};
+  auto task = size_t{0};
+  for (;;) {
+    if (!this->pop (self, &task)) {
+      auto stolen = false;
+      for (auto k = size_t{1}; k < threads && !stolen; ++k) {
+        stolen = this->steal ((self + k) % threads, &task);
+      }
+      if (!stolen) {
+        return;
+      }
+    }
+    function_ (context_, task);
+  }
+}
+
+// pop
+// ~~~
+bool thread_pool::pop (size_t const self, size_t* const task) {
+  auto& bounds = ranges_[self].bounds;
+  auto b = bounds.load (std::memory_order_relaxed);
+  for (;;) {
+    if (first (b) >= last (b)) {
+      return false;
+    }
+    if (bounds.compare_exchange_weak (b, pack (first (b) + 1U, last (b)),
+                                      std::memory_order_relaxed)) {
+      *task = first (b);
+      return true;
+    }
+  }
+}
+
+// steal
+// ~~~~~
+bool thread_pool::steal (size_t const victim, size_t* const task) {
+  auto& bounds = ranges_[victim].bounds;
+  auto b = bounds.load (std::memory_order_relaxed);
+  for (;;) {
+    if (first (b) >= last (b)) {
+      return false;
+    }
+    if (bounds.compare_exchange_weak (b, pack (first (b), last (b) - 1U),
+                                      std::memory_order_relaxed)) {
+      *task = last (b) - 1U;
+      return true;
+    }
+  }
+}
+
+}  // end namespace synth
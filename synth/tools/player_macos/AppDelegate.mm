@@ -1,16 +1,34 @@
 #import "AppDelegate.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <cinttypes>
+#include <vector>
 
 #import <AudioToolbox/AudioToolbox.h>
+#include <mach/mach_time.h>
 
 #import "./MIDIChangeHandler.h"
+#include "synth/convert.hpp"
+#include "synth/event.hpp"
+#include "synth/midi_parser.hpp"
 #include "synth/voice_assigner.hpp"
 
 using SampleType = Float32;  // TODO: use fixed point.
 static constexpr UInt32 bufferSize = 128 * sizeof (SampleType);
 static constexpr auto numBuffers = 8U;
-static constexpr NSTimeInterval lockWaitTime = 1.0;
+
+using voices_type = synth::voice_assigner<sample_rate, synth::nco_traits>;
+using event_type = synth::event<sample_rate, synth::nco_traits>;
+using queue_type = synth::event_queue<sample_rate, synth::nco_traits>;
+
+/// A MIDI event and the host time at which it was received.
+struct timed_event {
+  event_type event;
+  MIDITimeStamp time = 0;
+};
+using midi_queue_type = synth::spsc_queue<timed_event, queue_type::capacity>;
 
 
 // audio description
@@ -41,12 +59,28 @@ static void stopAudio (AudioQueueRef queue) {
 }
 
 @interface AppDelegate () {
-  Boolean running_;
+  std::atomic<bool> running_;
   AudioQueueRef queue_;
   AudioQueueBufferRef *buffers_;
-  NSLock *lock_;
 
-  std::unique_ptr<synth::voice_assigner<sample_rate, synth::nco_traits>> voices_;
+  // The voices are owned by the audio thread. Other threads change them by
+  // sending events through a wait-free queue: the MIDI thread and the main
+  // thread each have their own since a queue may only have one producer.
+  std::unique_ptr<voices_type> voices_;
+  std::unique_ptr<midi_queue_type> midiEvents_;
+  std::unique_ptr<queue_type> uiEvents_;
+  // The host time at which the previous buffer was rendered. MIDI events which
+  // arrived between then and the start of the current buffer are spread across
+  // it in proportion to their arrival times.
+  MIDITimeStamp lastBufferTime_;
+  // Storage used by the audio thread. It is allocated in advance so that the
+  // audio thread never allocates.
+  std::vector<double> block_;
+  std::vector<event_type> blockEvents_;
+  // The active voices mask, published by the audio thread after each buffer.
+  std::atomic<UInt16> activeVoices_;
+  // Decodes the MIDI byte stream. Used only by the MIDI thread.
+  synth::midi_parser midiParser_;
   MIDIChangeHandler *midiChangeHandler_;
 }
 @end
@@ -58,11 +92,16 @@ static void stopAudio (AudioQueueRef queue) {
 - (id)init {
   self = [super init];
   if (self) {
-    running_ = NO;
+    running_ = false;
     queue_ = nil;
     buffers_ = nil;
-    lock_ = [NSLock new];
-    voices_.reset (new synth::voice_assigner<sample_rate, synth::nco_traits>);
+    voices_.reset (new voices_type);
+    midiEvents_.reset (new midi_queue_type);
+    uiEvents_.reset (new queue_type);
+    lastBufferTime_ = 0;
+    block_.resize (bufferSize / sizeof (SampleType));
+    blockEvents_.reserve (midi_queue_type::capacity + queue_type::capacity);
+    activeVoices_ = 0;
     midiChangeHandler_ = [[MIDIChangeHandler alloc] init];
   }
   return self;
@@ -71,12 +110,23 @@ static void stopAudio (AudioQueueRef queue) {
 // active voices
 // ~~~~~~~~~~~~~
 - (UInt16)activeVoices {
-  UInt16 result = 0;
-  if ([self->lock_ lockBeforeDate:[NSDate dateWithTimeIntervalSinceNow:lockWaitTime]]) {
-    result = voices_->active_voices ();
-    [self->lock_ unlock];
+  return activeVoices_.load (std::memory_order_relaxed);
+}
+
+// send MIDI event
+// ~~~~~~~~~~~~~~~
+- (void)sendMIDIEvent:(event_type const &)e at:(MIDITimeStamp)time {
+  if (!midiEvents_->push (timed_event{e, time != 0 ? time : ::mach_absolute_time ()})) {
+    NSLog (@"MIDI event queue is full: event dropped");
+  }
+}
+
+// send UI event
+// ~~~~~~~~~~~~~
+- (void)sendUIEvent:(event_type const &)e {
+  if (!uiEvents_->push (e)) {
+    NSLog (@"UI event queue is full: event dropped");
   }
-  return result;
 }
 
 // show error
@@ -107,22 +157,45 @@ static void stopAudio (AudioQueueRef queue) {
   auto *const first = static_cast<SampleType *> (buffer->mAudioData);
   auto *const last = first + samples;
 
-  double masterVolume = 0.5;
+  SampleType const masterVolume = 0.5F;
 
   OSStatus erc = noErr;
-  BOOL running = NO;
-  if ([lock_ lockBeforeDate:[NSDate dateWithTimeIntervalSinceNow:lockWaitTime]]) {
-    running = running_;
-    if (running) {
-      for (auto *it = first; it != last; ++it) {
-        *it = voices_->tick () * masterVolume;
-      }
-    }
-    [lock_ unlock];
-    buffer->mAudioDataByteSize = (last - first) * sizeof (SampleType);
-  } else {
-    NSLog (@"enqueueAudioBuffer could not obtain the lock in a reasonable time!");
+  bool const running = running_.load ();
+  if (running) {
+    assert (samples <= block_.size ());
+    // Collect the events which arrived since the last buffer. This never waits
+    // for the threads which send them.
+    auto &events = blockEvents_;
+    events.clear ();
+    // Changes from the user interface take effect at the start of the buffer.
+    uiEvents_->drain ([&events] (event_type const &e) { events.push_back (e); });
+    // MIDI events keep their relative timing: an event which arrived part way
+    // through the previous buffer period is placed the same fraction of the way
+    // through this buffer. This costs one buffer of latency but removes the
+    // jitter of snapping every event to a buffer boundary.
+    auto const now = ::mach_absolute_time ();
+    auto const previous = lastBufferTime_ != 0 ? lastBufferTime_ : now;
+    auto const period = std::max (now - previous, MIDITimeStamp{1});
+    lastBufferTime_ = now;
+    auto lastOffset = UInt32{0};
+    midiEvents_->drain ([&] (timed_event const &te) {
+      auto const t = std::clamp (te.time, previous, now) - previous;
+      auto const offset = static_cast<UInt32> (t * samples / period);
+      // Keep the events in order even if their time stamps are not.
+      lastOffset = std::min (std::max (offset, lastOffset), samples - 1U);
+      events.push_back (te.event);
+      events.back ().offset = lastOffset;
+    });
+
+    // Render the whole buffer, splitting it only where an event falls.
+    auto const out = synth::span<double>{block_.data (), samples};
+    synth::render (*voices_, synth::span<event_type const>{events}, out);
+    synth::convert (synth::span<double const>{out}, synth::span<SampleType>{first, samples},
+                    masterVolume);
+    activeVoices_.store (static_cast<UInt16> (voices_->active_voices ().to_ulong ()),
+                        std::memory_order_relaxed);
   }
+  buffer->mAudioDataByteSize = (last - first) * sizeof (SampleType);
 
   if (running) {
     erc = ::AudioQueueEnqueueBuffer (queue_, buffer, 0U, nullptr);
@@ -138,73 +211,43 @@ static void stopAudio (AudioQueueRef queue) {
 - (void)readMIDIPacketList:(MIDIPacketList const *)pktlist {
   auto const *packet = pktlist->packet;
   for (UInt32 packet_ctr = 0; packet_ctr < pktlist->numPackets; ++packet_ctr) {
-    Byte const *byte = packet->data;
-    Byte const *const end = byte + packet->length;
-    while (byte != end) {
-      uint8_t const message = *(byte++);
-      // Status bytes are eight-bit binary numbers in which the Most Significant Bit (MSB) is set
-      // (binary 1). Status bytes serve to identify the message type, that is, the purpose of the
-      // Data bytes which follow it.
-      unsigned const chan = message & 0x0F;
-      switch (message >> 4) {
-        case 0b1000:  // Note-Off
-        {
-          unsigned const note = *(byte++);      // TODO: bit 7 must be 0.
-          unsigned const velocity = *(byte++);  // TODO: bit 7 must be 0.
-          NSLog (@"Note off chan=%u, note=%u, velocity=%u", chan, note, velocity);
-          if ([self->lock_ lockBeforeDate:[NSDate dateWithTimeIntervalSinceNow:lockWaitTime]]) {
-            self->voices_->note_off (note);
-            [self->lock_ unlock];
+    MIDITimeStamp const time = packet->timeStamp;
+    // A message may be split across packets so the parser keeps its state
+    // between calls.
+    midiParser_.parse (
+        synth::span<uint8_t const>{packet->data, packet->length},
+        [self, time] (synth::midi_message const &m) {
+          unsigned const chan = m.channel;
+          switch (m.kind) {
+            case synth::midi_kind::note_off:
+              NSLog (@"Note off chan=%u, note=%u, velocity=%u", chan, m.note (), m.velocity ());
+              [self sendMIDIEvent:event_type::make_note_off (m.note ()) at:time];
+              break;
+            case synth::midi_kind::note_on:
+              NSLog (@"Note on chan=%u, note=%u, velocity=%u", chan, m.note (), m.velocity ());
+              [self sendMIDIEvent:event_type::make_note_on (m.note ()) at:time];
+              break;
+            case synth::midi_kind::poly_pressure:
+              NSLog (@"Poly Pressure chan=%u, note=%u, velocity=%u", chan, m.note (),
+                     m.velocity ());
+              break;
+            case synth::midi_kind::control_change:
+              NSLog (@"CC chan=%u, controller=%u, value=%u", chan, unsigned{m.data1},
+                     unsigned{m.data2});
+              break;
+            case synth::midi_kind::program_change:
+              NSLog (@"Program change chan=%u, no.=%u", chan, unsigned{m.data1});
+              break;
+            case synth::midi_kind::channel_pressure:
+              NSLog (@"Channel Pressure chan=%u, value=%u", chan, unsigned{m.data1});
+              break;
+            case synth::midi_kind::pitch_bend:
+              NSLog (@"Pitch Bend chan=%u, value=%u", chan, m.value14 ());
+              break;
+            default:  // System messages.
+              break;
           }
-        } break;
-        case 0b1001:  // Note-On
-        {
-          unsigned const note = *(byte++);      // TODO: bit 7 must be 0.
-          unsigned const velocity = *(byte++);  // TODO: bit 7 must be 0.
-          if ([self->lock_ lockBeforeDate:[NSDate dateWithTimeIntervalSinceNow:lockWaitTime]]) {
-            if (velocity == 0) {
-              NSLog (@"Note off chan=%u, note=%u, velocity=%u", chan, note, velocity);
-              self->voices_->note_off (note);
-            } else {
-              NSLog (@"Note on chan=%u, note=%u, velocity=%u", chan, note, velocity);
-              self->voices_->note_on (note);
-            }
-            [self->lock_ unlock];
-          }
-        } break;
-        case 0b1010:  // Polyphonic Key Pressure
-        {
-          unsigned const note = *(byte++);      // TODO: bit 7 must be 0.
-          unsigned const velocity = *(byte++);  // TODO: bit 7 must be 0.
-          NSLog (@"Poly Pressure chan=%u, note=%u, velocity=%u", chan, note, velocity);
-        } break;
-        case 0b1011:  // Control Change
-        {
-          unsigned const controller = *(byte++);  // TODO: bit 7 must be 0.
-          unsigned const value = *(byte++);       // TODO: bit 7 must be 0.
-          NSLog (@"CC chan=%u, controller=%u, value=%u", chan, controller, value);
-        } break;
-        case 0b1100:  // Program change
-        {
-          unsigned const program_number = *(byte++);  // TODO: bit 7 must be 0.
-          NSLog (@"Program change chan=%u, no.=%u", chan, program_number);
-        } break;
-        case 0b1101:  // Channel Pressure (aftertouch)
-        {
-          unsigned const program_number = *(byte++);  // TODO: bit 7 must be 0.
-          NSLog (@"Channel Pressure chan=%u, value=%u", chan, program_number);
-        } break;
-        case 0b1110:  // Pitch Bend
-        {
-          uint16_t const low = *(byte++);   // TODO: bit 7 must be 0.
-          uint16_t const high = *(byte++);  // TODO: bit 7 must be 0.
-          NSLog (@"Pitch Bend chan=%u, value=%u", chan, (high << 7) | low);
-        } break;
-        case 0xF0:  // System Message: skip args
-        default:
-          break;
-      }
-    }
+        });
     packet = MIDIPacketNext (packet);
   }
 }
@@ -239,7 +282,7 @@ static void callback (void *__nullable userData, AudioQueueRef queue, AudioQueue
 - (BOOL)application:(UIApplication *)application
     didFinishLaunchingWithOptions:(NSDictionary *)launchOptions {
 #endif
-  running_ = YES;
+  running_ = true;
 
   AudioStreamBasicDescription const description = audioDescription ();
   OSStatus erc = ::AudioQueueNewOutput (&description, callback, (__bridge void *)self,
@@ -313,12 +356,7 @@ static void callback (void *__nullable userData, AudioQueueRef queue, AudioQueue
 - (void)applicationWillTerminate:(UIApplication *)application {
 #endif
 
-  if ([lock_ lockBeforeDate:[NSDate dateWithTimeIntervalSinceNow:lockWaitTime]]) {
-    running_ = NO;
-    [lock_ unlock];
-  } else {
-    NSLog (@"applicationWillTerminate could not obtain the lock in a reasonable time!");
-  }
+  running_ = false;
   stopAudio (queue_);
   queue_ = nil;
 }
@@ -335,7 +373,10 @@ static void callback (void *__nullable userData, AudioQueueRef queue, AudioQueue
 // ~~~~~~~~~~~~
 - (void)setWaveform:(NSInteger)tag {
   using traits = synth::nco_traits;
+  // The sine wave has no harmonics to alias; the other waveforms use their
+  // band-limited forms.
   synth::wavetable<traits> const *w = nullptr;
+  synth::mipmap_wavetable<traits> const *m = nullptr;
   NSString *name = @"";
   switch (tag) {
     case 0:
@@ -344,54 +385,39 @@ static void callback (void *__nullable userData, AudioQueueRef queue, AudioQueue
       break;
     case 1:
       name = @"square";
-      w = &synth::square<traits>;
+      m = &synth::bandlimited_square<traits>;
       break;
     case 2:
       name = @"triangle";
-      w = &synth::triangle<traits>;
+      m = &synth::bandlimited_triangle<traits>;
       break;
     case 3:
       name = @"sawtooth=";
-      w = &synth::sawtooth<traits>;
+      m = &synth::bandlimited_sawtooth<traits>;
       break;
   }
-  if (w == nullptr) {
+  if (w == nullptr && m == nullptr) {
     NSLog (@"setWaveform didn't understand waveform tag %ld", tag);
     return;
   }
   NSLog (@"setting waveform to %@", name);
 
-  if (![lock_ lockBeforeDate:[NSDate dateWithTimeIntervalSinceNow:lockWaitTime]]) {
-    NSLog (@"setWaveform could not obtain the lock in a reasonable time!");
-    return;
-  }
-  voices_->set_wavetable (w);
-  [lock_ unlock];
+  [self sendUIEvent:(m != nullptr ? event_type::make_wavetable (m)
+                                  : event_type::make_wavetable (w))];
 }
 
 // set frequency
 // ~~~~~~~~~~~~~
 - (void)setFrequency:(double)f {
   NSLog (@"setFrequency %lf", f);
-  if (![lock_ lockBeforeDate:[NSDate dateWithTimeIntervalSinceNow:lockWaitTime]]) {
-    NSLog (@"setFrequency could not obtain the lock in a reasonable time!");
-    return;
-  }
   // osc_->set_frequency (synth::oscillator::frequency::fromfp (f));
-  [lock_ unlock];
 }
 
 // set envelope stage
 // ~~~~~~~~~~~~~~~~~~
 - (void)setEnvelopeStage:(synth::envelope<sample_rate>::phase)stage to:(double)value {
   NSLog (@"Envelope %@ %f", @(synth::envelope<sample_rate>::phase_name (stage)), value);
-
-  if (![lock_ lockBeforeDate:[NSDate dateWithTimeIntervalSinceNow:lockWaitTime]]) {
-    NSLog (@"setEnvelopeStage:to: could not obtain the lock in a reasonable time!");
-    return;
-  }
-  voices_->set_envelope (stage, value);
-  [lock_ unlock];
+  [self sendUIEvent:event_type::make_envelope (stage, value)];
 }
 
 #pragma mark - UISceneSession lifecycle
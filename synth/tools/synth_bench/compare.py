@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Compares two sets of synth_bench results (as written by
+--benchmark_out_format=json) and reports any benchmark that has become slower
+by more than a given threshold.
+
+Exits with status 1 if a regression is found, 0 otherwise.
+"""
+import argparse
+import json
+import sys
+
+# Multipliers which convert each Google Benchmark time unit to nanoseconds.
+TIME_UNITS = {'ns': 1.0, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+
+
+def load(path):
+    """
+    Loads a benchmark results file and returns a dictionary mapping each
+    benchmark name to its CPU time in nanoseconds per iteration. If the run
+    used repetitions, the median is used.
+    """
+    with open(path, encoding='utf-8') as f:
+        benchmarks = json.load(f)['benchmarks']
+    medians = {}
+    iterations = {}
+    for b in benchmarks:
+        ns = b['cpu_time'] * TIME_UNITS[b.get('time_unit', 'ns')]
+        if b.get('run_type') == 'aggregate':
+            if b.get('aggregate_name') == 'median':
+                medians[b['run_name']] = ns
+        else:
+            iterations.setdefault(b.get('run_name', b['name']), []).append(ns)
+    # Fall back to the median of the individual iterations of any benchmark
+    # without a median aggregate.
+    for name, times in iterations.items():
+        if name not in medians:
+            times.sort()
+            medians[name] = times[len(times) // 2]
+    return medians
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('baseline', help='The baseline results file')
+    parser.add_argument('current', help='The results file to be checked')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help='The permitted slow-down in percent (default: 5)')
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = []
+    width = max((len(name) for name in current), default=0)
+    print(f'{"Benchmark":<{width}}  {"Baseline":>12}  {"Current":>12}  Change')
+    for name, time in current.items():
+        if name not in baseline:
+            print(f'{name:<{width}}  {"-":>12}  {time:>10.1f}ns  (new)')
+            continue
+        base = baseline[name]
+        change = (time - base) / base * 100.0
+        flag = ''
+        if change > args.threshold:
+            regressions.append(name)
+            flag = '  REGRESSION'
+        print(f'{name:<{width}}  {base:>10.1f}ns  {time:>10.1f}ns  '
+              f'{change:+6.1f}%{flag}')
+
+    if regressions:
+        print(f'\n{len(regressions)} benchmark(s) slower than the baseline by '
+              f'more than {args.threshold}%:', file=sys.stderr)
+        for name in regressions:
+            print(f'  {name}', file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,537 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+// Standard library includes
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Google Benchmark
+#include <benchmark/benchmark.h>
+
+// synth library includes
+#include "synth/blep_oscillator.hpp"
+#include "synth/compact_wavetable.hpp"
+#include "synth/convert.hpp"
+#include "synth/engine.hpp"
+#include "synth/envelope.hpp"
+#include "synth/midi_parser.hpp"
+#include "synth/mipmap_wavetable.hpp"
+#include "synth/nco.hpp"
+#include "synth/noise.hpp"
+#include "synth/oversampler.hpp"
+#include "synth/resampler.hpp"
+#include "synth/signal_generator.hpp"
+#include "synth/thread_pool.hpp"
+#include "synth/voice.hpp"
+#include "synth/voice_assigner.hpp"
+#include "synth/wavetable.hpp"
+
+// wav_writer includes
+#include "wav_file.hpp"
+
+using namespace synth;
+
+namespace {
+
+constexpr auto sample_rate = 96000U;
+/// The number of samples produced by each iteration of the per-sample
+/// benchmarks. Batching a few samples per iteration keeps the cost of the
+/// benchmark loop itself out of the measurements.
+constexpr auto samples_per_iteration = int64_t{256};
+constexpr auto c4 = 60U;  // (middle C)
+/// MIDI note numbers of a C major scale starting at C4: one note per voice.
+constexpr std::array<unsigned, 8> c_major{
+    {c4, c4 + 2U, c4 + 4U, c4 + 5U, c4 + 7U, c4 + 9U, c4 + 11U, c4 + 12U}};
+
+/// Records the number of samples processed by a benchmark as both a rate
+/// (samples/s) and its inverse (s/sample: "2.5n" is 2.5 nanoseconds per
+/// sample).
+void set_sample_counters (benchmark::State& state, int64_t const samples) {
+  auto const total = static_cast<double> (state.iterations ()) *
+                     static_cast<double> (samples);
+  state.counters["samples/s"] =
+      benchmark::Counter{total, benchmark::Counter::kIsRate};
+  state.counters["s/sample"] = benchmark::Counter{
+      total, benchmark::Counter::kIsRate | benchmark::Counter::kInvert};
+}
+
+// wavetable::phase_to_amplitude
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+/// Traits for a small (256-entry) wavetable with the given interpolation.
+template <interpolation Interpolation>
+struct small_traits {
+  static constexpr auto wavetable_N = 8U;
+  static constexpr auto M = 32U;
+  static constexpr auto interpolation = Interpolation;
+};
+
+/// An arbitrary odd increment so that successive lookups visit scattered
+/// table entries.
+constexpr auto scatter_increment = uint32_t{0x9E3779B9};
+
+template <typename Traits>
+void phase_to_amplitude (benchmark::State& state) {
+  using phase_index_type = typename oscillator_info<Traits>::phase_index_type;
+  wavetable<Traits> const& w = sine<Traits>;
+  auto phase = uint32_t{0};
+  for (auto _ : state) {
+    for (auto ctr = int64_t{0}; ctr < samples_per_iteration; ++ctr) {
+      benchmark::DoNotOptimize (
+          w.phase_to_amplitude (phase_index_type::frombits (phase)));
+      phase += scatter_increment;
+    }
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK_TEMPLATE (phase_to_amplitude, nco_traits);
+BENCHMARK_TEMPLATE (phase_to_amplitude, small_traits<interpolation::none>);
+BENCHMARK_TEMPLATE (phase_to_amplitude, small_traits<interpolation::linear>);
+BENCHMARK_TEMPLATE (phase_to_amplitude, small_traits<interpolation::cubic>);
+
+/// As phase_to_amplitude but using the batch form.
+template <typename Traits>
+void phase_to_amplitude_batch (benchmark::State& state) {
+  using phase_index_type = typename oscillator_info<Traits>::phase_index_type;
+  wavetable<Traits> const& w = sine<Traits>;
+  std::vector<phase_index_type> phases (
+      static_cast<size_t> (samples_per_iteration));
+  auto phase = uint32_t{0};
+  for (auto& p : phases) {
+    p = phase_index_type::frombits (phase);
+    phase += scatter_increment;
+  }
+  std::vector<amplitude> out (phases.size ());
+  for (auto _ : state) {
+    w.phase_to_amplitude (phases, out);
+    benchmark::DoNotOptimize (out.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK_TEMPLATE (phase_to_amplitude_batch, nco_traits);
+BENCHMARK_TEMPLATE (phase_to_amplitude_batch,
+                    small_traits<interpolation::none>);
+BENCHMARK_TEMPLATE (phase_to_amplitude_batch,
+                    small_traits<interpolation::linear>);
+BENCHMARK_TEMPLATE (phase_to_amplitude_batch,
+                    small_traits<interpolation::cubic>);
+
+// oscillator::tick
+// ~~~~~~~~~~~~~~~~
+/// The noise source used by the oscillator_tick benchmark. Benchmarks run
+/// on a single thread so it can be shared between iterations.
+noise_wavetable<nco_traits> const bench_noise{};
+
+template <typename Wavetable>
+void oscillator_tick (benchmark::State& state, Wavetable const* w) {
+  oscillator<sample_rate, nco_traits, Wavetable> osc{w};
+  osc.set_frequency (frequency::fromfp (440.0));
+  for (auto _ : state) {
+    for (auto ctr = int64_t{0}; ctr < samples_per_iteration; ++ctr) {
+      benchmark::DoNotOptimize (osc.tick ());
+    }
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK_CAPTURE (oscillator_tick, sine, &sine<nco_traits>);
+BENCHMARK_CAPTURE (oscillator_tick, square, &square<nco_traits>);
+BENCHMARK_CAPTURE (oscillator_tick, triangle, &triangle<nco_traits>);
+BENCHMARK_CAPTURE (oscillator_tick, sawtooth, &sawtooth<nco_traits>);
+BENCHMARK_CAPTURE (oscillator_tick, noise, &bench_noise);
+BENCHMARK_CAPTURE (oscillator_tick, compact_sine, &compact_sine<nco_traits>);
+BENCHMARK_CAPTURE (oscillator_tick, compact_square, &compact_square<nco_traits>);
+BENCHMARK_CAPTURE (oscillator_tick, bandlimited_sawtooth,
+                   &bandlimited_sawtooth<nco_traits>);
+
+// blep_oscillator::render
+// ~~~~~~~~~~~~~~~~~~~~~~~
+void blep_render (benchmark::State& state, blep_waveform const w) {
+  blep_oscillator<sample_rate, nco_traits> osc{w};
+  osc.set_frequency (frequency::fromfp (440.0));
+  std::vector<amplitude> out (static_cast<size_t> (samples_per_iteration));
+  for (auto _ : state) {
+    osc.render (span<amplitude>{out});
+    benchmark::DoNotOptimize (out.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK_CAPTURE (blep_render, sawtooth, blep_waveform::sawtooth);
+BENCHMARK_CAPTURE (blep_render, square, blep_waveform::square);
+BENCHMARK_CAPTURE (blep_render, triangle, blep_waveform::triangle);
+
+// noise_generator::render
+// ~~~~~~~~~~~~~~~~~~~~~~~
+void noise_render (benchmark::State& state, noise_color const color) {
+  noise_generator generator;
+  generator.set_color (color);
+  generator.set_cutoff (0.05);
+  std::vector<amplitude> out (static_cast<size_t> (samples_per_iteration));
+  for (auto _ : state) {
+    generator.render (span<amplitude>{out});
+    benchmark::DoNotOptimize (out.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK_CAPTURE (noise_render, white, noise_color::white);
+BENCHMARK_CAPTURE (noise_render, pink, noise_color::pink);
+BENCHMARK_CAPTURE (noise_render, filtered, noise_color::filtered);
+
+// chirp::render
+// ~~~~~~~~~~~~~
+void chirp_render (benchmark::State& state, chirp_shape const shape) {
+  chirp c{shape, 20.0, 20000.0, sample_rate * size_t{10}, sample_rate};
+  std::vector<double> out (static_cast<size_t> (samples_per_iteration));
+  for (auto _ : state) {
+    if (c.position () + out.size () > c.size ()) {
+      c.reset ();
+    }
+    c.render (span<double>{out});
+    benchmark::DoNotOptimize (out.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK_CAPTURE (chirp_render, linear, chirp_shape::linear);
+BENCHMARK_CAPTURE (chirp_render, exponential, chirp_shape::exponential);
+
+// multitone::render
+// ~~~~~~~~~~~~~~~~~
+void multitone_render (benchmark::State& state) {
+  std::vector<tone> tones;
+  for (auto f = 31.25; f < 20000.0; f *= 2.0) {
+    tones.push_back (tone{f, 0.1, 0.0});
+  }
+  multitone m{span<tone const>{tones.data (), tones.size ()}, sample_rate};
+  std::vector<double> out (static_cast<size_t> (samples_per_iteration));
+  for (auto _ : state) {
+    m.render (span<double>{out});
+    benchmark::DoNotOptimize (out.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK (multitone_render);
+
+/// Writes a constant to the same buffer as the signal generators: the cost of
+/// the stores alone.
+void fill_baseline (benchmark::State& state) {
+  std::vector<double> out (static_cast<size_t> (samples_per_iteration));
+  for (auto _ : state) {
+    std::fill (std::begin (out), std::end (out), 0.5);
+    benchmark::DoNotOptimize (out.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK (fill_baseline);
+
+// envelope::tick
+// ~~~~~~~~~~~~~~
+using envelope_type = envelope<sample_rate>;
+using envelope_phase = envelope_type::phase;
+
+/// Returns an envelope which is in phase \p p and will remain there for far
+/// longer than a single benchmark iteration.
+envelope_type make_envelope (envelope_phase const p) {
+  constexpr auto long_time = 10.0;  // seconds
+  envelope_type env;
+  auto const time = [p] (envelope_phase const q) {
+    return p == q ? long_time : 0.0;
+  };
+  env.set (envelope_phase::attack, time (envelope_phase::attack));
+  env.set (envelope_phase::decay, time (envelope_phase::decay));
+  env.set (envelope_phase::sustain, 0.5);
+  env.set (envelope_phase::release, long_time);
+  if (p == envelope_phase::idle) {
+    return env;
+  }
+  env.note_on ();
+  // Step past the instantaneous phases.
+  (void)env.tick (amplitude::fromint (1U));
+  if (p == envelope_phase::release) {
+    env.note_off ();
+  }
+  return env;
+}
+
+void envelope_tick (benchmark::State& state, envelope_phase const p) {
+  envelope_type const initial = make_envelope (p);
+  auto const v = amplitude::fromfp (0.5);
+  for (auto _ : state) {
+    // Start each iteration from the same point so that the envelope never
+    // leaves the phase being measured.
+    auto env = initial;
+    for (auto ctr = int64_t{0}; ctr < samples_per_iteration; ++ctr) {
+      benchmark::DoNotOptimize (env.tick (v));
+    }
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK_CAPTURE (envelope_tick, idle, envelope_phase::idle);
+BENCHMARK_CAPTURE (envelope_tick, attack, envelope_phase::attack);
+BENCHMARK_CAPTURE (envelope_tick, decay, envelope_phase::decay);
+BENCHMARK_CAPTURE (envelope_tick, sustain, envelope_phase::sustain);
+BENCHMARK_CAPTURE (envelope_tick, release, envelope_phase::release);
+
+// voice::tick
+// ~~~~~~~~~~~
+void voice_tick (benchmark::State& state) {
+  voice<sample_rate, nco_traits> v;
+  v.note_on (c4);
+  for (auto _ : state) {
+    for (auto ctr = int64_t{0}; ctr < samples_per_iteration; ++ctr) {
+      benchmark::DoNotOptimize (v.tick ());
+    }
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK (voice_tick);
+
+// voice_assigner::tick
+// ~~~~~~~~~~~~~~~~~~~~
+/// Returns a voice assigner with state.range(0) active voices.
+voice_assigner<sample_rate, nco_traits> make_voices (
+    benchmark::State const& state) {
+  voice_assigner<sample_rate, nco_traits> voices;
+  for (auto ctr = int64_t{0}; ctr < state.range (0); ++ctr) {
+    voices.note_on (c_major[static_cast<size_t> (ctr)]);
+  }
+  return voices;
+}
+
+void voice_assigner_tick (benchmark::State& state) {
+  auto voices = make_voices (state);
+  for (auto _ : state) {
+    for (auto ctr = int64_t{0}; ctr < samples_per_iteration; ++ctr) {
+      benchmark::DoNotOptimize (voices.tick ());
+    }
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK (voice_assigner_tick)
+    ->ArgName ("voices")
+    ->DenseRange (1, static_cast<int> (c_major.size ()));
+
+/// As voice_assigner_tick but rendering whole buffers rather than individual
+/// samples.
+void voice_assigner_render (benchmark::State& state) {
+  auto voices = make_voices (state);
+  std::vector<double> buffer (static_cast<size_t> (samples_per_iteration));
+  for (auto _ : state) {
+    voices.render (span<double>{buffer});
+    benchmark::DoNotOptimize (buffer.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK (voice_assigner_render)
+    ->ArgName ("voices")
+    ->DenseRange (1, static_cast<int> (c_major.size ()));
+
+/// As voice_assigner_render but with the sample rate chosen at run time by
+/// make_engine(). The difference is the cost of the virtual call.
+void engine_render (benchmark::State& state) {
+  auto const e = make_engine<nco_traits> (sample_rate);
+  for (auto ctr = int64_t{0}; ctr < state.range (0); ++ctr) {
+    e->note_on (c_major[static_cast<size_t> (ctr)]);
+  }
+  std::vector<double> buffer (static_cast<size_t> (samples_per_iteration));
+  for (auto _ : state) {
+    e->render (span<double>{buffer});
+    benchmark::DoNotOptimize (buffer.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK (engine_render)
+    ->ArgName ("voices")
+    ->DenseRange (1, static_cast<int> (c_major.size ()));
+
+/// Renders 128 sounding voices (one for each MIDI note) using a thread pool
+/// with state.range(0) workers. With no workers the voices are rendered on the
+/// benchmark thread.
+void voice_assigner_parallel (benchmark::State& state) {
+  using voices_type = voice_assigner<sample_rate, nco_traits, 128>;
+  thread_pool pool{static_cast<unsigned> (state.range (0))};
+  auto voices = std::make_unique<voices_type> ();
+  voices->set_thread_pool (&pool);
+  for (auto note = 0U; note < 128U; ++note) {
+    voices->note_on (note);
+  }
+  std::vector<double> buffer (static_cast<size_t> (samples_per_iteration));
+  for (auto _ : state) {
+    voices->render (span<double>{buffer});
+    benchmark::DoNotOptimize (buffer.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK (voice_assigner_parallel)->ArgName ("workers")->DenseRange (0, 3);
+
+// halfband_decimator::process
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+/// Decimates a block of noise. The samples per second counter is the output
+/// rate.
+template <size_t K>
+void halfband_decimate (benchmark::State& state) {
+  std::vector<amplitude> in (2U * static_cast<size_t> (samples_per_iteration));
+  std::mt19937 gen;
+  std::uniform_real_distribution<double> dist{-1.0, 1.0};
+  std::generate (std::begin (in), std::end (in),
+                 [&] { return amplitude::fromfp (dist (gen)); });
+  std::vector<amplitude> out (in.size () / 2U);
+  halfband_decimator<K> d;
+  for (auto _ : state) {
+    d.process (in, out);
+    benchmark::DoNotOptimize (out.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK_TEMPLATE (halfband_decimate, 4);
+BENCHMARK_TEMPLATE (halfband_decimate, 12);
+
+/// Renders 4 voices oversampled by a factor of Factor.
+template <unsigned Factor>
+void oversampled_render (benchmark::State& state) {
+  oversampled_voice_assigner<sample_rate, nco_traits, Factor> voices;
+  for (auto ctr = size_t{0}; ctr < 4U; ++ctr) {
+    voices.note_on (c_major[ctr]);
+  }
+  std::vector<double> buffer (static_cast<size_t> (samples_per_iteration));
+  for (auto _ : state) {
+    voices.render (span<double>{buffer});
+    benchmark::DoNotOptimize (buffer.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK_TEMPLATE (oversampled_render, 2);
+BENCHMARK_TEMPLATE (oversampled_render, 4);
+BENCHMARK_TEMPLATE (oversampled_render, 8);
+
+// resampler::process
+// ~~~~~~~~~~~~~~~~~~
+/// Converts a block of noise from the engine's rate to the rate given by the
+/// argument. The samples per second counter is the input rate.
+void resample (benchmark::State& state) {
+  std::vector<double> in (static_cast<size_t> (samples_per_iteration));
+  std::mt19937 gen;
+  std::uniform_real_distribution<double> dist{-1.0, 1.0};
+  std::generate (std::begin (in), std::end (in), [&] { return dist (gen); });
+  resampler r{sample_rate, static_cast<unsigned> (state.range (0))};
+  std::vector<double> out (r.max_output (in.size ()));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize (r.process (in, out));
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK (resample)->ArgName ("rate")->Arg (44100)->Arg (48000);
+
+// to_pcm/to_float32
+// ~~~~~~~~~~~~~~~~~
+/// Returns a block of samples to be converted.
+std::vector<double> make_block () {
+  std::vector<double> in (static_cast<size_t> (samples_per_iteration));
+  voice_assigner<sample_rate, nco_traits> voices;
+  voices.note_on (c4);
+  voices.render (span<double>{in});
+  return in;
+}
+
+template <unsigned Bits>
+void convert_pcm (benchmark::State& state) {
+  auto const in = make_block ();
+  std::vector<uint8_t> out (in.size () * (Bits / 8U));
+  tpdf_dither dither;
+  auto* const d = state.range (0) != 0 ? &dither : nullptr;
+  for (auto _ : state) {
+    to_pcm<Bits> (span<double const>{in}, span<uint8_t>{out}, 0.5, d);
+    benchmark::DoNotOptimize (out.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK_TEMPLATE (convert_pcm, 16)->ArgName ("dither")->Arg (0)->Arg (1);
+BENCHMARK_TEMPLATE (convert_pcm, 24)->ArgName ("dither")->Arg (0);
+BENCHMARK_TEMPLATE (convert_pcm, 32)->ArgName ("dither")->Arg (0);
+
+void convert_float32 (benchmark::State& state) {
+  auto const in = make_block ();
+  std::vector<uint8_t> out (in.size () * sizeof (float));
+  for (auto _ : state) {
+    to_float32 (span<double const>{in}, span<uint8_t>{out}, 0.5F);
+    benchmark::DoNotOptimize (out.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples_per_iteration);
+}
+BENCHMARK (convert_float32);
+
+// midi_parser
+// ~~~~~~~~~~~
+/// Returns a typical stream of MIDI bytes: notes and controller changes using
+/// running status with interleaved timing clocks.
+std::vector<uint8_t> make_midi_stream () {
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<unsigned> data{0U, 127U};
+  std::vector<uint8_t> result;
+  for (auto ctr = 0U; ctr < 1024U; ++ctr) {
+    if (ctr % 64U == 0U) {
+      result.push_back (ctr % 128U == 0U ? 0x90 : 0xB0);
+    }
+    result.push_back (static_cast<uint8_t> (data (gen)));
+    if (ctr % 8U == 0U) {
+      result.push_back (0xF8);  // Timing clock.
+    }
+    result.push_back (static_cast<uint8_t> (data (gen)));
+  }
+  return result;
+}
+
+void midi_parse (benchmark::State& state) {
+  auto const in = make_midi_stream ();
+  midi_parser parser;
+  auto notes = 0U;
+  for (auto _ : state) {
+    parser.parse (span<uint8_t const>{in}, [&notes] (midi_message const& m) {
+      notes += m.kind == midi_kind::note_on;
+    });
+    benchmark::DoNotOptimize (notes);
+  }
+  state.SetBytesProcessed (static_cast<int64_t> (state.iterations ()) *
+                           static_cast<int64_t> (in.size ()));
+}
+BENCHMARK (midi_parse);
+
+// emit_wave_file
+// ~~~~~~~~~~~~~~
+void emit_wave_file (benchmark::State& state) {
+  auto const samples = state.range (0);
+  std::vector<double> in (static_cast<size_t> (samples));
+  {
+    voice_assigner<sample_rate, nco_traits> voices;
+    voices.note_on (c4);
+    voices.render (span<double>{in});
+  }
+  std::vector<uint8_t> out;
+  for (auto _ : state) {
+    out.clear ();
+    synth::emit_wave_file (std::begin (in), std::end (in), sample_rate,
+                           std::back_inserter (out));
+    benchmark::DoNotOptimize (out.data ());
+    benchmark::ClobberMemory ();
+  }
+  set_sample_counters (state, samples);
+}
+BENCHMARK (emit_wave_file)->ArgName ("samples")->Arg (sample_rate);
+
+}  // end anonymous namespace
+
+BENCHMARK_MAIN ();
@@ -1,20 +1,32 @@
 // -*- mode: c++; coding: utf-8-unix; -*-
 // Standard library includes
+#include <algorithm>
+#include <array>
+#include <bitset>
 #include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 // synth library includes
 #include "synth/envelope.hpp"
+#include "synth/event.hpp"
 #include "synth/nco.hpp"
+#include "synth/resampler.hpp"
+#include "synth/signal_generator.hpp"
 #include "synth/voice.hpp"
 #include "synth/voice_assigner.hpp"
 
 // Local includes
-#include "poly_blep_sawtooth.hpp"
-#include "wav_file.hpp"
+#include "midi_file.hpp"
+#include "wav_stream.hpp"
 
 using namespace synth;
 
@@ -55,45 +67,12 @@ public:
 private:
   Oscillator *NONNULL osc_;
 };
-oscillator_double ()->oscillator_double<oscillator_type>;
-
-/// Generates an exponential chirp.
-///
-/// \param osc  The oscillator to be used to generate output.
-/// \param minf  The minimum frequency of the chirp (Hz).
-/// \param maxf  The maximum frequency of the chirp (Hz).
-/// \param time  The duration of the chirp.
-/// \param out  A LegacyOutputIterator iterator to which samples will be written.
-/// \returns  Output iterator to the element in the destination range, one past the last element written.
-template <typename Oscillator, typename OutputIterator, typename DurationRep,
-          typename DurationPeriod>
-OutputIterator chirp (Oscillator *NONNULL osc, double minf, double maxf,
-                      std::chrono::duration<DurationRep, DurationPeriod> time,
-                      OutputIterator out) {
-  oscillator_double<Oscillator> oscd{osc};
-
-  auto const time_seconds = std::chrono::duration<double>{time}.count ();
-  auto const samples = static_cast<unsigned long> (
-      std::round (time_seconds * Oscillator::sample_rate));
-  auto const n = (maxf - minf) / (std::pow (2.0, time_seconds) - 1);
-  for (auto t = 0U; t < samples; ++t) {
-    auto const f =
-        n * std::pow (2.0, static_cast<double> (t) / Oscillator::sample_rate) -
-        n + minf;
-    oscd.set_frequency (frequency::fromfp (f));
-    *(out++) = oscd ();
-  }
-  return out;
-}
 
 constexpr auto one_second = sample_rate;
 constexpr auto quarter_second = sample_rate / size_t{4};
 
-}  // end anonymous namespace
-
-int main () {
-  std::vector<double> samples;
-
+/// Writes the built-in demonstration to \p samples.
+void play_demo (wav_stream &samples) {
   if constexpr (/* DISABLES CODE */ (false)) {
     dump_wavetable (sine<nco_traits>);
   }
@@ -103,7 +82,6 @@ int main () {
     constexpr auto two_seconds = one_second * 2;
     oscillator_type osc{&sine<nco_traits>};
     osc.set_frequency (frequency::fromfp (440.0));
-    samples.reserve (two_seconds);
     std::generate_n (std::back_inserter (samples), two_seconds,
                      oscillator_double{&osc});
   }
@@ -114,19 +92,25 @@ int main () {
     std::array<unsigned const, 8> const major_scale{
         {0U, 2U, 4U, 5U, 7U, 9U, 11U, 12U}};
 
+    // Appends the next n samples from the voices to the output.
+    auto const render = [&voices, &samples] (size_t n) {
+      std::array<double, 256> block;
+      while (n > 0U) {
+        auto const count = std::min (n, block.size ());
+        voices.render (span<double>{block.data (), count});
+        samples.write (span<double const>{block.data (), count});
+        n -= count;
+      }
+    };
     for (auto const note : major_scale) {
       voices.note_on (c4 + note);
-      for (auto ctr = 0U; ctr < one_second / 4; ++ctr) {
-        samples.emplace_back (voices.tick ());
-      }
+      render (quarter_second);
       // voices.note_off (note);
     }
     for (auto const note : major_scale) {
       voices.note_off (note);
     }
-    for (auto ctr = 0U; ctr < one_second / 10U; ++ctr) {
-      samples.emplace_back (voices.tick ());
-    }
+    render (one_second / 10U);
   }
 
   if constexpr (/* DISABLES CODE */ (false)) {
@@ -166,15 +150,236 @@ int main () {
   }
 
   if constexpr (/* DISABLES CODE */ (true)) {
-    poly_blep_sawtooth_oscillator<sample_rate> osc;
-    chirp (&osc, 0.0, 10000.0, std::chrono::seconds{10},
-           std::back_inserter (samples));
+    // A ten second exponential sweep from 20Hz to 10kHz.
+    synth::chirp sweep{chirp_shape::exponential, 20.0, 10000.0,
+                       one_second * size_t{10}, sample_rate};
+    std::array<double, 4096> block;
+    for (auto n = sweep.size (); n > 0U;) {
+      auto const count = std::min (n, block.size ());
+      sweep.render (span<double>{block.data (), count});
+      samples.write (span<double const>{block.data (), count});
+      n -= count;
+    }
   }
+}
+
+/// Reads the whole of the file at \p path.
+std::vector<uint8_t> read_file (char const *const path) {
+  std::ifstream in{path, std::ios::binary};
+  if (!in) {
+    throw std::runtime_error{std::string{"could not open "} + path};
+  }
+  return {std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+}
 
-  std::vector<uint8_t> wave_file;
-  emit_wave_file (std::begin (samples), std::end (samples), sample_rate,
-                  std::back_inserter (wave_file));
-  std::ofstream of{"./output.wav", std::ios::binary};
-  of.write (reinterpret_cast<char *> (wave_file.data ()),
-            static_cast<std::streamsize> (wave_file.size ()));
+/// Plays a sequence of note events through a voice_assigner and writes the
+/// result to \p samples. The output is rendered in fixed-size blocks; each
+/// event takes effect at the sample nearest to its time within its block.
+/// After the last event, rendering continues until every voice has finished
+/// its release (or for at most \p max_tail samples). The output ends with the
+/// last non-zero sample produced before the final voice became idle rather
+/// than at the end of a block.
+///
+/// The voices are keyed by note number alone, so a note which is held on more
+/// than one channel shares a voice: it is released when the last channel that
+/// holds it lets go. Events on the percussion channel (channel 10, whose
+/// notes select drum sounds rather than pitches) are skipped.
+///
+/// If \p converter is not null, the output is advanced by the converter's
+/// latency so that it is aligned with the events.
+///
+/// \param events  The note events in time order.
+/// \param max_tail  The maximum number of samples rendered after the last
+///   event.
+/// \param samples  The stream to which the output is written.
+/// \param converter  If not null, converts the output from the engine's sample
+///   rate to that of \p samples.
+void play_events (std::vector<note_event> const &events, size_t max_tail,
+                  wav_stream &samples, resampler *const converter) {
+  using event_type = event<sample_rate, nco_traits>;
+  voice_assigner<sample_rate, nco_traits> voices;
+  std::vector<double> block (4096U);
+  std::vector<event_type> block_events;
+  std::vector<double> converted (
+      converter == nullptr ? 0U : converter->max_output (block.size ()));
+  // The number of leading output samples which are still to be discarded:
+  // the converter's delay measured at the output rate.
+  auto skip =
+      converter == nullptr
+          ? size_t{0}
+          : static_cast<size_t> (uint64_t{converter->latency ()} *
+                                 converter->out_rate () /
+                                 converter->in_rate ());
+  auto const write = [&] (span<double const> const b) {
+    if (converter == nullptr) {
+      samples.write (b);
+      return;
+    }
+    auto const n = converter->process (b, span<double>{converted});
+    auto const drop = std::min (skip, n);
+    skip -= drop;
+    samples.write (span<double const>{converted.data () + drop, n - drop});
+  };
+
+  // The channels which hold each note and, for each note, how many of them
+  // there are.
+  constexpr auto channels = size_t{16};
+  constexpr auto notes = size_t{128};
+  constexpr auto percussion_channel = 9U;
+  std::array<std::bitset<notes>, channels> held;
+  std::array<uint8_t, notes> holders{};
+
+  auto const sample_of = [] (note_event const &e) {
+    return static_cast<uint64_t> (std::llround (e.time * sample_rate));
+  };
+  auto const end =
+      (events.empty () ? uint64_t{0} : sample_of (events.back ())) + max_tail;
+  auto it = std::begin (events);
+  for (auto position = uint64_t{0}; position < end;) {
+    if (it == std::end (events) && voices.active_voices ().none ()) {
+      break;
+    }
+    auto const count = static_cast<size_t> (
+        std::min (uint64_t{block.size ()}, end - position));
+    // Gather the events which fall within this block.
+    block_events.clear ();
+    for (; it != std::end (events) && sample_of (*it) < position + count;
+         ++it) {
+      if (it->channel == percussion_channel || it->channel >= channels ||
+          it->note >= notes) {
+        continue;
+      }
+      auto &&is_held = held[it->channel][it->note];
+      auto &n = holders[it->note];
+      auto const offset = static_cast<uint32_t> (sample_of (*it) - position);
+      if (it->on) {
+        if (!is_held) {
+          is_held = true;
+          ++n;
+        }
+        block_events.push_back (event_type::make_note_on (it->note, offset));
+      } else if (is_held) {
+        is_held = false;
+        if (--n == 0U) {
+          block_events.push_back (
+              event_type::make_note_off (it->note, offset));
+        }
+      }
+    }
+    render (voices, span<event_type const>{block_events},
+            span<double>{block.data (), count});
+    auto length = count;
+    if (it == std::end (events) && voices.active_voices ().none ()) {
+      // The last voice became idle within this block: everything after its
+      // final sample is silence.
+      while (length > 0U && block[length - 1U] == 0.0) {
+        --length;
+      }
+    }
+    write (span<double const>{block.data (), length});
+    position += count;
+  }
+  if (converter != nullptr) {
+    // Push the last of the output through the converter's filter.
+    std::fill (std::begin (block), std::end (block), 0.0);
+    write (span<double const>{block.data (), converter->latency ()});
+  }
+}
+
+/// Renders the MIDI file at \p in_path to the WAVE file at \p out_path and
+/// reports the real-time factor: the duration of the audio divided by the time
+/// taken to produce it.
+///
+/// \param out_rate  The sample rate of the output file. If this differs from
+///   the engine's rate, the output is converted.
+int render_midi_file (char const *const in_path, char const *const out_path,
+                      unsigned const out_rate) {
+  auto const events = read_midi_file (span<uint8_t const>{read_file (in_path)});
+
+  std::ofstream of{out_path, std::ios::binary};
+  if (!of) {
+    std::cerr << "Error: could not open " << out_path << '\n';
+    return EXIT_FAILURE;
+  }
+  wav_stream samples{of, wav_format{out_rate, 1U, sample_format::int24}};
+  // Leave headroom for several simultaneous voices.
+  samples.set_gain (0.25);
+  std::optional<resampler> converter;
+  if (out_rate != sample_rate) {
+    converter.emplace (sample_rate, out_rate);
+  }
+
+  auto const start = std::chrono::steady_clock::now ();
+  play_events (events, one_second * 10U, samples,
+               converter ? &*converter : nullptr);
+  auto const ok = samples.close ();
+  std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now () - start;
+  if (!ok) {
+    std::cerr << "Error: could not write " << out_path << '\n';
+    return EXIT_FAILURE;
+  }
+
+  auto const audio =
+      static_cast<double> (samples.size ()) / static_cast<double> (out_rate);
+  std::cout << "Rendered " << events.size () << " events, " << audio
+            << " s of audio in " << elapsed.count () << " s ("
+            << audio / elapsed.count () << "x real time)\n";
+  return EXIT_SUCCESS;
+}
+
+/// Parses the output sample rate given on the command line.
+///
+/// \returns  The rate or std::nullopt if \p str is not a number or is not a
+///   rate to which the engine's output can be converted.
+std::optional<unsigned> parse_rate (std::string const &str) {
+  try {
+    auto pos = size_t{0};
+    auto const rate = std::stoul (str, &pos);
+    if (pos == str.size () && rate <= std::numeric_limits<unsigned>::max () &&
+        resampler::is_supported (sample_rate,
+                                 static_cast<unsigned> (rate))) {
+      return static_cast<unsigned> (rate);
+    }
+  } catch (std::logic_error const &) {
+    // std::invalid_argument or std::out_of_range from std::stoul().
+  }
+  return std::nullopt;
+}
+
+}  // end anonymous namespace
+
+int main (int argc, char const *argv[]) {
+  if (argc > 4) {
+    std::cerr << "Usage: " << argv[0] << " [input.mid [output.wav [rate]]]\n";
+    return EXIT_FAILURE;
+  }
+  char const *const out_path = argc > 2 ? argv[2] : "./output.wav";
+  if (argc > 1) {
+    auto out_rate = sample_rate;
+    if (argc > 3) {
+      // Check the rate before any file is opened.
+      auto const rate = parse_rate (argv[3]);
+      if (!rate) {
+        std::cerr << "Error: unsupported sample rate: " << argv[3] << '\n';
+        return EXIT_FAILURE;
+      }
+      out_rate = *rate;
+    }
+    try {
+      return render_midi_file (argv[1], out_path, out_rate);
+    } catch (std::exception const &ex) {
+      std::cerr << "Error: " << argv[1] << ": " << ex.what () << '\n';
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::ofstream of{out_path, std::ios::binary};
+  // Samples are written to the file as they are produced.
+  wav_stream samples{of, wav_format{sample_rate, 1U, sample_format::int24}};
+  play_demo (samples);
+  if (!samples.close ()) {
+    std::cerr << "Error: could not write " << out_path << '\n';
+    return EXIT_FAILURE;
+  }
 }
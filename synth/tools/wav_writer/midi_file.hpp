@@ -0,0 +1,275 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_MIDI_FILE_HPP
+#define SYNTH_MIDI_FILE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "synth/midi_parser.hpp"
+#include "synth/span.hpp"
+
+namespace synth {
+
+/// An error found while reading a Standard MIDI File.
+class midi_file_error : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+/// A note-on or note-off event read from a MIDI file.
+struct note_event {
+  /// The time of the event in seconds from the start of the file.
+  double time = 0.0;
+  /// True for note-on, false for note-off. A note-on with zero velocity is
+  /// reported as a note-off.
+  bool on = false;
+  uint8_t channel = 0;
+  uint8_t note = 0;
+  uint8_t velocity = 0;
+};
+
+namespace details {
+
+/// Reads big-endian values from a Standard MIDI File. Throws midi_file_error if
+/// a read would go beyond the end of the data.
+class smf_reader {
+public:
+  explicit constexpr smf_reader (span<uint8_t const> const data) noexcept
+      : data_{data} {}
+
+  constexpr bool empty () const noexcept { return pos_ >= data_.size (); }
+  constexpr size_t pos () const noexcept { return pos_; }
+
+  uint8_t u8 () {
+    this->need (1U);
+    return data_[pos_++];
+  }
+  uint8_t peek () {
+    this->need (1U);
+    return data_[pos_];
+  }
+  uint16_t u16 () {
+    auto const hi = this->u8 ();
+    return static_cast<uint16_t> ((hi << 8U) | this->u8 ());
+  }
+  uint32_t u32 () {
+    auto const hi = this->u16 ();
+    return (uint32_t{hi} << 16U) | this->u16 ();
+  }
+  /// Reads a variable-length quantity: up to four bytes of seven bits each,
+  /// most significant first, with bit 7 set on all but the last.
+  uint32_t vlq () {
+    auto result = uint32_t{0};
+    for (auto ctr = 0U; ctr < 4U; ++ctr) {
+      auto const b = this->u8 ();
+      result = (result << 7U) | (b & 0x7FU);
+      if ((b & 0x80U) == 0U) {
+        return result;
+      }
+    }
+    throw midi_file_error{"variable-length quantity is too long"};
+  }
+  /// Reads a chunk type ("MThd", "MTrk", and so on).
+  std::string fourcc () {
+    this->need (4U);
+    std::string result (reinterpret_cast<char const*> (data_.data () + pos_),
+                        4U);
+    pos_ += 4U;
+    return result;
+  }
+  void skip (size_t const n) {
+    this->need (n);
+    pos_ += n;
+  }
+
+private:
+  void need (size_t const n) const {
+    if (n > data_.size () - pos_) {
+      throw midi_file_error{"unexpected end of file"};
+    }
+  }
+
+  span<uint8_t const> data_;
+  size_t pos_ = 0;
+};
+
+/// An event from a single track. Times are in ticks.
+struct track_event {
+  uint64_t tick = 0;
+  enum class kind : uint8_t { note_on, note_off, tempo } k = kind::note_on;
+  uint8_t channel = 0;
+  uint8_t note = 0;
+  uint8_t velocity = 0;
+  /// The new tempo in microseconds per quarter note (tempo events only).
+  uint32_t tempo = 0;
+};
+
+/// Reads the events of a single MTrk chunk. \p r covers the chunk's payload
+/// and nothing else.
+///
+/// Meta and system exclusive events, whose lengths are given in the file, are
+/// skipped here (apart from tempo changes). Channel messages, including those
+/// which use running status, are decoded by a midi_parser.
+inline void read_track (smf_reader& r, std::vector<track_event>& out) {
+  auto tick = uint64_t{0};
+  midi_parser parser;
+  while (!r.empty ()) {
+    tick += r.vlq ();
+    auto const status = r.peek ();
+    if (status == 0xFFU) {  // Meta event.
+      r.skip (1U);
+      parser.reset ();  // Meta events cancel running status.
+      auto const type = r.u8 ();
+      auto const length = r.vlq ();
+      if (type == 0x2FU) {  // End of track.
+        break;
+      }
+      if (type == 0x51U && length == 3U) {  // Set tempo.
+        track_event e;
+        e.tick = tick;
+        e.k = track_event::kind::tempo;
+        e.tempo = uint32_t{r.u8 ()} << 16U;
+        e.tempo |= r.u16 ();
+        out.push_back (e);
+      } else {
+        r.skip (length);
+      }
+      continue;
+    }
+    if (status == 0xF0U || status == 0xF7U) {  // System exclusive.
+      r.skip (1U);
+      parser.reset ();
+      r.skip (r.vlq ());
+      continue;
+    }
+    if (status > 0xF0U) {
+      throw midi_file_error{"unexpected system message in track"};
+    }
+    if (status < 0x80U && parser.status () == 0U) {
+      throw midi_file_error{"data byte without a status byte"};
+    }
+
+    // Feed the parser the status byte (if there is one) and then data bytes
+    // until it completes the message.
+    auto complete = false;
+    for (auto first = true; !complete; first = false) {
+      auto const b = r.u8 ();
+      if (!first && (b & 0x80U) != 0U) {
+        throw midi_file_error{"incomplete channel message"};
+      }
+      parser.parse (b, [&] (midi_message const& m) {
+        complete = true;
+        if (m.kind != midi_kind::note_on && m.kind != midi_kind::note_off) {
+          return;
+        }
+        track_event e;
+        e.tick = tick;
+        e.k = m.kind == midi_kind::note_on ? track_event::kind::note_on
+                                           : track_event::kind::note_off;
+        e.channel = m.channel;
+        e.note = m.data1;
+        e.velocity = m.data2;
+        out.push_back (e);
+      });
+    }
+  }
+}
+
+}  // end namespace details
+
+/// Reads a Standard MIDI File (format 0 or 1) and returns its note events in
+/// time order. Events from different tracks which happen at the same time
+/// are ordered by track. Tempo changes from any track apply to all of them.
+///
+/// \param data  The contents of the file.
+/// \returns  The note events in the file.
+inline std::vector<note_event> read_midi_file (span<uint8_t const> const data) {
+  details::smf_reader r{data};
+  if (r.fourcc () != "MThd") {
+    throw midi_file_error{"not a Standard MIDI File"};
+  }
+  auto const header_length = r.u32 ();
+  if (header_length < 6U) {
+    throw midi_file_error{"header chunk is too short"};
+  }
+  auto const format = r.u16 ();
+  auto const tracks = r.u16 ();
+  auto const division = r.u16 ();
+  r.skip (header_length - 6U);
+  if (format > 1U) {
+    throw midi_file_error{"only format 0 and 1 files are supported"};
+  }
+
+  std::vector<details::track_event> events;
+  for (auto track = 0U; track < tracks && !r.empty ();) {
+    auto const type = r.fourcc ();
+    auto const length = r.u32 ();
+    auto const start = r.pos ();
+    r.skip (length);  // Throws if the chunk is truncated.
+    if (type != "MTrk") {
+      continue;  // Unknown chunks must be ignored.
+    }
+    // Reading the track through its own reader stops an event whose length
+    // runs beyond the end of the chunk from consuming the chunk which follows.
+    // Anything after the end-of-track event is ignored.
+    details::smf_reader track_reader{data.subspan (start, length)};
+    details::read_track (track_reader, events);
+    ++track;
+  }
+  std::stable_sort (std::begin (events), std::end (events),
+                    [] (details::track_event const& a,
+                        details::track_event const& b) {
+                      return a.tick < b.tick;
+                    });
+
+  // Convert the times from ticks to seconds.
+  auto seconds_per_tick = 0.0;
+  auto const smpte = (division & 0x8000U) != 0U;
+  if (smpte) {
+    // The upper byte is the negative frames per second (-29 means 29.97).
+    auto const fps = -static_cast<int8_t> (division >> 8U);
+    auto const ticks_per_frame = division & 0xFFU;
+    if (fps <= 0 || ticks_per_frame == 0U) {
+      throw midi_file_error{"bad SMPTE time division"};
+    }
+    seconds_per_tick =
+        1.0 / ((fps == 29 ? 29.97 : static_cast<double> (fps)) *
+               static_cast<double> (ticks_per_frame));
+  } else if (division == 0U) {
+    throw midi_file_error{"time division is zero"};
+  }
+  auto tempo = 500000.0;  // Microseconds per quarter note: 120 bpm.
+  auto const seconds_per_tick_at = [&] () {
+    return smpte ? seconds_per_tick
+                 : tempo / (1e6 * static_cast<double> (division));
+  };
+
+  std::vector<note_event> result;
+  result.reserve (events.size ());
+  auto last_tick = uint64_t{0};
+  auto time = 0.0;
+  for (auto const& e : events) {
+    time += static_cast<double> (e.tick - last_tick) * seconds_per_tick_at ();
+    last_tick = e.tick;
+    if (e.k == details::track_event::kind::tempo) {
+      tempo = static_cast<double> (e.tempo);
+      continue;
+    }
+    note_event n;
+    n.time = time;
+    n.on = e.k == details::track_event::kind::note_on;
+    n.channel = e.channel;
+    n.note = e.note;
+    n.velocity = e.velocity;
+    result.push_back (n);
+  }
+  return result;
+}
+
+}  // end namespace synth
+
+#endif  // SYNTH_MIDI_FILE_HPP
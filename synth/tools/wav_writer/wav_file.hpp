@@ -3,13 +3,66 @@
 #define SYNTH_WAV_FILE_HPP
 
 #include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <type_traits>
 
+#include "synth/convert.hpp"
+#include "synth/span.hpp"
+#include "synth/uint.hpp"
+
 namespace synth {
 
+/// The encoding of the samples in a WAVE file.
+enum class sample_format : uint8_t {
+  int16,    ///< 16-bit signed integer PCM.
+  int24,    ///< 24-bit signed integer PCM.
+  int32,    ///< 32-bit signed integer PCM.
+  float32,  ///< 32-bit IEEE floating point (WAVE_FORMAT_IEEE_FLOAT).
+};
+
+/// The dither added to samples as they are converted to the output format.
+enum class dither_mode : uint8_t {
+  none,  ///< No dither.
+  tpdf,  ///< Triangular probability density function dither (16-bit only).
+};
+
+/// Describes the layout of the sample data in a WAVE file.
+struct wav_format {
+  /// The sample rate in Hertz.
+  unsigned sample_rate = 48000U;
+  /// The number of channels. The samples of the channels are interleaved.
+  unsigned channels = 1U;
+  sample_format format = sample_format::int24;
+
+  constexpr bool is_float () const noexcept {
+    return format == sample_format::float32;
+  }
+  /// True if the format chunk uses WAVE_FORMAT_EXTENSIBLE. A file with more
+  /// than two channels needs its channel mask to say which speaker each channel
+  /// feeds.
+  constexpr bool is_extensible () const noexcept { return channels > 2U; }
+  constexpr unsigned bits_per_sample () const noexcept {
+    switch (format) {
+    case sample_format::int16: return 16U;
+    case sample_format::int24: return 24U;
+    case sample_format::int32:
+    case sample_format::float32: return 32U;
+    }
+    return 0U;
+  }
+  constexpr unsigned bytes_per_sample () const noexcept {
+    return bits_per_sample () / 8U;
+  }
+  /// The number of bytes in a frame (one sample from each channel).
+  constexpr unsigned block_align () const noexcept {
+    return channels * bytes_per_sample ();
+  }
+};
+
 namespace details {
 
 /// Writes a FourCC ("four-character code" AKA OSType) to an output iterator.
@@ -79,6 +132,13 @@ struct appender<32, OutputIterator> {
     return it;
   }
 };
+template <typename OutputIterator>
+struct appender<64, OutputIterator> {
+  OutputIterator operator() (uint64_t const v, OutputIterator it) const {
+    it = appender<32, OutputIterator>{}(static_cast<uint32_t> (v), it);
+    return appender<32, OutputIterator>{}(static_cast<uint32_t> (v >> 32), it);
+  }
+};
 
 /// \tparam Bits The number of bits of output to produce.
 /// \tparam OutputIterator  A type compatible with the requirements of an output
@@ -162,19 +222,38 @@ public:
     return *this;
   }
   append_iterator& operator* () noexcept { return *this; }
-  append_iterator& operator++ () noexcept {
-    it_++;
-    return *this;
-  }
-  append_iterator operator++ (int) noexcept {
-    it_++;
-    return *this;
-  }
+  // append() has already advanced it_ past the bytes of the sample so
+  // incrementing is a no-op. (Advancing it_ here too would leave a gap after
+  // every sample when the underlying iterator is a pointer.)
+  append_iterator& operator++ () noexcept { return *this; }
+  append_iterator operator++ (int) noexcept { return *this; }
 
 private:
   OutputIterator it_;
 };
 
+/// Converts samples to \p format and writes them as little-endian bytes. The
+/// format is chosen at run time; the conversions are those of convert.hpp.
+///
+/// \param in  The samples to be converted.
+/// \param format  The output sample format.
+/// \param out  The buffer to which the samples are written.
+/// \param dither  If not null, TPDF dither added to 16-bit samples.
+/// \param gain  A factor by which the samples are multiplied.
+/// \returns  A pointer one past the last byte written.
+inline uint8_t* encode (span<double const> const in,
+                        sample_format const format, span<uint8_t> const out,
+                        tpdf_dither* const dither, double const gain = 1.0) {
+  switch (format) {
+  case sample_format::int16: return to_pcm<16> (in, out, gain, dither);
+  case sample_format::int24: return to_pcm<24> (in, out, gain);
+  case sample_format::int32: return to_pcm<32> (in, out, gain);
+  case sample_format::float32:
+    return to_float32 (in, out, static_cast<float> (gain));
+  }
+  return out.data ();
+}
+
 /// \tparam OutputIterator  A type compatible with the requirements of an output
 ///   iterator.
 /// \param riff_size  The size of the output file in bytes.
@@ -189,26 +268,33 @@ OutputIterator write_header (uint32_t const riff_size, OutputIterator dest) {
   return dest;
 }
 
-// The size of the RIFF chunk is drawn from the size of the following header,
-// format, and data chunks. The latter includes the sample data.
-constexpr auto bit_depth = uint8_t{24};
-static_assert (bit_depth % 8 == 0 && bit_depth <= 32U,
-               "bit depth must be a multiple of 8 and less than 33");
-constexpr uint32_t format_size = sizeof (uint16_t)     // wFormatTag
-                                 + sizeof (uint16_t)   // wChannels
-                                 + sizeof (uint32_t)   // dwSamplesPerSec
-                                 + sizeof (uint32_t)   // dwAvgBytesPerSec
-                                 + sizeof (uint16_t)   // wBlockAlign
-                                 + sizeof (uint16_t);  // wBitsPerSample
+/// The size of the WAVE_FORMAT_EXTENSIBLE fields which follow cbSize.
+constexpr uint16_t extensible_size = sizeof (uint16_t)    // wValidBitsPerSample
+                                     + sizeof (uint32_t)  // dwChannelMask
+                                     + 16U;               // SubFormat
+
+/// \returns The size of the format chunk payload for \p format.
+constexpr uint32_t format_size (wav_format const& format) noexcept {
+  return uint32_t{sizeof (uint16_t)      // wFormatTag
+                  + sizeof (uint16_t)    // wChannels
+                  + sizeof (uint32_t)    // dwSamplesPerSec
+                  + sizeof (uint32_t)    // dwAvgBytesPerSec
+                  + sizeof (uint16_t)    // wBlockAlign
+                  + sizeof (uint16_t)}   // wBitsPerSample
+         + (format.is_extensible () || format.is_float ()
+                ? uint32_t{sizeof (uint16_t)}  // Non-PCM formats add cbSize.
+                : 0U)
+         + (format.is_extensible () ? uint32_t{extensible_size} : 0U);
+}
 
 /// \tparam OutputIterator  A type compatible with the requirements of an output
 ///   iterator.
-/// \param sample_rate  The sample rate in Hertz.
+/// \param format  The layout of the sample data.
 /// \param dest  The beginning of the destination range.
 /// \returns  Output iterator to the element in the destination range, one past
 ///   the last element written.
 template <typename OutputIterator>
-OutputIterator write_format (unsigned const sample_rate, OutputIterator dest) {
+OutputIterator write_format (wav_format const& format, OutputIterator dest) {
   // WAVE format chunk common fields:
   // struct {
   //   uint16_t wFormatTag;       // Format category
@@ -218,24 +304,60 @@ OutputIterator write_format (unsigned const sample_rate, OutputIterator dest) {
   //   uint16_t wBlockAlign;      // Data block size
   // }
   constexpr auto WAVE_FORMAT_PCM = uint16_t{0x0001};
+  constexpr auto WAVE_FORMAT_IEEE_FLOAT = uint16_t{0x0003};
+  constexpr auto WAVE_FORMAT_EXTENSIBLE = uint16_t{0xFFFE};
+  auto const tag =
+      format.is_float () ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
   // WAVE format chunk header.
   dest = append4cc ('f', 'm', 't', ' ', dest);
-  dest = append<32> (format_size, dest);
+  dest = append<32> (format_size (format), dest);
   // Now the WAVE format chunk common fields.
-  dest = append<16> (WAVE_FORMAT_PCM, dest);  // wFormatTag (PCM audio format)
-  dest = append<16> (uint16_t{1U}, dest);     // wChannels (Number of channels)
-  dest = append<32> (static_cast<uint32_t> (sample_rate),
+  dest = append<16> (format.is_extensible () ? WAVE_FORMAT_EXTENSIBLE : tag,
+                     dest);  // wFormatTag (audio format)
+  dest = append<16> (static_cast<uint16_t> (format.channels),
+                     dest);  // wChannels (Number of channels)
+  dest = append<32> (static_cast<uint32_t> (format.sample_rate),
                      dest);  // dwSamplesPerSec (sample rate)
-  dest = append<32> (static_cast<uint32_t> ((sample_rate * bit_depth) / 8U),
-                     dest);  // dwAvgBytesPerSec (bytes per second)
-  dest = append<16> (static_cast<uint16_t> (bit_depth / 8U),
+  dest = append<32> (
+      static_cast<uint32_t> (format.sample_rate * format.block_align ()),
+      dest);  // dwAvgBytesPerSec (bytes per second)
+  dest = append<16> (static_cast<uint16_t> (format.block_align ()),
                      dest);  // wBlockAlign (bytes per block)
 
-  // PCM format specific
+  // PCM and IEEE float format specific
   // struct {
   //   uint16_t wBitsPerSample; // Sample size
   // }
-  dest = append<16> (uint16_t{bit_depth}, dest);
+  dest = append<16> (static_cast<uint16_t> (format.bits_per_sample ()), dest);
+  if (format.is_extensible ()) {
+    // WAVE_FORMAT_EXTENSIBLE
+    // struct {
+    //   uint16_t cbSize;              // Size of the extension (22)
+    //   uint16_t wValidBitsPerSample; // Bits of precision
+    //   uint32_t dwChannelMask;       // Speaker position of each channel
+    //   GUID SubFormat;               // The format tag in a GUID
+    // }
+    // The channels feed the first speaker positions in order. There are 18
+    // positions; a file with more channels does not assign them.
+    constexpr auto speakers = 18U;
+    auto const mask = format.channels <= speakers
+                          ? (uint32_t{1} << format.channels) - 1U
+                          : uint32_t{0};
+    dest = append<16> (extensible_size, dest);  // cbSize
+    dest = append<16> (static_cast<uint16_t> (format.bits_per_sample ()),
+                       dest);  // wValidBitsPerSample
+    dest = append<32> (mask, dest);  // dwChannelMask
+    // SubFormat is {tag-0000-0010-8000-00AA00389B71}. Its first three fields
+    // are little-endian.
+    dest = append<32> (uint32_t{tag}, dest);
+    dest = append<16> (uint16_t{0x0000}, dest);
+    dest = append<16> (uint16_t{0x0010}, dest);
+    for (auto const b : {0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71}) {
+      dest = append<8> (static_cast<uint8_t> (b), dest);
+    }
+  } else if (format.is_float ()) {
+    dest = append<16> (uint16_t{0}, dest);  // cbSize (no extension)
+  }
   return dest;
 }
 
@@ -248,7 +370,7 @@ OutputIterator write_format (unsigned const sample_rate, OutputIterator dest) {
 /// \param data_size  The number of bytes in the chunk payload.
 /// \param dest  The iterator to which data it written.
 /// \return Output iterator one past the last element written.
-template <typename ForwardIterator, typename OutputIterator>
+template <unsigned Bits, typename ForwardIterator, typename OutputIterator>
 OutputIterator write_data (ForwardIterator const first,
                            ForwardIterator const last, uint32_t const data_size,
                            OutputIterator dest) {
@@ -256,9 +378,8 @@ OutputIterator write_data (ForwardIterator const first,
   dest = append4cc ('d', 'a', 't', 'a', dest);  // Data ckID
   dest = append<32> (data_size, dest);          // Data ckSize
   // Data chunk contents.
-  dest =
-      std::copy (first, last, append_iterator<OutputIterator, bit_depth> (dest))
-          .it ();
+  dest = std::copy (first, last, append_iterator<OutputIterator, Bits> (dest))
+             .it ();
   return dest;
 }
 
@@ -274,6 +395,9 @@ OutputIterator write_data (ForwardIterator const first,
 /// \param dest  The beginning of the destination range.
 /// \returns  Output iterator to the element in the destination range, one past
 ///   the last element written.
+///
+/// The file holds a single channel of 24-bit samples. wav_stream can write
+/// other formats.
 template <typename ForwardIterator, typename OutputIterator,
           typename = typename std::enable_if_t<std::is_floating_point_v<
               typename std::iterator_traits<ForwardIterator>::value_type>>>
@@ -283,19 +407,35 @@ OutputIterator emit_wave_file (ForwardIterator first_sample,
                                OutputIterator dest) {
   using namespace details;
 
+  constexpr auto bits = 24U;
+  constexpr auto bytes_per_sample = bits / 8U;
+  wav_format const format{sample_rate, 1U, sample_format::int24};
+
   constexpr uint32_t fourcc_size = 4U;
   constexpr uint32_t chunk =
       fourcc_size + sizeof (uint32_t);  // Size of each chunk's ckID + ckSize
-  uint32_t const data_size =
-      clamped_distance (first_sample, last_sample) * (bit_depth / 8U);
-  uint32_t const riff_size = fourcc_size    // WAVE signature
-                             + chunk        // Format chunk header
-                             + format_size  // Format chunk contents
-                             + chunk        // Data chunk header
-                             + data_size;   // Data chunk contents
+  uint32_t const header_size = fourcc_size             // WAVE signature
+                               + chunk                 // Format chunk header
+                               + format_size (format)  // Format chunk contents
+                               + chunk;                // Data chunk header
+  // The RIFF and data chunk sizes are 32-bit values which limits the number of
+  // samples that the file can hold. (wav_stream can write longer files.)
+  uint32_t const max_samples =
+      (std::numeric_limits<uint32_t>::max () - header_size) / bytes_per_sample;
+  using difference_type =
+      typename std::iterator_traits<ForwardIterator>::difference_type;
+  assert (std::distance (first_sample, last_sample) <=
+          static_cast<difference_type> (max_samples));
+  uint32_t const samples =
+      clamped_distance (first_sample, last_sample, max_samples);
+  uint32_t const data_size = samples * bytes_per_sample;
+  uint32_t const riff_size = header_size + data_size;
   dest = write_header (riff_size, dest);
-  dest = write_format (sample_rate, dest);
-  dest = write_data (first_sample, last_sample, data_size, dest);
+  dest = write_format (format, dest);
+  dest = write_data<bits> (
+      first_sample,
+      std::next (first_sample, static_cast<difference_type> (samples)),
+      data_size, dest);
   return dest;
 }
 
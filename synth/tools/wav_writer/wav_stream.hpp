@@ -0,0 +1,326 @@
+// -*- mode: c++; coding: utf-8-unix; -*-
+#ifndef SYNTH_WAV_STREAM_HPP
+#define SYNTH_WAV_STREAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "synth/span.hpp"
+#include "synth/uint.hpp"
+#include "wav_file.hpp"
+
+namespace synth {
+
+/// Writes a WAVE file incrementally, in bounded memory, as its samples are
+/// produced.
+///
+/// Samples are converted to the file's sample format (adding dither if
+/// requested) into one of a small, fixed set of buffers. A buffer
+/// which has been filled is handed to a background thread which writes it to
+/// the output stream while the caller fills the next one. The caller waits only
+/// if it gets a whole buffer ahead of the disk.
+///
+/// The sizes in the RIFF and data chunk headers aren't known until the last
+/// sample has been written; close() seeks back to the start of the stream to
+/// fill them in. A RIFF file cannot be larger than 4 GiB; a longer file is
+/// written in the RF64 format (EBU Tech 3306). To allow this, the header
+/// reserves space for the RF64 "ds64" chunk with a "JUNK" chunk that readers of
+/// ordinary WAVE files ignore.
+class wav_stream {
+public:
+  using value_type = double;
+  /// The number of buffers: one is filled while the other is written.
+  static constexpr auto buffers = size_t{2};
+  static constexpr auto default_buffer_size = size_t{1} << 20;  // bytes
+
+  /// \param os  The stream to which the file is written. It must be seekable
+  ///   and must remain valid until close() has returned.
+  /// \param format  The sample rate, number of channels, and sample format of
+  ///   the file.
+  /// \param dither  The dither added to the samples. Dither is only applied to
+  ///   16-bit output.
+  /// \param buffer_size  The size in bytes of each of the buffers.
+  wav_stream (std::ostream& os, wav_format const& format,
+              dither_mode dither = dither_mode::none,
+              size_t buffer_size = default_buffer_size);
+  wav_stream (wav_stream const&) = delete;
+  ~wav_stream () noexcept;
+
+  wav_stream& operator= (wav_stream const&) = delete;
+
+  /// Appends a block of samples to the file. The samples of each frame are
+  /// interleaved: for stereo, the order is left, right, left, right, and so on.
+  /// A frame may be split between calls.
+  void write (span<double const> samples);
+  /// Appends a single sample to the file. This allows a wav_stream to be used
+  /// with std::back_inserter().
+  void push_back (double sample);
+
+  /// Writes any remaining samples and completes the file header. Waits for all
+  /// of the data to be written. The number of samples written must be a
+  /// multiple of the number of channels.
+  ///
+  /// \returns True if the file was written successfully.
+  bool close ();
+
+  /// Sets the factor by which subsequent samples are multiplied as they are
+  /// converted. Integer formats clip samples outside the range [-1, 1]
+  /// after the gain is applied.
+  void set_gain (double const gain) noexcept { gain_ = gain; }
+
+  /// The number of samples written so far.
+  uint64_t size () const noexcept { return samples_; }
+
+  /// Sets the RIFF chunk size above which close() writes an RF64 file. The
+  /// default is the largest size that the RIFF header can hold. A smaller value
+  /// allows the RF64 header to be tested without writing 4 GiB.
+  void set_rf64_threshold (uint64_t const bytes) noexcept {
+    rf64_threshold_ = bytes;
+  }
+
+private:
+  /// The size of the ds64 chunk payload (and of the JUNK chunk which reserves
+  /// space for it): riffSize, dataSize, sampleCount, and tableLength.
+  static constexpr auto ds64_size = uint32_t{3U * sizeof (uint64_t) +
+                                             sizeof (uint32_t)};
+  static constexpr auto chunk_header_size = uint32_t{8};  // ckID + ckSize
+  /// The size of the fact chunk payload: dwSampleLength.
+  static constexpr auto fact_size = uint32_t{sizeof (uint32_t)};
+
+  /// Returns the size of the file header.
+  uint32_t header_size () const noexcept;
+  /// Produces the file header for a data chunk of \p data_size bytes.
+  std::vector<uint8_t> make_header (uint64_t data_size) const;
+  /// Hands the buffer being filled to the writer thread and waits for the next
+  /// buffer to become available.
+  void submit ();
+  /// The body of the writer thread.
+  void run ();
+
+  std::ostream& os_;
+  wav_format const format_;
+  size_t const bytes_per_sample_;
+  size_t const buffer_size_;
+  std::optional<tpdf_dither> dither_;
+  double gain_ = 1.0;
+  uint64_t rf64_threshold_ = std::numeric_limits<uint32_t>::max ();
+  std::array<std::vector<uint8_t>, buffers> buffers_;
+  /// The number of bytes of each buffer which are in use.
+  std::array<size_t, buffers> used_{};
+  uint64_t samples_ = 0;
+  bool closed_ = false;
+
+  std::mutex mut_;
+  std::condition_variable cv_;
+  /// Buffers are filled and written in strict rotation. Buffer
+  /// submitted_%buffers is the one being filled by the caller; the buffers
+  /// from written_%buffers up to it are waiting for the writer thread.
+  uint64_t submitted_ = 0;
+  uint64_t written_ = 0;
+  bool stop_ = false;
+  bool failed_ = false;
+
+  std::thread thread_;
+};
+
+// (ctor)
+// ~~~~~~
+inline wav_stream::wav_stream (std::ostream& os, wav_format const& format,
+                               dither_mode const dither,
+                               size_t const buffer_size)
+    : os_{os},
+      format_{format},
+      bytes_per_sample_{format.bytes_per_sample ()},
+      buffer_size_{std::max (buffer_size - buffer_size % bytes_per_sample_,
+                             bytes_per_sample_)} {
+  assert (format.channels > 0U);
+  if (dither == dither_mode::tpdf && format.format == sample_format::int16) {
+    dither_.emplace ();
+  }
+  for (auto& b : buffers_) {
+    b.resize (buffer_size_);
+  }
+  // Write a placeholder header. Its sizes are filled in by close().
+  auto const h = make_header (0U);
+  os_.write (reinterpret_cast<char const*> (h.data ()),
+             static_cast<std::streamsize> (h.size ()));
+  thread_ = std::thread{[this] { this->run (); }};
+}
+
+// (dtor)
+// ~~~~~~
+inline wav_stream::~wav_stream () noexcept {
+  if (!closed_) {
+    (void)this->close ();
+  }
+}
+
+// header size
+// ~~~~~~~~~~~
+inline uint32_t wav_stream::header_size () const noexcept {
+  return uint32_t{12}                                       // RIFF + WAVE
+         + chunk_header_size + ds64_size                    // JUNK or ds64
+         + chunk_header_size + details::format_size (format_)  // fmt
+         + (format_.is_float () ? chunk_header_size + fact_size
+                                : 0U)  // fact
+         + chunk_header_size;          // data header
+}
+
+// make header
+// ~~~~~~~~~~~
+inline std::vector<uint8_t> wav_stream::make_header (
+    uint64_t const data_size) const {
+  using namespace details;
+  // A RIFF chunk holds an odd-sized data chunk followed by a pad byte.
+  auto const riff_size = uint64_t{header_size ()} - chunk_header_size +
+                         data_size + (data_size & 1U);
+  auto const frames = data_size / format_.block_align ();
+  constexpr auto placeholder = std::numeric_limits<uint32_t>::max ();
+  auto const rf64 = riff_size > rf64_threshold_;
+
+  std::vector<uint8_t> result;
+  result.reserve (header_size ());
+  auto dest = std::back_inserter (result);
+  if (rf64) {
+    dest = append4cc ('R', 'F', '6', '4', dest);
+    dest = append<32> (placeholder, dest);
+  } else {
+    dest = append4cc ('R', 'I', 'F', 'F', dest);
+    dest = append<32> (static_cast<uint32_t> (riff_size), dest);
+  }
+  dest = append4cc ('W', 'A', 'V', 'E', dest);
+  if (rf64) {
+    dest = append4cc ('d', 's', '6', '4', dest);
+    dest = append<32> (ds64_size, dest);
+    dest = append<64> (riff_size, dest);    // riffSize
+    dest = append<64> (data_size, dest);    // dataSize
+    dest = append<64> (frames, dest);       // sampleCount
+    dest = append<32> (uint32_t{0}, dest);  // tableLength
+  } else {
+    dest = append4cc ('J', 'U', 'N', 'K', dest);
+    dest = append<32> (ds64_size, dest);
+    dest = std::fill_n (dest, ds64_size, uint8_t{0});
+  }
+  dest = write_format (format_, dest);
+  if (format_.is_float ()) {
+    // Formats other than PCM must include a fact chunk.
+    dest = append4cc ('f', 'a', 'c', 't', dest);
+    dest = append<32> (fact_size, dest);
+    dest = append<32> (
+        rf64 || frames > placeholder ? placeholder
+                                     : static_cast<uint32_t> (frames),
+        dest);  // dwSampleLength
+  }
+  dest = append4cc ('d', 'a', 't', 'a', dest);
+  dest = append<32> (rf64 ? placeholder : static_cast<uint32_t> (data_size),
+                     dest);
+  assert (result.size () == header_size ());
+  return result;
+}
+
+// write
+// ~~~~~
+inline void wav_stream::write (span<double const> samples) {
+  assert (!closed_);
+  auto* const dither = dither_ ? &*dither_ : nullptr;
+  while (!samples.empty ()) {
+    auto const b = submitted_ % buffers;
+    auto& used = used_[b];
+    auto const count =
+        std::min (samples.size (), (buffer_size_ - used) / bytes_per_sample_);
+    details::encode (samples.subspan (0U, count), format_.format,
+                     span<uint8_t>{buffers_[b].data () + used,
+                                   buffer_size_ - used},
+                     dither, gain_);
+    used += count * bytes_per_sample_;
+    samples_ += count;
+    samples = samples.subspan (count);
+    if (used == buffer_size_) {
+      this->submit ();
+    }
+  }
+}
+
+// push back
+// ~~~~~~~~~
+inline void wav_stream::push_back (double const sample) {
+  this->write (span<double const>{&sample, 1U});
+}
+
+// submit
+// ~~~~~~
+inline void wav_stream::submit () {
+  std::unique_lock<std::mutex> lock{mut_};
+  ++submitted_;
+  cv_.notify_all ();
+  // Wait until the next buffer in the rotation has been written.
+  cv_.wait (lock, [this] { return submitted_ - written_ < buffers; });
+  used_[submitted_ % buffers] = 0U;
+}
+
+// run
+// ~~~
+inline void wav_stream::run () {
+  std::unique_lock<std::mutex> lock{mut_};
+  for (;;) {
+    cv_.wait (lock, [this] { return written_ < submitted_ || stop_; });
+    if (written_ == submitted_) {
+      return;  // Stopped and there's nothing left to write.
+    }
+    auto const b = written_ % buffers;
+    // The caller doesn't touch a submitted buffer so it can be written without
+    // holding the lock.
+    lock.unlock ();
+    os_.write (reinterpret_cast<char const*> (buffers_[b].data ()),
+               static_cast<std::streamsize> (used_[b]));
+    auto const ok = os_.good ();
+    lock.lock ();
+    failed_ = failed_ || !ok;
+    ++written_;
+    cv_.notify_all ();
+  }
+}
+
+// close
+// ~~~~~
+inline bool wav_stream::close () {
+  assert (!closed_);
+  closed_ = true;
+  if (used_[submitted_ % buffers] > 0U) {
+    std::lock_guard<std::mutex> const lock{mut_};
+    ++submitted_;
+  }
+  {
+    std::lock_guard<std::mutex> const lock{mut_};
+    stop_ = true;
+  }
+  cv_.notify_all ();
+  thread_.join ();
+
+  assert (samples_ % format_.channels == 0U && "incomplete frame");
+  auto const data_size = samples_ * bytes_per_sample_;
+  if (data_size % 2U != 0U) {
+    os_.put ('\0');  // The pad byte which follows an odd-sized chunk.
+  }
+  auto const h = make_header (data_size);
+  os_.seekp (0);
+  os_.write (reinterpret_cast<char const*> (h.data ()),
+             static_cast<std::streamsize> (h.size ()));
+  os_.seekp (0, std::ios_base::end);
+  os_.flush ();
+  return !failed_ && os_.good ();
+}
+
+}  // end namespace synth
+
+#endif  // SYNTH_WAV_STREAM_HPP
@@ -0,0 +1,131 @@
+#include <gmock/gmock.h>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "synth/blep_oscillator.hpp"
+
+using namespace synth;
+
+namespace {
+
+constexpr auto sample_rate = 48000U;
+using oscillator_type = blep_oscillator<sample_rate, nco_traits>;
+constexpr std::array<blep_waveform, 4> waveforms{
+    {blep_waveform::sawtooth, blep_waveform::square, blep_waveform::pulse,
+     blep_waveform::triangle}};
+
+/// The reference PolyBLEP residual for phase \p t and increment \p dt.
+double poly_blep (double t, double const dt) {
+  if (t < dt) {
+    t /= dt;
+    return t + t - t * t - 1.0;
+  }
+  if (t > 1.0 - dt) {
+    t = (t - 1.0) / dt;
+    return t * t + t + t + 1.0;
+  }
+  return 0.0;
+}
+
+/// The reference PolyBLAMP residual for phase \p t and increment \p dt.
+double poly_blamp (double t, double const dt) {
+  if (t < dt) {
+    t = t / dt - 1.0;
+    return -t * t * t / 3.0;
+  }
+  if (t > 1.0 - dt) {
+    t = (t - 1.0) / dt + 1.0;
+    return t * t * t / 3.0;
+  }
+  return 0.0;
+}
+
+double wrap (double const t) {
+  return t - std::floor (t);
+}
+
+/// Computes sample \p k of \p w in double precision.
+double reference (blep_waveform const w, double const dt, double const width,
+                  size_t const k) {
+  auto const t = wrap (static_cast<double> (k) * dt);
+  switch (w) {
+  case blep_waveform::sawtooth: return 2.0 * t - 1.0 - poly_blep (t, dt);
+  case blep_waveform::square:
+  case blep_waveform::pulse:
+    return (t < width ? 1.0 : -1.0) + poly_blep (t, dt) -
+           poly_blep (wrap (t - width), dt);
+  case blep_waveform::triangle:
+    return (t < 0.5 ? 4.0 * t - 1.0 : 3.0 - 4.0 * t) +
+           8.0 * dt * poly_blamp (t, dt) -
+           8.0 * dt * poly_blamp (wrap (t - 0.5), dt);
+  }
+  return 0.0;
+}
+
+std::vector<amplitude> render (oscillator_type& osc, size_t const samples) {
+  std::vector<amplitude> out (samples);
+  osc.render (span<amplitude>{out});
+  return out;
+}
+
+}  // end anonymous namespace
+
+TEST (BlepOscillator, MatchesReference) {
+  for (auto const w : waveforms) {
+    for (auto const f : {55.0, 440.0, 3520.0, 15000.0}) {
+      auto const freq = frequency::fromfp (f);
+      // The exact frequency produced by the phase accumulator.
+      auto const dt = static_cast<double> (
+                          oscillator<sample_rate, nco_traits>::phase_increment (
+                              freq)
+                              .get ()) /
+                      4294967296.0;
+      auto const width = w == blep_waveform::pulse ? 0.3 : 0.5;
+      oscillator_type osc{w};
+      osc.set_frequency (freq);
+      osc.set_pulse_width (0.3);
+      auto const out = render (osc, 4096U);
+      for (auto k = size_t{0}; k < out.size (); ++k) {
+        ASSERT_NEAR (out[k].as_double (), reference (w, dt, width, k), 1e-4)
+            << "waveform " << static_cast<unsigned> (w) << " frequency " << f
+            << " sample " << k;
+      }
+    }
+  }
+}
+
+TEST (BlepOscillator, BlocksMatchTick) {
+  for (auto const w : waveforms) {
+    oscillator_type whole{w};
+    oscillator_type ticks{w};
+    whole.set_frequency (frequency::fromfp (1234.5));
+    ticks.set_frequency (frequency::fromfp (1234.5));
+    auto const expected = render (whole, 1000U);
+    for (auto k = size_t{0}; k < expected.size (); ++k) {
+      ASSERT_EQ (ticks.tick (), expected[k])
+          << "waveform " << static_cast<unsigned> (w) << " sample " << k;
+    }
+  }
+}
+
+TEST (BlepOscillator, PulseWidthSetsMean) {
+  oscillator_type osc{blep_waveform::pulse};
+  // 48000/480 = 100 samples per cycle.
+  osc.set_frequency (frequency::fromfp (480.0));
+  osc.set_pulse_width (0.25);
+  auto const out = render (osc, 48000U);
+  auto sum = 0.0;
+  for (auto const a : out) {
+    sum += a.as_double ();
+  }
+  EXPECT_NEAR (sum / static_cast<double> (out.size ()), -0.5, 0.01);
+}
+
+TEST (BlepOscillator, ZeroFrequency) {
+  oscillator_type osc;
+  osc.set_frequency (frequency::fromint (0U));
+  auto const out = render (osc, 16U);
+  EXPECT_THAT (out, testing::Each (amplitude::fromfp (-1.0)));
+}
@@ -0,0 +1,112 @@
+#include <gmock/gmock.h>
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include "synth/compact_wavetable.hpp"
+#include "synth/nco.hpp"
+
+using namespace synth;
+
+namespace {
+
+using traits = nco_traits;
+using phase_index_type = oscillator_info<traits>::phase_index_type;
+constexpr auto table_size = size_t{1} << traits::wavetable_N;
+constexpr auto shift = oscillator_info<traits>::accumulator_fractional_bits;
+/// The error introduced by holding an entry in 16 bits: half an LSB of
+/// rounding plus the clamping of +1.
+constexpr auto tolerance = 1.0 / 32768.0;
+
+struct linear_traits {
+  static constexpr auto wavetable_N = 8U;
+  static constexpr auto M = 32U;
+  static constexpr auto interpolation = synth::interpolation::linear;
+};
+
+/// Checks that every entry of compact table \p c is within 16-bit tolerance of
+/// the corresponding entry of full table \p w.
+template <typename Compact, typename Full>
+void expect_near_table (Compact const& c, Full const& w) {
+  for (auto i = size_t{0}; i < table_size; ++i) {
+    auto const phase = phase_index_type::frombits (
+        static_cast<phase_index_type::value_type> (i << shift));
+    EXPECT_NEAR (c.phase_to_amplitude (phase).as_double (),
+                 w.phase_to_amplitude (phase).as_double (), tolerance)
+        << "index " << i;
+  }
+}
+
+}  // end anonymous namespace
+
+TEST (CompactWavetable, Footprint) {
+  // 2^(N-2)+1 16-bit entries rather than 2^N 32-bit entries.
+  EXPECT_EQ (compact_sine<traits>.stored_size (), table_size / 4U + 1U);
+  EXPECT_LE (sizeof (compact_sine<traits>), sizeof (sine<traits>) / 7U);
+  EXPECT_LE (sizeof (compact_triangle<traits>), sizeof (triangle<traits>) / 7U);
+  EXPECT_EQ (sizeof (compact_square<traits>), sizeof (square<traits>) / 4U);
+  EXPECT_EQ (sizeof (compact_sawtooth<traits>), sizeof (sawtooth<traits>) / 2U);
+}
+
+TEST (CompactWavetable, Sine) {
+  expect_near_table (compact_sine<traits>, sine<traits>);
+}
+
+TEST (CompactWavetable, Triangle) {
+  expect_near_table (compact_triangle<traits>, triangle<traits>);
+}
+
+TEST (CompactWavetable, Sawtooth) {
+  expect_near_table (compact_sawtooth<traits>, sawtooth<traits>);
+}
+
+TEST (CompactWavetable, Square) {
+  auto const& c = compact_square<traits>;
+  for (auto i = size_t{0}; i < table_size; ++i) {
+    EXPECT_NEAR (c[i].as_double (), i < table_size / 2U ? 1.0 : -1.0, tolerance)
+        << "index " << i;
+  }
+}
+
+TEST (CompactWavetable, FullPrecisionEntries) {
+  // With amplitude entries only the symmetry is exploited so the table matches
+  // the full one exactly (other than at θ=π/2 where sin is evaluated directly).
+  compact_wavetable<traits, symmetry::quarter_wave_odd, amplitude> const c{
+      [] (double const theta) { return std::sin (theta); }};
+  auto const& w = sine<traits>;
+  for (auto i = size_t{0}; i <= table_size / 4U; ++i) {
+    EXPECT_EQ (c[i], w.data ()[i]) << "index " << i;
+  }
+  for (auto i = size_t{0}; i < table_size; ++i) {
+    EXPECT_NEAR (c[i].as_double (), w.data ()[i].as_double (), 1.0 / (1 << 21))
+        << "index " << i;
+  }
+}
+
+TEST (CompactWavetable, Interpolated) {
+  using small_phase = oscillator_info<linear_traits>::phase_index_type;
+  auto const& c = compact_sine<linear_traits>;
+  auto const& w = sine<linear_traits>;
+  // An arbitrary odd increment so that the phases fall between entries.
+  auto phase = uint32_t{0};
+  for (auto ctr = 0U; ctr < 4096U; ++ctr) {
+    auto const p = small_phase::frombits (phase);
+    EXPECT_NEAR (c.phase_to_amplitude (p).as_double (),
+                 w.phase_to_amplitude (p).as_double (), tolerance);
+    phase += 0x9E3779B9U;
+  }
+}
+
+TEST (CompactWavetable, Oscillator) {
+  constexpr auto sample_rate = 48000U;
+  using compact = std::decay_t<decltype (compact_sine<traits>)>;
+  oscillator<sample_rate, traits, compact> osc{&compact_sine<traits>};
+  oscillator<sample_rate, traits> expected{&sine<traits>};
+  osc.set_frequency (frequency::fromfp (440.0));
+  expected.set_frequency (frequency::fromfp (440.0));
+  for (auto ctr = 0U; ctr < 1000U; ++ctr) {
+    EXPECT_NEAR (osc.tick ().as_double (), expected.tick ().as_double (),
+                 tolerance);
+  }
+}
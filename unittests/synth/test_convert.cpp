@@ -0,0 +1,243 @@
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "synth/convert.hpp"
+
+using namespace synth;
+
+namespace {
+
+/// A reference conversion of a single sample to a Bits-bit integer.
+template <unsigned Bits>
+int32_t reference (double const x, double const gain) {
+  auto const scale = static_cast<double> ((uint64_t{1} << Bits) - 1U) / 2.0;
+  return static_cast<int32_t> (
+      std::floor (std::max (std::min (x * gain, 1.0), -1.0) * scale));
+}
+
+/// Reads the Bits-bit little-endian signed integer at \p p.
+template <unsigned Bits>
+int32_t read (uint8_t const* p) {
+  auto v = uint32_t{0};
+  for (auto b = 0U; b < Bits / 8U; ++b) {
+    v |= uint32_t{p[b]} << (8U * b);
+  }
+  // Sign-extend.
+  auto const sign = uint32_t{1} << (Bits - 1U);
+  return static_cast<int32_t> (static_cast<int64_t> (v ^ sign) -
+                               static_cast<int64_t> (sign));
+}
+
+/// Returns samples including some beyond the [-1, +1] range and both of its
+/// end points. The number of samples isn't a multiple of the conversion block
+/// size or vector width.
+std::vector<double> samples () {
+  std::mt19937 gen{42};
+  std::uniform_real_distribution<double> dist{-1.5, 1.5};
+  std::vector<double> result{-1.0, 1.0, 0.0, -0.0};
+  for (auto ctr = 0U; ctr < 1000U; ++ctr) {
+    result.push_back (dist (gen));
+  }
+  return result;
+}
+
+template <unsigned Bits>
+void check_pcm (double const gain) {
+  auto const in = samples ();
+  std::vector<uint8_t> out (in.size () * (Bits / 8U) + 1U, uint8_t{0xFF});
+  auto const* const end = to_pcm<Bits> (span<double const>{in},
+                                        span<uint8_t>{out}, gain);
+  EXPECT_EQ (end, out.data () + in.size () * (Bits / 8U));
+  EXPECT_EQ (out.back (), 0xFF) << "wrote beyond the end of the output";
+  for (auto k = size_t{0}; k < in.size (); ++k) {
+    EXPECT_EQ (read<Bits> (out.data () + k * (Bits / 8U)),
+               reference<Bits> (in[k], gain))
+        << "sample " << k << " (" << in[k] << ")";
+  }
+}
+
+}  // end anonymous namespace
+
+TEST (Convert, Pcm16) {
+  check_pcm<16> (1.0);
+}
+TEST (Convert, Pcm24) {
+  check_pcm<24> (1.0);
+}
+TEST (Convert, Pcm32) {
+  check_pcm<32> (1.0);
+}
+TEST (Convert, Gain) {
+  check_pcm<16> (0.5);
+  check_pcm<24> (2.0);
+}
+
+TEST (Convert, Range) {
+  std::vector<double> const in{-1.0, 1.0};
+  std::vector<uint8_t> out (in.size () * 3U);
+  to_pcm<24> (span<double const>{in}, span<uint8_t>{out});
+  EXPECT_EQ (read<24> (out.data ()), -(int32_t{1} << 23));
+  EXPECT_EQ (read<24> (out.data () + 3), (int32_t{1} << 23) - 1);
+}
+
+TEST (Convert, Dither) {
+  auto const in = samples ();
+  std::vector<uint8_t> out (in.size () * 2U);
+  tpdf_dither dither;
+  to_pcm<16> (span<double const>{in}, span<uint8_t>{out}, 1.0, &dither);
+  auto differences = 0U;
+  for (auto k = size_t{0}; k < in.size (); ++k) {
+    auto const expected = reference<16> (in[k], 1.0);
+    auto const actual = read<16> (out.data () + k * 2U);
+    // TPDF dither is less than one LSB in each direction.
+    EXPECT_LE (std::abs (actual - expected), 1) << "sample " << k;
+    differences += actual != expected;
+  }
+  EXPECT_GT (differences, 0U);
+}
+
+TEST (Convert, DitherDistribution) {
+  tpdf_dither dither;
+  std::vector<double> d (10001);
+  dither.fill (span<double>{d});
+  auto sum = 0.0;
+  auto near_zero = 0U;
+  for (auto const v : d) {
+    EXPECT_GT (v, -1.0);
+    EXPECT_LT (v, 1.0);
+    sum += v;
+    near_zero += std::abs (v) < 0.5;
+  }
+  EXPECT_NEAR (sum / static_cast<double> (d.size ()), 0.0, 0.02);
+  // A triangular distribution has 3/4 of its values in (-0.5, 0.5).
+  EXPECT_NEAR (
+      static_cast<double> (near_zero) / static_cast<double> (d.size ()), 0.75,
+      0.02);
+}
+
+TEST (Convert, DitherMoments) {
+  // The difference of two independent uniform values in [0, 1) has mean 0 and
+  // variance 1/12 + 1/12 = 1/6. Correlated values would change the variance
+  // and the correlation between neighbouring samples.
+  tpdf_dither dither{7U};
+  std::vector<double> d (200003);
+  dither.fill (span<double>{d});
+  auto const n = static_cast<double> (d.size ());
+  auto sum = 0.0;
+  auto sum_squares = 0.0;
+  auto sum_products = 0.0;
+  for (auto k = size_t{0}; k < d.size (); ++k) {
+    sum += d[k];
+    sum_squares += d[k] * d[k];
+    if (k > 0U) {
+      sum_products += d[k] * d[k - 1U];
+    }
+  }
+  auto const mean = sum / n;
+  auto const variance = sum_squares / n - mean * mean;
+  EXPECT_NEAR (mean, 0.0, 0.005);
+  EXPECT_NEAR (variance, 1.0 / 6.0, 0.003);
+  EXPECT_NEAR (sum_products / (n - 1.0) / variance, 0.0, 0.01);
+}
+
+TEST (Convert, Float32) {
+  auto const in = samples ();
+  std::vector<uint8_t> out (in.size () * 4U);
+  to_float32 (span<double const>{in}, span<uint8_t>{out}, 0.5F);
+  for (auto k = size_t{0}; k < in.size (); ++k) {
+    auto const bits = static_cast<uint32_t> (read<32> (out.data () + k * 4U));
+    float f;
+    std::memcpy (&f, &bits, sizeof (f));
+    EXPECT_EQ (f, static_cast<float> (in[k] * 0.5)) << "sample " << k;
+  }
+}
+
+TEST (Convert, AmplitudeToFloat) {
+  std::vector<amplitude> const in{amplitude::fromfp (0.5),
+                                  amplitude::fromfp (-0.25), amplitude{}};
+  std::vector<float> out (in.size ());
+  convert (span<amplitude const>{in}, span<float>{out}, 0.5F);
+  EXPECT_THAT (out, testing::ElementsAre (0.25F, -0.125F, 0.0F));
+}
+
+TEST (Convert, AmplitudeToPcm) {
+  std::vector<amplitude> const in{amplitude::fromfp (0.5),
+                                  amplitude::fromfp (-1.0)};
+  std::vector<uint8_t> out (in.size () * 2U);
+  to_pcm<16> (span<amplitude const>{in}, span<uint8_t>{out});
+  EXPECT_EQ (read<16> (out.data ()), reference<16> (0.5, 1.0));
+  EXPECT_EQ (read<16> (out.data () + 2), -32768);
+}
+
+TEST (Convert, FromPcm16) {
+  std::vector<uint8_t> const in{0x00, 0x40, 0x00, 0x80, 0xFF, 0x7F, 0xFF, 0xFF};
+  std::vector<double> out (4U);
+  from_pcm<16> (span<uint8_t const>{in}, span<double>{out});
+  EXPECT_THAT (out, testing::ElementsAre (0.5, -1.0, 32767.0 / 32768.0,
+                                          -1.0 / 32768.0));
+}
+
+template <unsigned Bits>
+void check_pcm_round_trip () {
+  // Enough samples to use the vector code and its scalar tail.
+  auto const in = samples ();
+  std::vector<uint8_t> bytes (in.size () * (Bits / 8U));
+  to_pcm<Bits> (span<double const>{in}, span<uint8_t>{bytes});
+  std::vector<double> out (in.size ());
+  from_pcm<Bits> (span<uint8_t const>{bytes}, span<double>{out});
+  for (auto k = size_t{0}; k < in.size (); ++k) {
+    auto const scale = static_cast<double> (uint32_t{1} << (Bits - 1U));
+    EXPECT_EQ (out[k],
+               static_cast<double> (reference<Bits> (in[k], 1.0)) / scale)
+        << "sample " << k;
+  }
+}
+TEST (Convert, FromPcm16RoundTrip) {
+  check_pcm_round_trip<16> ();
+}
+TEST (Convert, FromPcm24RoundTrip) {
+  check_pcm_round_trip<24> ();
+}
+TEST (Convert, FromPcm32RoundTrip) {
+  check_pcm_round_trip<32> ();
+}
+
+TEST (Convert, FromPcmToAmplitude) {
+  // 16-bit values are exact in amplitude. The gain is applied before the
+  // result is clamped.
+  std::vector<uint8_t> const in{0x00, 0x40, 0x00, 0x80, 0x01, 0x00};
+  std::vector<amplitude> out (3U);
+  from_pcm<16> (span<uint8_t const>{in}, span<amplitude>{out});
+  EXPECT_EQ (out[0], amplitude::fromfp (0.5));
+  EXPECT_EQ (out[1], amplitude::fromfp (-1.0));
+  EXPECT_EQ (out[2].get (), 1 << (amplitude::fractional_bits - 15U));
+  from_pcm<16> (span<uint8_t const>{in}, span<amplitude>{out}, 4.0);
+  EXPECT_EQ (out[0], amplitude::fromfp (1.0));
+  EXPECT_EQ (out[1], amplitude::fromfp (-1.0));
+}
+
+TEST (Convert, FromFloat32) {
+  auto const in = samples ();
+  std::vector<uint8_t> bytes (in.size () * 4U);
+  to_float32 (span<double const>{in}, span<uint8_t>{bytes});
+  std::vector<float> out (in.size ());
+  from_float32 (span<uint8_t const>{bytes}, span<float>{out}, 2.0);
+  for (auto k = size_t{0}; k < in.size (); ++k) {
+    EXPECT_EQ (out[k], static_cast<float> (in[k]) * 2.0F) << "sample " << k;
+  }
+  std::vector<amplitude> a (in.size ());
+  from_float32 (span<uint8_t const>{bytes}, span<amplitude>{a});
+  for (auto k = size_t{0}; k < in.size (); ++k) {
+    EXPECT_NEAR (a[k].as_double (),
+                 std::clamp (static_cast<double> (static_cast<float> (in[k])),
+                             -1.0, 1.0),
+                 1.0 / (1U << amplitude::fractional_bits))
+        << "sample " << k;
+  }
+}
@@ -0,0 +1,72 @@
+#include <gmock/gmock.h>
+
+#include <utility>
+#include <vector>
+
+#include "synth/engine.hpp"
+
+using namespace synth;
+
+namespace {
+
+/// Plays the same notes on \p e and on a voice_assigner for the rate
+/// SampleRate and checks that their outputs are identical.
+template <unsigned SampleRate>
+void check_matches_voice_assigner (engine<nco_traits>& e) {
+  ASSERT_EQ (e.sample_rate (), SampleRate);
+  voice_assigner<SampleRate, nco_traits> voices;
+  e.set_envelope (envelope_phase::attack, 0.01);
+  voices.set_envelope (envelope_phase::attack, 0.01);
+  e.set_envelope (envelope_phase::release, 0.02);
+  voices.set_envelope (envelope_phase::release, 0.02);
+  e.note_on (60U);
+  voices.note_on (60U);
+  e.note_on (67U);
+  voices.note_on (67U);
+
+  std::vector<double> expected (SampleRate / 10U);
+  std::vector<double> actual (expected.size ());
+  voices.render (span<double>{expected});
+  e.render (span<double>{actual});
+  EXPECT_EQ (actual, expected);
+
+  e.note_off (60U);
+  voices.note_off (60U);
+  voices.render (span<double>{expected});
+  e.render (span<double>{actual});
+  EXPECT_EQ (actual, expected);
+  EXPECT_EQ (e.active_voices (), voices.active_voices ());
+}
+
+template <size_t... Index>
+void check_all_rates (std::index_sequence<Index...>) {
+  (
+      [] {
+        constexpr auto rate = engine_sample_rates[Index];
+        auto const e = make_engine<nco_traits> (rate);
+        ASSERT_NE (e, nullptr) << "rate " << rate;
+        check_matches_voice_assigner<rate> (*e);
+      }(),
+      ...);
+}
+
+}  // end anonymous namespace
+
+TEST (Engine, UnsupportedRate) {
+  EXPECT_EQ (make_engine<nco_traits> (0U), nullptr);
+  EXPECT_EQ (make_engine<nco_traits> (22050U), nullptr);
+}
+
+TEST (Engine, MatchesVoiceAssigner) {
+  check_all_rates (
+      std::make_index_sequence<engine_sample_rates.size ()>{});
+}
+
+TEST (Engine, Polyphony) {
+  auto const e = make_engine<nco_traits, 2> (48000U);
+  ASSERT_NE (e, nullptr);
+  e->note_on (60U);
+  e->note_on (62U);
+  e->note_on (64U);
+  EXPECT_EQ (e->active_voices ().to_ulong (), 0b11U);
+}
@@ -0,0 +1,100 @@
+#include <gmock/gmock.h>
+
+#include <array>
+#include <vector>
+
+#include "synth/envelope.hpp"
+
+using namespace synth;
+
+namespace {
+
+constexpr auto sample_rate = 1000U;
+using envelope_type = envelope<sample_rate>;
+using phase = envelope_type::phase;
+
+}  // end anonymous namespace
+
+TEST (Envelope, IdleIsSilent) {
+  envelope_type env;
+  EXPECT_FALSE (env.active ());
+  std::array<amplitude, 4> buffer;
+  buffer.fill (amplitude::fromfp (0.5));
+  env.render (buffer);
+  EXPECT_THAT (buffer, testing::Each (amplitude::fromint (0U)));
+}
+
+TEST (Envelope, InstantAttackThenSustain) {
+  envelope_type env;
+  env.set (phase::sustain, 0.5);
+  env.note_on ();
+  EXPECT_TRUE (env.active ());
+  // With zero attack and decay times, the envelope goes straight to the
+  // sustain level.
+  EXPECT_EQ (env.tick (amplitude::fromfp (0.5)), amplitude::fromfp (0.25));
+  EXPECT_EQ (env.tick (amplitude::fromfp (-1.0)), amplitude::fromfp (-0.5));
+}
+
+TEST (Envelope, AttackRamp) {
+  envelope_type env;
+  // An attack time of 4ms at 1kHz takes 4 samples to reach full amplitude.
+  env.set (phase::attack, 0.004);
+  env.note_on ();
+  std::array<amplitude, 6> buffer;
+  buffer.fill (amplitude::fromint (1U));
+  env.render (buffer);
+  EXPECT_THAT (buffer, testing::ElementsAre (
+                           amplitude::fromfp (0.25), amplitude::fromfp (0.5),
+                           amplitude::fromfp (0.75), amplitude::fromint (1U),
+                           amplitude::fromint (1U), amplitude::fromint (1U)));
+}
+
+TEST (Envelope, RenderMatchesTick) {
+  auto const make = [] {
+    envelope_type env;
+    env.set (phase::attack, 0.01);
+    env.set (phase::decay, 0.02);
+    env.set (phase::sustain, 0.6);
+    env.set (phase::release, 0.015);
+    env.note_on ();
+    return env;
+  };
+  envelope_type e1 = make ();
+  envelope_type e2 = make ();
+
+  std::vector<amplitude> in (100, amplitude::fromfp (0.75));
+  std::vector<amplitude> expected;
+  std::transform (std::begin (in), std::end (in), std::back_inserter (expected),
+                  [&e1] (amplitude const a) { return e1.tick (a); });
+  e1.note_off ();
+  std::transform (std::begin (in), std::end (in), std::back_inserter (expected),
+                  [&e1] (amplitude const a) { return e1.tick (a); });
+
+  // Render the same input in two buffers whose boundaries do not coincide
+  // with the phase changes.
+  std::vector<amplitude> actual = in;
+  e2.render (actual);
+  e2.note_off ();
+  actual.insert (std::end (actual), std::begin (in), std::end (in));
+  e2.render (span<amplitude>{actual.data () + in.size (), in.size ()});
+  EXPECT_EQ (actual, expected);
+  EXPECT_FALSE (e2.active ());
+}
+
+TEST (Envelope, ReleaseStopsAtSilence) {
+  envelope_type env;
+  // A release rate which leaves the level slightly above zero (but below
+  // envelope::silence) after two samples.
+  constexpr auto residue = envelope_type::silence / 2.0;
+  env.set (phase::release, 2.0 / (sample_rate * (1.0 - residue)));
+  env.note_on ();
+  env.tick (amplitude::fromint (1U));
+  env.note_off ();
+  std::array<amplitude, 3> buffer;
+  buffer.fill (amplitude::fromint (1U));
+  env.render (span<amplitude>{buffer.data (), 2U});
+  EXPECT_GT (buffer[0], amplitude::fromint (0U));
+  EXPECT_FALSE (env.active ());
+  env.render (span<amplitude>{buffer.data () + 2U, 1U});
+  EXPECT_EQ (buffer[2], amplitude::fromint (0U));
+}
@@ -0,0 +1,66 @@
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "synth/event.hpp"
+
+using namespace synth;
+
+namespace {
+
+constexpr auto sample_rate = 48000U;
+using voices_type = voice_assigner<sample_rate, nco_traits>;
+using event_type = event<sample_rate, nco_traits>;
+
+}  // end anonymous namespace
+
+// Events within a block take effect at exactly the same samples as they would
+// if the block were rendered piece by piece.
+TEST (Event, SampleAccurate) {
+  std::vector<event_type> const events{
+      event_type::make_note_on (60U, 100U),
+      event_type::make_note_on (64U, 100U),
+      event_type::make_note_off (60U, 250U),
+  };
+  voices_type voices;
+  std::vector<double> actual (300U);
+  render (voices, span<event_type const>{events}, span<double>{actual});
+
+  voices_type ref;
+  std::vector<double> expected (300U);
+  ref.render (span<double>{expected.data (), 100U});
+  ref.note_on (60U);
+  ref.note_on (64U);
+  ref.render (span<double>{expected.data () + 100U, 150U});
+  ref.note_off (60U);
+  ref.render (span<double>{expected.data () + 250U, 50U});
+
+  EXPECT_EQ (actual, expected);
+  // Nothing sounds before the first note-on.
+  EXPECT_TRUE (std::all_of (actual.begin (), actual.begin () + 100,
+                            [] (double const v) { return v == 0.0; }));
+  EXPECT_NE (actual[101], 0.0);
+}
+
+TEST (Event, NoEvents) {
+  voices_type voices;
+  voices.note_on (60U);
+  voices_type ref = voices;
+  std::vector<amplitude> actual (200U);
+  render (voices, span<event_type const>{}, span<amplitude>{actual});
+  std::vector<amplitude> expected (200U);
+  ref.render (span<amplitude>{expected});
+  EXPECT_EQ (actual, expected);
+}
+
+// An event at or beyond the end of the block is applied after its last sample.
+TEST (Event, OffsetPastEnd) {
+  std::vector<event_type> const events{event_type::make_note_on (60U, 1000U)};
+  voices_type voices;
+  std::vector<double> out (64U);
+  render (voices, span<event_type const>{events}, span<double>{out});
+  EXPECT_TRUE (std::all_of (out.begin (), out.end (),
+                            [] (double const v) { return v == 0.0; }));
+  EXPECT_EQ (voices.active_voices ().to_ulong (), 1U);
+}
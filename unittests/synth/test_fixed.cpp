@@ -1,7 +1,12 @@
 #include "synth/fixed.hpp"
 
+#include <gmock/gmock.h>
+
+#include <array>
 #include <limits>
 
+#include "synth/fixed_batch.hpp"
+
 static_assert (synth::mask<0>::value == 0);
 static_assert (synth::mask<1>::value == 0b1);
 static_assert (synth::mask<2>::value == 0b11);
@@ -18,3 +23,88 @@ static_assert (synth::mask<32>::value == 0xffffffff);
 static_assert (synth::mask<33>::value == 0x1ffffffff);
 static_assert (synth::mask<63>::value == 0x7fffffffffffffff);
 static_assert (synth::mask<64>::value == std::numeric_limits<uint64_t>::max());
+
+using namespace synth;
+
+namespace {
+
+using q = fixed<24, 1>;  // The amplitude type: a signed Q1.22 value.
+using uq = ufixed<8, 4>;
+
+}  // end anonymous namespace
+
+// The arithmetic layer is constexpr so many of the checks can be done at
+// compile time.
+static_assert (q::max ().get () == 0x7FFFFF);
+static_assert (q::min ().get () == -0x800000);
+static_assert (-q::fromint (1U) < q::fromint (0U));
+static_assert (q::fromfp (0.5) - q::fromfp (0.75) == q::fromfp (-0.25));
+static_assert (add_sat (q::max (), q::fromint (1U)) == q::max ());
+static_assert (sub_sat (q::min (), q::fromint (1U)) == q::min ());
+static_assert (add_wrap (q::max (), q::frombits (1U)) == q::min ());
+static_assert (sub_wrap (q::min (), q::frombits (1U)) == q::max ());
+static_assert (uq::max ().get () == 0xFF);
+static_assert (add_wrap (uq::frombits (0xF0), uq::frombits (0x20)) ==
+               uq::frombits (0x10));
+static_assert (sub_wrap (uq::frombits (0x10), uq::frombits (0x20)) ==
+               uq::frombits (0xF0));
+static_assert (add_sat (uq::frombits (0xF0), uq::frombits (0x20)) ==
+               uq::max ());
+static_assert (sub_sat (uq::frombits (0x10), uq::frombits (0x20)) ==
+               uq::min ());
+
+TEST (Fixed, MulRound) {
+  EXPECT_EQ (mul_round<q> (q::fromfp (0.5), q::fromfp (0.5)),
+             q::fromfp (0.25));
+  EXPECT_EQ (mul_round<q> (q::fromfp (-0.5), q::fromfp (0.5)),
+             q::fromfp (-0.25));
+  EXPECT_EQ (mul_round<q> (q::fromfp (-1.0), q::fromfp (-1.0)),
+             q::fromint (1U));
+  // 1.5 * 1.5 = 2.25 which is not representable so saturates.
+  EXPECT_EQ (mul_round<q> (q::fromfp (1.5), q::fromfp (1.5)), q::max ());
+  // The smallest positive value squared rounds to 0. 3/2 LSB rounds to 2.
+  EXPECT_EQ (mul_round<q> (q::frombits (1U), q::frombits (1U)), q::fromint (0U));
+  EXPECT_EQ (mul_round<q> (q::frombits (3U), q::fromfp (0.5)), q::frombits (2U));
+  // A signed value multiplied by an unsigned one.
+  EXPECT_EQ (mul_round<q> (q::fromfp (-0.5), ufixed<32, 2>::fromfp (0.25)),
+             q::fromfp (-0.125));
+  EXPECT_EQ (mul_round<uq> (uq::fromfp (1.5), uq::fromfp (2.5)),
+             uq::fromfp (3.75));
+  EXPECT_EQ (mul_round<uq> (uq::fromfp (8.0), uq::fromfp (4.0)), uq::max ());
+}
+
+TEST (Fixed, FullPrecisionMultiply) {
+  auto const p = q::fromfp (-0.75) * q::fromfp (0.5);
+  static_assert (std::is_same_v<decltype (p), fixed<48, 3> const>);
+  EXPECT_EQ (p.as_double (), -0.375);
+}
+
+TEST (Fixed, BatchAddSat) {
+  std::array<q, 3> const a{{q::fromfp (0.5), q::max (), q::min ()}};
+  std::array<q, 3> const b{{q::fromfp (0.25), q::fromint (1U), -q::fromint (1U)}};
+  std::array<q, 3> out;
+  add_sat (a, b, span<q>{out});
+  EXPECT_THAT (out, testing::ElementsAre (q::fromfp (0.75), q::max (), q::min ()));
+  sub_sat (a, b, span<q>{out});
+  EXPECT_THAT (out, testing::ElementsAre (q::fromfp (0.25), q::max () - q::fromint (1U),
+                                          q::min () + q::fromint (1U)));
+}
+
+TEST (Fixed, BatchWrap) {
+  std::array<uq, 2> const a{{uq::frombits (0xF0), uq::frombits (0x01)}};
+  std::array<uq, 2> const b{{uq::frombits (0x20), uq::frombits (0x02)}};
+  std::array<uq, 2> out;
+  add_wrap (a, b, span<uq>{out});
+  EXPECT_THAT (out, testing::ElementsAre (uq::frombits (0x10), uq::frombits (0x03)));
+  sub_wrap (a, b, span<uq>{out});
+  EXPECT_THAT (out, testing::ElementsAre (uq::frombits (0xD0), uq::frombits (0xFF)));
+}
+
+TEST (Fixed, BatchMulRound) {
+  std::array<q, 2> const a{{q::fromfp (0.5), q::fromfp (-1.0)}};
+  std::array<q, 2> out;
+  mul_round (span<q const>{a}, q::fromfp (0.5), span<q>{out});
+  EXPECT_THAT (out, testing::ElementsAre (q::fromfp (0.25), q::fromfp (-0.5)));
+  mul_round (span<q const>{a}, span<q const>{a}, span<q>{out});
+  EXPECT_THAT (out, testing::ElementsAre (q::fromfp (0.25), q::fromint (1U)));
+}
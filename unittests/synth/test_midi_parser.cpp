@@ -0,0 +1,219 @@
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "synth/midi_parser.hpp"
+
+using namespace synth;
+
+namespace synth {
+
+std::ostream& operator<< (std::ostream& os, midi_message const& m) {
+  return os << "{kind=" << static_cast<unsigned> (m.kind)
+            << ",channel=" << unsigned{m.channel}
+            << ",data1=" << unsigned{m.data1} << ",data2=" << unsigned{m.data2}
+            << '}';
+}
+
+}  // end namespace synth
+
+namespace {
+
+midi_message message (midi_kind const kind, unsigned const channel = 0U,
+                      unsigned const data1 = 0U, unsigned const data2 = 0U) {
+  midi_message m;
+  m.kind = kind;
+  m.channel = static_cast<uint8_t> (channel);
+  m.data1 = static_cast<uint8_t> (data1);
+  m.data2 = static_cast<uint8_t> (data2);
+  return m;
+}
+
+/// Parses \p bytes in a single chunk and returns the messages produced.
+std::vector<midi_message> parse (std::vector<uint8_t> const& bytes) {
+  std::vector<midi_message> result;
+  midi_parser p;
+  p.parse (span<uint8_t const>{bytes},
+           [&result] (midi_message const& m) { result.push_back (m); });
+  return result;
+}
+
+}  // end anonymous namespace
+
+TEST (MidiParser, NoteOnOff) {
+  EXPECT_THAT (parse ({0x91, 60, 100, 0x81, 60, 64}),
+               testing::ElementsAre (message (midi_kind::note_on, 1U, 60U, 100U),
+                                     message (midi_kind::note_off, 1U, 60U, 64U)));
+}
+
+TEST (MidiParser, RunningStatus) {
+  // Note-on with zero velocity is reported as note-off.
+  EXPECT_THAT (parse ({0x90, 60, 100, 62, 90, 60, 0}),
+               testing::ElementsAre (message (midi_kind::note_on, 0U, 60U, 100U),
+                                     message (midi_kind::note_on, 0U, 62U, 90U),
+                                     message (midi_kind::note_off, 0U, 60U, 0U)));
+}
+
+TEST (MidiParser, OneDataByte) {
+  EXPECT_THAT (parse ({0xC3, 5, 6, 0xD2, 40}),
+               testing::ElementsAre (
+                   message (midi_kind::program_change, 3U, 5U),
+                   message (midi_kind::program_change, 3U, 6U),
+                   message (midi_kind::channel_pressure, 2U, 40U)));
+}
+
+TEST (MidiParser, PitchBend) {
+  auto const m = parse ({0xE0, 0x7F, 0x7F});
+  ASSERT_EQ (m.size (), 1U);
+  EXPECT_EQ (m[0].kind, midi_kind::pitch_bend);
+  EXPECT_EQ (m[0].value14 (), 0x3FFFU);
+}
+
+TEST (MidiParser, RealTimeInsideMessage) {
+  EXPECT_THAT (parse ({0x90, 0xF8, 60, 0xFE, 100, 0xF9, 62, 0xFA, 70}),
+               testing::ElementsAre (message (midi_kind::timing_clock),
+                                     message (midi_kind::active_sensing),
+                                     message (midi_kind::note_on, 0U, 60U, 100U),
+                                     message (midi_kind::start),
+                                     message (midi_kind::note_on, 0U, 62U, 70U)));
+}
+
+TEST (MidiParser, SysExSkipped) {
+  // A system exclusive message cancels running status. Real-time messages
+  // inside it are still reported.
+  EXPECT_THAT (
+      parse ({0x90, 60, 100, 0xF0, 1, 2, 0xF8, 3, 0xF7, 61, 100, 0x90, 62, 1}),
+      testing::ElementsAre (message (midi_kind::note_on, 0U, 60U, 100U),
+                            message (midi_kind::timing_clock),
+                            message (midi_kind::note_on, 0U, 62U, 1U)));
+}
+
+TEST (MidiParser, SysExEndedByStatus) {
+  EXPECT_THAT (parse ({0xF0, 1, 2, 0x80, 60, 0}),
+               testing::ElementsAre (message (midi_kind::note_off, 0U, 60U, 0U)));
+}
+
+TEST (MidiParser, SystemCommon) {
+  EXPECT_THAT (parse ({0xF2, 0x01, 0x02, 0x03, 0xF6, 0xF3, 7, 0xF1, 0x21}),
+               testing::ElementsAre (
+                   message (midi_kind::song_position, 0U, 1U, 2U),
+                   message (midi_kind::tune_request),
+                   message (midi_kind::song_select, 0U, 7U),
+                   message (midi_kind::mtc_quarter_frame, 0U, 0x21U)));
+}
+
+TEST (MidiParser, Status) {
+  midi_parser p;
+  auto const ignore = [] (midi_message const&) {};
+  EXPECT_EQ (p.status (), 0U);
+  p.parse (span<uint8_t const>{std::vector<uint8_t>{0x93, 60, 100}}, ignore);
+  EXPECT_EQ (p.status (), 0x93U);  // Running status.
+  p.parse (span<uint8_t const>{std::vector<uint8_t>{0xF3, 7}}, ignore);
+  EXPECT_EQ (p.status (), 0U);  // System common messages cancel it.
+  p.parse (0xC1, ignore);
+  p.reset ();
+  EXPECT_EQ (p.status (), 0U);
+}
+
+TEST (MidiParser, Malformed) {
+  // Data without status; a message interrupted by another status byte; an
+  // undefined status byte.
+  EXPECT_THAT (parse ({60, 100, 0x90, 60, 0xB0, 7, 0xF4, 1, 2, 0xB1, 7, 127}),
+               testing::ElementsAre (
+                   message (midi_kind::control_change, 1U, 7U, 127U)));
+}
+
+TEST (MidiParser, Chunked) {
+  std::vector<uint8_t> const bytes{0x90, 60, 100, 62, 0xF8, 90, 0xE5, 1, 2};
+  auto const expected = parse (bytes);
+  // Splitting the stream at any point produces the same messages.
+  for (auto split = size_t{0}; split <= bytes.size (); ++split) {
+    std::vector<midi_message> actual;
+    auto const h = [&actual] (midi_message const& m) { actual.push_back (m); };
+    midi_parser p;
+    p.parse (span<uint8_t const>{bytes.data (), split}, h);
+    p.parse (span<uint8_t const>{bytes.data () + split, bytes.size () - split},
+             h);
+    EXPECT_EQ (actual, expected) << "split at " << split;
+  }
+}
+
+// Fuzz: random bytes, split into random chunks. The parser must never report
+// a data value with bit 7 set or a bad channel, and the result must not depend
+// on the chunking.
+TEST (MidiParser, FuzzRandomBytes) {
+  std::mt19937 gen{1234};
+  std::uniform_int_distribution<unsigned> byte{0U, 255U};
+  std::uniform_int_distribution<size_t> chunk{0U, 17U};
+  for (auto trial = 0U; trial < 200U; ++trial) {
+    std::vector<uint8_t> bytes (1000U);
+    for (auto& b : bytes) {
+      b = static_cast<uint8_t> (byte (gen));
+    }
+    auto const expected = parse (bytes);
+    std::vector<midi_message> actual;
+    midi_parser p;
+    for (auto pos = size_t{0}; pos < bytes.size ();) {
+      auto const n = std::min (chunk (gen), bytes.size () - pos);
+      p.parse (span<uint8_t const>{bytes.data () + pos, n},
+               [&actual] (midi_message const& m) { actual.push_back (m); });
+      pos += n;
+    }
+    ASSERT_EQ (actual, expected);
+    for (auto const& m : actual) {
+      EXPECT_LT (m.data1, 0x80U);
+      EXPECT_LT (m.data2, 0x80U);
+      EXPECT_LT (m.channel, 16U);
+    }
+  }
+}
+
+// Fuzz: random valid messages encoded with running status where possible and
+// with real-time messages inserted at random positions must be decoded
+// exactly.
+TEST (MidiParser, FuzzRoundTrip) {
+  std::mt19937 gen{5678};
+  std::uniform_int_distribution<unsigned> status{0x8U, 0xEU};
+  std::uniform_int_distribution<unsigned> channel{0U, 15U};
+  std::uniform_int_distribution<unsigned> data{0U, 127U};
+  std::bernoulli_distribution realtime{0.1};
+  for (auto trial = 0U; trial < 100U; ++trial) {
+    std::vector<midi_message> expected;
+    std::vector<uint8_t> bytes;
+    auto const append = [&] (uint8_t const b) {
+      if (realtime (gen)) {
+        bytes.push_back (0xF8);
+        expected.push_back (message (midi_kind::timing_clock));
+      }
+      bytes.push_back (b);
+    };
+    auto running = 0U;
+    for (auto ctr = 0U; ctr < 200U; ++ctr) {
+      auto const s = (status (gen) << 4U) | channel (gen);
+      auto const d1 = data (gen);
+      auto const d2 = data (gen);
+      if (s != running) {
+        append (static_cast<uint8_t> (s));
+        running = s;
+      }
+      append (static_cast<uint8_t> (d1));
+      auto kind = static_cast<midi_kind> (s & 0xF0U);
+      auto const two = kind != midi_kind::program_change &&
+                       kind != midi_kind::channel_pressure;
+      if (two) {
+        if (realtime (gen)) {
+          bytes.push_back (0xFE);  // Between the two data bytes.
+          expected.push_back (message (midi_kind::active_sensing));
+        }
+        bytes.push_back (static_cast<uint8_t> (d2));
+        if (kind == midi_kind::note_on && d2 == 0U) {
+          kind = midi_kind::note_off;
+        }
+      }
+      expected.push_back (message (kind, s & 0x0FU, d1, two ? d2 : 0U));
+    }
+    ASSERT_EQ (parse (bytes), expected);
+  }
+}
@@ -0,0 +1,97 @@
+#include <gmock/gmock.h>
+
+#include <cmath>
+#include <vector>
+
+#include "synth/mipmap_wavetable.hpp"
+#include "synth/nco.hpp"
+
+using namespace synth;
+
+namespace {
+
+using traits = nco_traits;
+using mipmap = mipmap_wavetable<traits>;
+using phase_index_type = mipmap::phase_index_type;
+constexpr auto table_size = size_t{1} << traits::wavetable_N;
+
+}  // end anonymous namespace
+
+TEST (MipmapWavetable, Harmonics) {
+  EXPECT_EQ (mipmap::levels, size_t{traits::wavetable_N});
+  EXPECT_EQ (mipmap::harmonics (0), table_size / 2U);
+  EXPECT_EQ (mipmap::harmonics (1), table_size / 4U);
+  EXPECT_EQ (mipmap::harmonics (mipmap::levels - 1U), 1U);
+}
+
+TEST (MipmapWavetable, Level) {
+  constexpr auto octave =
+      phase_index_type::value_type{1} << (traits::M - traits::wavetable_N);
+  auto const level = [] (phase_index_type::value_type const increment) {
+    return mipmap::level (phase_index_type::frombits (increment));
+  };
+  EXPECT_EQ (level (0U), 0U);
+  EXPECT_EQ (level (octave), 0U);
+  EXPECT_EQ (level (octave + 1U), 1U);
+  EXPECT_EQ (level (octave * 2U), 1U);
+  EXPECT_EQ (level (octave * 2U + 1U), 2U);
+  EXPECT_EQ (level (octave * 4U), 2U);
+  EXPECT_EQ (level (std::numeric_limits<phase_index_type::value_type>::max ()),
+             mipmap::levels - 1U);
+}
+
+TEST (MipmapWavetable, NoAliasing) {
+  // For every level, the highest harmonic stays below the Nyquist frequency
+  // at the largest increment that selects it.
+  constexpr auto octave =
+      phase_index_type::value_type{1} << (traits::M - traits::wavetable_N);
+  for (auto l = size_t{0}; l + 1U < mipmap::levels; ++l) {
+    auto const increment = octave << l;
+    ASSERT_EQ (mipmap::level (phase_index_type::frombits (increment)), l);
+    auto const cycles_per_sample =
+        static_cast<double> (increment) / std::pow (2.0, traits::M);
+    EXPECT_LE (static_cast<double> (mipmap::harmonics (l)) * cycles_per_sample,
+               0.5)
+        << "level " << l;
+  }
+}
+
+TEST (MipmapWavetable, FinalLevelIsSine) {
+  auto const& w = bandlimited_sawtooth<traits>[mipmap::levels - 1U];
+  auto const peak = w.data ()[table_size * 3U / 4U].as_double ();
+  EXPECT_GT (peak, 0.5);
+  for (auto k = size_t{0}; k < table_size; ++k) {
+    EXPECT_NEAR (w.data ()[k].as_double (),
+                 -peak * std::sin (two_pi * static_cast<double> (k) /
+                                   static_cast<double> (table_size)),
+                 1e-6)
+        << "index " << k;
+  }
+}
+
+TEST (MipmapWavetable, TriangleApproximatesNaive) {
+  // The triangle wave's harmonics fall away quickly and it has no Gibbs
+  // overshoot, so the first level should be very close to the naive table.
+  auto const& w = bandlimited_triangle<traits>[0];
+  auto it = std::begin (triangle<traits>);
+  for (auto k = size_t{0}; k < table_size; ++k, ++it) {
+    EXPECT_NEAR (w.data ()[k].as_double (), it->as_double (), 1e-3)
+        << "index " << k;
+  }
+}
+
+TEST (MipmapWavetable, OscillatorSelectsLevel) {
+  constexpr auto sample_rate = 48000U;
+  auto const f = frequency::fromfp (4000.0);
+  oscillator<sample_rate, traits, mipmap> osc{&bandlimited_square<traits>};
+  osc.set_frequency (f);
+
+  auto const level = mipmap::level (
+      oscillator<sample_rate, traits, mipmap>::phase_increment (f));
+  EXPECT_GT (level, 0U);
+  oscillator<sample_rate, traits> expected{&bandlimited_square<traits>[level]};
+  expected.set_frequency (f);
+  for (auto ctr = 0U; ctr < 256U; ++ctr) {
+    EXPECT_EQ (osc.tick (), expected.tick ()) << "sample " << ctr;
+  }
+}
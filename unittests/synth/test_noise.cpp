@@ -0,0 +1,151 @@
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include "synth/nco.hpp"
+#include "synth/noise.hpp"
+
+using namespace synth;
+
+namespace {
+
+std::vector<amplitude> render (noise_generator& g, size_t const samples) {
+  std::vector<amplitude> out (samples);
+  g.render (span<amplitude>{out});
+  return out;
+}
+
+std::vector<double> to_double (std::vector<amplitude> const& v) {
+  std::vector<double> result (v.size ());
+  std::transform (std::begin (v), std::end (v), std::begin (result),
+                  [] (amplitude const a) { return a.as_double (); });
+  return result;
+}
+
+double mean (std::vector<double> const& v) {
+  return std::accumulate (std::begin (v), std::end (v), 0.0) /
+         static_cast<double> (v.size ());
+}
+
+double variance (std::vector<double> const& v) {
+  auto const m = mean (v);
+  auto sum = 0.0;
+  for (auto const x : v) {
+    sum += (x - m) * (x - m);
+  }
+  return sum / static_cast<double> (v.size ());
+}
+
+/// The correlation of consecutive samples of \p v.
+double lag1_correlation (std::vector<double> const& v) {
+  auto const m = mean (v);
+  auto sum = 0.0;
+  for (auto k = size_t{1}; k < v.size (); ++k) {
+    sum += (v[k] - m) * (v[k - 1U] - m);
+  }
+  return sum / static_cast<double> (v.size () - 1U) / variance (v);
+}
+
+}  // end anonymous namespace
+
+TEST (Noise, SameSeedSameOutput) {
+  noise_generator a{42U, 3U};
+  noise_generator b{42U, 3U};
+  EXPECT_EQ (render (a, 1000U), render (b, 1000U));
+  // seed() restarts the sequence.
+  a.seed (42U, 3U);
+  b.seed (42U, 3U);
+  EXPECT_EQ (render (a, 100U), render (b, 100U));
+}
+
+TEST (Noise, StreamsDiffer) {
+  noise_generator a{42U, 0U};
+  noise_generator b{42U, 1U};
+  noise_generator c{43U, 0U};
+  auto const x = render (a, 1000U);
+  EXPECT_NE (x, render (b, 1000U));
+  EXPECT_NE (x, render (c, 1000U));
+}
+
+TEST (Noise, BlocksMatchWhole) {
+  for (auto const color :
+       {noise_color::white, noise_color::pink, noise_color::filtered}) {
+    noise_generator whole{7U};
+    noise_generator blocks{7U};
+    whole.set_color (color);
+    blocks.set_color (color);
+    auto const expected = render (whole, 1000U);
+    std::vector<amplitude> actual;
+    for (auto const n : {1U, 3U, 16U, 17U, 100U, 500U, 1U, 362U}) {
+      auto const b = render (blocks, n);
+      actual.insert (std::end (actual), std::begin (b), std::end (b));
+    }
+    EXPECT_EQ (actual, expected);
+  }
+}
+
+TEST (Noise, WavetablePerVoice) {
+  // Each voice has its own noise wavetable seeded with its index. Its output
+  // is that of a generator with the same seed and stream, however the voices'
+  // rendering is interleaved.
+  using oscillator_type =
+      oscillator<48000U, nco_traits, noise_wavetable<nco_traits>>;
+  constexpr auto voices = size_t{3};
+  constexpr auto samples = size_t{100};
+  std::vector<noise_wavetable<nco_traits>> tables;
+  std::vector<oscillator_type> oscillators;
+  std::vector<std::vector<amplitude>> expected;
+  tables.reserve (voices);
+  for (auto v = size_t{0}; v < voices; ++v) {
+    tables.emplace_back (42U, v);
+    oscillators.emplace_back (&tables.back ());
+    noise_generator g{42U, v};
+    expected.push_back (render (g, samples));
+  }
+  std::vector<std::vector<amplitude>> actual (voices);
+  for (auto k = size_t{0}; k < samples; ++k) {
+    // Visit the voices in a different order for each sample.
+    for (auto n = size_t{0}; n < voices; ++n) {
+      auto const v = (k + n) % voices;
+      actual[v].push_back (oscillators[v].tick ());
+    }
+  }
+  EXPECT_EQ (actual, expected);
+  EXPECT_NE (actual[0], actual[1]);
+}
+
+TEST (Noise, White) {
+  noise_generator g;
+  auto const v = to_double (render (g, 100000U));
+  EXPECT_GE (*std::min_element (std::begin (v), std::end (v)), -1.0);
+  EXPECT_LT (*std::max_element (std::begin (v), std::end (v)), 1.0);
+  EXPECT_NEAR (mean (v), 0.0, 0.01);
+  // The variance of a uniform distribution on [-1, 1).
+  EXPECT_NEAR (variance (v), 1.0 / 3.0, 0.01);
+  EXPECT_NEAR (lag1_correlation (v), 0.0, 0.01);
+}
+
+TEST (Noise, Pink) {
+  noise_generator g;
+  g.set_color (noise_color::pink);
+  auto const v = to_double (render (g, 100000U));
+  EXPECT_GE (*std::min_element (std::begin (v), std::end (v)), -1.0);
+  EXPECT_LT (*std::max_element (std::begin (v), std::end (v)), 1.0);
+  // The low frequencies dominate, so consecutive samples are similar.
+  EXPECT_GT (lag1_correlation (v), 0.5);
+}
+
+TEST (Noise, Filtered) {
+  noise_generator g;
+  g.set_color (noise_color::filtered);
+  g.set_cutoff (0.01);
+  auto const low = to_double (render (g, 100000U));
+  g.set_cutoff (0.25);
+  auto const high = to_double (render (g, 100000U));
+  EXPECT_GT (lag1_correlation (low), 0.9);
+  EXPECT_LT (lag1_correlation (high), lag1_correlation (low));
+  EXPECT_LT (variance (low), variance (high));
+}
@@ -215,6 +215,44 @@ TYPED_TEST (Oscillator, QuarterNyquist) {
   EXPECT_EQ (osc.tick (), results.at (0));
 }
 
+TYPED_TEST (Oscillator, RenderHalfNyquist) {
+  using testing::_;
+  using testing::ElementsAre;
+  using testing::Return;
+  using testing::Throw;
+
+  using traits = test_traits;
+  using phase_index_type = typename oscillator_info<traits>::phase_index_type;
+
+  constexpr unsigned sample_rate = TypeParam ();
+  constexpr auto divisor = 4U;
+  constexpr auto index = (1U << traits::wavetable_N) / divisor;
+
+  testing::NiceMock<mock_wavetable<traits>> wt;
+  ON_CALL (wt, phase_to_amplitude (_))
+      .WillByDefault (Throw (std::invalid_argument{"unknown index"}));
+  ON_CALL (wt, phase_to_amplitude (phase_index_type::fromint (0U * index)))
+      .WillByDefault (Return (results.at (0)));
+  ON_CALL (wt, phase_to_amplitude (phase_index_type::fromint (1U * index)))
+      .WillByDefault (Return (results.at (1)));
+  ON_CALL (wt, phase_to_amplitude (phase_index_type::fromint (2U * index)))
+      .WillByDefault (Return (results.at (2)));
+  ON_CALL (wt, phase_to_amplitude (phase_index_type::fromint (3U * index)))
+      .WillByDefault (Return (results.at (3)));
+
+  oscillator<sample_rate, traits, decltype (wt)> osc{&wt};
+  osc.set_frequency (frequency::fromint (sample_rate / divisor));
+
+  // Render a buffer of samples and check that the oscillator picks up where it
+  // left off in both a second call to render() and a subsequent tick().
+  std::array<amplitude, 3> out;
+  osc.render (out);
+  EXPECT_THAT (out, ElementsAre (results.at (0), results.at (1), results.at (2)));
+  osc.render (out);
+  EXPECT_THAT (out, ElementsAre (results.at (3), results.at (0), results.at (1)));
+  EXPECT_EQ (osc.tick (), results.at (2));
+}
+
 TEST (Oscillator, NyquistByThree) {
   using testing::_;
   using testing::Return;
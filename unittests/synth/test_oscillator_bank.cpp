@@ -0,0 +1,123 @@
+#include <gmock/gmock.h>
+
+#include <array>
+#include <bitset>
+#include <vector>
+
+#include "synth/oscillator_bank.hpp"
+
+using namespace synth;
+
+namespace {
+
+constexpr auto sample_rate = 48000U;
+
+/// Returns the samples of lane \p lane from the frame-major output of a bank
+/// with \p lanes lanes.
+std::vector<amplitude> column (std::vector<amplitude> const& out,
+                               size_t const lanes, size_t const lane) {
+  std::vector<amplitude> result;
+  for (auto k = lane; k < out.size (); k += lanes) {
+    result.push_back (out[k]);
+  }
+  return result;
+}
+
+struct cubic_traits {
+  static constexpr auto wavetable_N = 8U;
+  static constexpr auto M = 32U;
+  static constexpr auto interpolation = synth::interpolation::cubic;
+};
+
+template <size_t Lanes, typename Traits = nco_traits,
+          typename Wavetable = wavetable<Traits>>
+void check_bank_matches_oscillators (size_t const frames,
+                                     Wavetable const* const w = &sine<Traits>) {
+  using traits = Traits;
+  using oscillator_type = oscillator<sample_rate, traits, Wavetable>;
+  oscillator_bank<sample_rate, traits, Lanes> bank{w};
+  std::vector<oscillator_type> oscillators (Lanes, oscillator_type{w});
+  for (auto lane = size_t{0}; lane < Lanes; ++lane) {
+    auto const f = frequency::fromfp (55.0 * static_cast<double> (lane + 1U));
+    bank.set_frequency (lane, f);
+    oscillators[lane].set_frequency (f);
+  }
+
+  // Render two blocks to check that the bank's phases carry over correctly.
+  std::vector<amplitude> actual (Lanes * frames);
+  std::vector<amplitude> expected (frames);
+  for (auto block = 0U; block < 2U; ++block) {
+    bank.render (actual);
+    for (auto lane = size_t{0}; lane < Lanes; ++lane) {
+      oscillators[lane].render (expected);
+      EXPECT_EQ (column (actual, Lanes, lane), expected)
+          << "lane " << lane << " block " << block;
+    }
+  }
+}
+
+}  // end anonymous namespace
+
+TEST (OscillatorBank, OneLane) {
+  check_bank_matches_oscillators<1> (64);
+}
+TEST (OscillatorBank, VectorLanes) {
+  check_bank_matches_oscillators<32> (64);
+}
+TEST (OscillatorBank, OddLanes) {
+  // A lane count which is not a multiple of the vector width exercises both
+  // the vector and scalar paths.
+  check_bank_matches_oscillators<19> (7);
+}
+TEST (OscillatorBank, Interpolated) {
+  check_bank_matches_oscillators<19, cubic_traits> (7);
+}
+TEST (OscillatorBank, Mipmap) {
+  // Each lane has a different frequency and therefore reads from a different
+  // level of the mipmap.
+  check_bank_matches_oscillators<19> (7, &bandlimited_sawtooth<nco_traits>);
+}
+
+TEST (OscillatorBank, FrameMajor) {
+  // Sample f of lane k is at index f * lanes + k.
+  constexpr auto lanes = size_t{3};
+  constexpr auto frames = size_t{4};
+  oscillator_bank<sample_rate, nco_traits, lanes> bank{&sine<nco_traits>};
+  oscillator<sample_rate, nco_traits> osc{&sine<nco_traits>};
+  bank.set_frequency (1U, frequency::fromfp (1000.0));
+  osc.set_frequency (frequency::fromfp (1000.0));
+  std::vector<amplitude> out (lanes * frames);
+  bank.render (out);
+  for (auto frame = size_t{0}; frame < frames; ++frame) {
+    EXPECT_EQ (out[frame * lanes + 1U], osc.tick ()) << "frame " << frame;
+  }
+}
+
+TEST (OscillatorBank, ActiveLanes) {
+  // Rendering a subset of the lanes keeps the phases of the others advancing,
+  // so a lane which becomes active produces the same samples as if it had
+  // always been rendered.
+  constexpr auto lanes = size_t{19};
+  constexpr auto frames = size_t{7};
+  oscillator_bank<sample_rate, nco_traits, lanes> bank{&sine<nco_traits>};
+  oscillator_bank<sample_rate, nco_traits, lanes> reference{&sine<nco_traits>};
+  for (auto lane = size_t{0}; lane < lanes; ++lane) {
+    auto const f = frequency::fromfp (55.0 * static_cast<double> (lane + 1U));
+    bank.set_frequency (lane, f);
+    reference.set_frequency (lane, f);
+  }
+  std::bitset<lanes> active;
+  active[1] = true;
+  active[18] = true;
+  std::vector<amplitude> actual (lanes * frames);
+  std::vector<amplitude> expected (lanes * frames);
+  bank.render (actual, active);
+  reference.render (expected);
+  for (auto const lane : {size_t{1}, size_t{18}}) {
+    EXPECT_EQ (column (actual, lanes, lane), column (expected, lanes, lane))
+        << "lane " << lane;
+  }
+  bank.render (actual);
+  reference.render (expected);
+  EXPECT_EQ (actual, expected);
+}
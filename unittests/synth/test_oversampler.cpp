@@ -0,0 +1,112 @@
+#include <gmock/gmock.h>
+
+#include <cmath>
+#include <vector>
+
+#include "synth/oversampler.hpp"
+
+using namespace synth;
+
+namespace {
+
+/// Returns \p n samples of a sine wave with the given frequency (as a fraction
+/// of the sample rate) and amplitude.
+std::vector<amplitude> sine_wave (size_t const n, double const f,
+                                  double const a) {
+  std::vector<amplitude> result (n);
+  for (auto k = size_t{0}; k < n; ++k) {
+    result[k] = amplitude::fromfp (
+        a * std::sin (two_pi * f * static_cast<double> (k)));
+  }
+  return result;
+}
+
+/// Returns the RMS value of \p x ignoring its first \p skip samples.
+double rms (std::vector<amplitude> const& x, size_t const skip) {
+  auto sum = 0.0;
+  for (auto k = skip; k < x.size (); ++k) {
+    sum += x[k].as_double () * x[k].as_double ();
+  }
+  return std::sqrt (sum / static_cast<double> (x.size () - skip));
+}
+
+template <size_t K>
+std::vector<amplitude> decimate (std::vector<amplitude> const& in) {
+  halfband_decimator<K> d;
+  std::vector<amplitude> out (in.size () / 2U);
+  d.process (in, out);
+  return out;
+}
+
+}  // end anonymous namespace
+
+TEST (HalfbandDecimator, UnityGainAtDC) {
+  std::vector<amplitude> const in (256U, amplitude::fromfp (0.5));
+  auto const out = decimate<12> (in);
+  // The filter's history starts as zero. Once it is full (after 4K-1 input
+  // samples), the output matches the input.
+  for (auto k = size_t{24}; k < out.size (); ++k) {
+    EXPECT_NEAR (out[k].as_double (), 0.5, 1e-6) << "sample " << k;
+  }
+}
+
+TEST (HalfbandDecimator, PassBand) {
+  // A tenth of the input rate is within the pass band.
+  auto const out = decimate<12> (sine_wave (4096U, 0.1, 0.5));
+  EXPECT_NEAR (rms (out, 64U), 0.5 / std::sqrt (2.0), 0.001);
+}
+
+TEST (HalfbandDecimator, StopBand) {
+  // Frequencies above a quarter of the input rate would alias. Those
+  // comfortably above it are removed.
+  for (auto const f : {0.35, 0.4, 0.45}) {
+    auto const out = decimate<12> (sine_wave (4096U, f, 0.9));
+    EXPECT_LT (20.0 * std::log10 (rms (out, 64U) / (0.9 / std::sqrt (2.0))),
+               -80.0)
+        << "frequency " << f;
+  }
+}
+
+TEST (HalfbandDecimator, BlocksMatchWhole) {
+  // Vector and scalar paths and the history carried between calls all produce
+  // the same result.
+  auto const in = sine_wave (1000U, 0.13, 0.7);
+  auto const expected = decimate<5> (in);
+  halfband_decimator<5> d;
+  std::vector<amplitude> actual;
+  for (auto first = size_t{0}, step = size_t{2}; first < in.size ();
+       first += step, step = (step * 3U) % 46U + 2U) {
+    auto const n = std::min (step, in.size () - first);
+    std::vector<amplitude> out (n / 2U);
+    d.process (span<amplitude const>{in.data () + first, n}, out);
+    actual.insert (std::end (actual), std::begin (out), std::end (out));
+  }
+  EXPECT_EQ (actual, expected);
+}
+
+TEST (HalfbandDecimator, InPlace) {
+  auto in = sine_wave (512U, 0.05, 0.9);
+  auto const expected = decimate<12> (in);
+  halfband_decimator<12> d;
+  d.process (in, span<amplitude>{in.data (), in.size () / 2U});
+  in.resize (in.size () / 2U);
+  EXPECT_EQ (in, expected);
+}
+
+TEST (OversampledVoiceAssigner, Render) {
+  oversampled_voice_assigner<48000U, nco_traits, 4U> voices;
+  voices.note_on (69U);
+  std::vector<double> out (4800U);
+  voices.render (span<double>{out});
+  auto const peak = std::abs (*std::max_element (
+      std::begin (out), std::end (out),
+      [] (double a, double b) { return std::abs (a) < std::abs (b); }));
+  EXPECT_GT (peak, 0.1);
+  EXPECT_LE (peak, 1.0);
+  voices.note_off (69U);
+  voices.render (span<double>{out});
+  EXPECT_TRUE (voices.active_voices ().none ());
+  // Only the tail of the filters remains.
+  EXPECT_THAT (std::vector<double> (std::begin (out) + 64, std::end (out)),
+               testing::Each (0.0));
+}
@@ -0,0 +1,113 @@
+#include <gmock/gmock.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "synth/resampler.hpp"
+#include "synth/wavetable.hpp"
+
+using namespace synth;
+
+namespace {
+
+std::vector<double> sine_wave (size_t const n, double const frequency,
+                               double const sample_rate) {
+  std::vector<double> result (n);
+  for (auto k = size_t{0}; k < n; ++k) {
+    result[k] = 0.5 * std::sin (two_pi * frequency * static_cast<double> (k) /
+                                sample_rate);
+  }
+  return result;
+}
+
+std::vector<double> resample (resampler& r, std::vector<double> const& in) {
+  std::vector<double> out (r.max_output (in.size ()));
+  out.resize (r.process (in, out));
+  return out;
+}
+
+double rms (std::vector<double> const& x, size_t const first) {
+  auto sum = 0.0;
+  for (auto k = first; k < x.size (); ++k) {
+    sum += x[k] * x[k];
+  }
+  return std::sqrt (sum / static_cast<double> (x.size () - first));
+}
+
+}  // end anonymous namespace
+
+TEST (Resampler, OutputCount) {
+  resampler r{96000U, 44100U};
+  auto const out = resample (r, std::vector<double> (96000U));
+  // One second of input produces a second of output less the latency.
+  auto const expected = 44100.0 * (1.0 - static_cast<double> (r.latency ()) /
+                                             96000.0);
+  EXPECT_NEAR (static_cast<double> (out.size ()), expected, 2.0);
+}
+
+TEST (Resampler, UnityGainAtDC) {
+  for (auto const [in_rate, out_rate] :
+       {std::pair{96000U, 44100U}, std::pair{44100U, 48000U},
+        std::pair{48000U, 48000U}}) {
+    resampler r{in_rate, out_rate};
+    auto const out = resample (r, std::vector<double> (4096U, 0.5));
+    for (auto k = size_t{100}; k < out.size (); ++k) {
+      ASSERT_NEAR (out[k], 0.5, 1e-5)
+          << in_rate << "->" << out_rate << " sample " << k;
+    }
+  }
+}
+
+TEST (Resampler, PassBand) {
+  // Output sample j corresponds to time j/out_rate so a sine wave comes out as
+  // the same sine wave sampled at the new rate.
+  for (auto const [in_rate, out_rate] :
+       {std::pair{96000U, 44100U}, std::pair{44100U, 48000U}}) {
+    resampler r{in_rate, out_rate};
+    auto const out =
+        resample (r, sine_wave (8192U, 1000.0, static_cast<double> (in_rate)));
+    auto const expected =
+        sine_wave (out.size (), 1000.0, static_cast<double> (out_rate));
+    for (auto k = size_t{200}; k < out.size (); ++k) {
+      ASSERT_NEAR (out[k], expected[k], 1e-4)
+          << in_rate << "->" << out_rate << " sample " << k;
+    }
+  }
+}
+
+TEST (Resampler, StopBand) {
+  // 30kHz is above the output Nyquist frequency: it must not alias.
+  resampler r{96000U, 44100U};
+  auto const out = resample (r, sine_wave (16384U, 30000.0, 96000.0));
+  EXPECT_LT (20.0 * std::log10 (rms (out, 200U) / (0.5 / std::sqrt (2.0))),
+             -70.0);
+}
+
+TEST (Resampler, BlocksMatchWhole) {
+  auto const in = sine_wave (5000U, 3000.0, 96000.0);
+  resampler whole{96000U, 44100U};
+  auto const expected = resample (whole, in);
+
+  resampler r{96000U, 44100U};
+  std::vector<double> actual;
+  for (auto first = size_t{0}, step = size_t{1}; first < in.size ();
+       first += step, step = (step * 7U) % 600U + 1U) {
+    auto const n = std::min (step, in.size () - first);
+    auto const out = resample (
+        r, std::vector<double> (in.data () + first, in.data () + first + n));
+    actual.insert (std::end (actual), std::begin (out), std::end (out));
+  }
+  EXPECT_EQ (actual, expected);
+}
+
+TEST (Resampler, UnsupportedRates) {
+  EXPECT_TRUE (resampler::is_supported (96000U, 44100U));
+  EXPECT_FALSE (resampler::is_supported (0U, 44100U));
+  EXPECT_FALSE (resampler::is_supported (96000U, 0U));
+  // 48001/gcd(48000, 48001) exceeds max_phases.
+  EXPECT_FALSE (resampler::is_supported (48000U, 48001U));
+  EXPECT_THROW (resampler (0U, 44100U), std::invalid_argument);
+  EXPECT_THROW (resampler (96000U, 0U), std::invalid_argument);
+  EXPECT_THROW (resampler (48000U, 48001U), std::invalid_argument);
+}
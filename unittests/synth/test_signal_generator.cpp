@@ -0,0 +1,139 @@
+#include <gmock/gmock.h>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "synth/signal_generator.hpp"
+#include "synth/wavetable.hpp"
+
+using namespace synth;
+
+namespace {
+
+constexpr auto sample_rate = 48000.0;
+
+/// Renders \p samples samples from \p g in one call.
+template <typename Generator>
+std::vector<double> render (Generator& g, size_t const samples) {
+  std::vector<double> out (samples);
+  g.render (span<double>{out});
+  return out;
+}
+
+/// Renders \p samples samples from \p g in calls of assorted sizes.
+template <typename Generator>
+std::vector<double> render_pieces (Generator& g, size_t const samples) {
+  std::vector<double> out (samples);
+  auto pos = size_t{0};
+  for (auto const n : {1U, 7U, 1017U, 1U, 2048U, 3000U, 33U}) {
+    auto const count = std::min (size_t{n}, samples - pos);
+    g.render (span<double>{out.data () + pos, count});
+    pos += count;
+  }
+  g.render (span<double>{out.data () + pos, samples - pos});
+  return out;
+}
+
+}  // end anonymous namespace
+
+TEST (Chirp, Exponential) {
+  constexpr auto samples = size_t{10000};
+  constexpr auto f0 = 20.0;
+  constexpr auto f1 = 20000.0;
+  chirp c{chirp_shape::exponential, f0, f1, samples, sample_rate, 0.5};
+  EXPECT_EQ (c.size (), samples);
+  auto const out = render (c, samples + 10U);
+  auto const l = std::log (f1 / f0) / static_cast<double> (samples - 1U);
+  for (auto n = size_t{0}; n < samples; ++n) {
+    auto const phase = f0 / sample_rate *
+                       std::expm1 (static_cast<double> (n) * l) /
+                       std::expm1 (l);
+    ASSERT_NEAR (out[n], 0.5 * std::sin (two_pi * phase), 1e-9)
+        << "sample " << n;
+  }
+  // The samples after the end of the chirp are zero.
+  EXPECT_THAT (std::vector<double> (out.begin () + samples, out.end ()),
+               testing::Each (0.0));
+}
+
+TEST (Chirp, Linear) {
+  constexpr auto samples = size_t{10000};
+  constexpr auto f0 = 100.0;
+  constexpr auto f1 = 10000.0;
+  chirp c{chirp_shape::linear, f0, f1, samples, sample_rate};
+  auto const out = render (c, samples);
+  auto phase = 0.0;
+  for (auto n = size_t{0}; n < samples; ++n) {
+    ASSERT_NEAR (out[n], std::sin (two_pi * phase), 1e-8) << "sample " << n;
+    phase += (f0 + (f1 - f0) * static_cast<double> (n) /
+                       static_cast<double> (samples - 1U)) /
+             sample_rate;
+  }
+}
+
+TEST (Chirp, PiecesMatchWhole) {
+  for (auto const shape : {chirp_shape::linear, chirp_shape::exponential}) {
+    chirp whole{shape, 50.0, 5000.0, 8000U, sample_rate};
+    chirp pieces{shape, 50.0, 5000.0, 8000U, sample_rate};
+    EXPECT_EQ (render_pieces (pieces, 9000U), render (whole, 9000U));
+    // reset() returns to the start.
+    pieces.reset ();
+    whole.reset ();
+    EXPECT_EQ (render (pieces, 100U), render (whole, 100U));
+  }
+}
+
+TEST (Multitone, SumOfSines) {
+  std::array<tone, 3> const tones{{
+      {440.0, 0.5, 0.0},
+      {1000.0, 0.25, 0.25},
+      {12345.6, 0.125, 0.7},
+  }};
+  multitone m{span<tone const>{tones.data (), tones.size ()}, sample_rate};
+  auto const out = render_pieces (m, 10000U);
+  for (auto n = size_t{0}; n < out.size (); ++n) {
+    auto expected = 0.0;
+    for (auto const& t : tones) {
+      expected +=
+          t.amplitude *
+          std::sin (two_pi * (t.phase + static_cast<double> (n) * t.frequency /
+                                            sample_rate));
+    }
+    ASSERT_NEAR (out[n], expected, 1e-9) << "sample " << n;
+  }
+}
+
+TEST (SteppedSine, Steps) {
+  constexpr auto per_step = size_t{1000};
+  stepped_sine s{100.0, 1600.0, 5U, per_step, sample_rate};
+  EXPECT_EQ (s.size (), 5U * per_step);
+  auto const out = render_pieces (s, 5U * per_step + 100U);
+  // The steps are 100, 200, 400, 800 and 1600Hz and the phase is continuous.
+  auto phase = 0.0;
+  for (auto n = size_t{0}; n < s.size (); ++n) {
+    ASSERT_NEAR (out[n], std::sin (two_pi * phase), 1e-9) << "sample " << n;
+    phase += 100.0 * std::pow (2.0, static_cast<double> (n / per_step)) /
+             sample_rate;
+  }
+  EXPECT_THAT (std::vector<double> (out.begin () + 5 * per_step, out.end ()),
+               testing::Each (0.0));
+}
+
+TEST (Impulse, Single) {
+  impulse i{0U, 0.5};
+  auto const out = render_pieces (i, 8000U);
+  EXPECT_EQ (out[0], 0.5);
+  EXPECT_THAT (std::vector<double> (out.begin () + 1, out.end ()),
+               testing::Each (0.0));
+}
+
+TEST (Impulse, Train) {
+  impulse whole{100U};
+  impulse pieces{100U};
+  auto const out = render (whole, 8000U);
+  EXPECT_EQ (render_pieces (pieces, 8000U), out);
+  for (auto n = size_t{0}; n < out.size (); ++n) {
+    EXPECT_EQ (out[n], n % 100U == 0U ? 1.0 : 0.0) << "sample " << n;
+  }
+}
@@ -0,0 +1,102 @@
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "synth/event.hpp"
+#include "synth/spsc_queue.hpp"
+
+using namespace synth;
+
+TEST (SpscQueue, Empty) {
+  spsc_queue<int, 4> q;
+  EXPECT_TRUE (q.empty ());
+  EXPECT_EQ (q.pop (), std::nullopt);
+}
+
+TEST (SpscQueue, Fifo) {
+  spsc_queue<int, 4> q;
+  EXPECT_TRUE (q.push (1));
+  EXPECT_TRUE (q.push (2));
+  EXPECT_FALSE (q.empty ());
+  EXPECT_EQ (q.pop (), std::optional<int>{1});
+  EXPECT_EQ (q.pop (), std::optional<int>{2});
+  EXPECT_EQ (q.pop (), std::nullopt);
+}
+
+TEST (SpscQueue, Full) {
+  spsc_queue<int, 4> q;
+  for (auto ctr = 0; ctr < 4; ++ctr) {
+    EXPECT_TRUE (q.push (ctr));
+  }
+  EXPECT_FALSE (q.push (4));
+  EXPECT_EQ (q.pop (), std::optional<int>{0});
+  EXPECT_TRUE (q.push (4));
+  // The elements come out in order after the indices have wrapped.
+  for (auto ctr = 1; ctr < 5; ++ctr) {
+    EXPECT_EQ (q.pop (), std::optional<int>{ctr});
+  }
+}
+
+TEST (SpscQueue, Drain) {
+  spsc_queue<int, 8> q;
+  q.push (1);
+  q.push (2);
+  q.push (3);
+  std::vector<int> out;
+  EXPECT_EQ (q.drain ([&out] (int v) { out.push_back (v); }), 3U);
+  EXPECT_THAT (out, testing::ElementsAre (1, 2, 3));
+  EXPECT_TRUE (q.empty ());
+  EXPECT_EQ (q.drain ([&out] (int v) { out.push_back (v); }), 0U);
+}
+
+// A producer thread pushes a long sequence through a small queue while the
+// consumer drains it. The consumer never blocks: it simply finds the queue
+// empty. Every element must arrive exactly once and in order.
+TEST (SpscQueue, Stress) {
+  constexpr auto count = uint32_t{200000};
+  spsc_queue<uint32_t, 16> q;
+  std::thread producer{[&q] {
+    for (auto v = uint32_t{0}; v < count;) {
+      if (q.push (v)) {
+        ++v;
+      } else {
+        std::this_thread::yield ();
+      }
+    }
+  }};
+
+  auto expected = uint32_t{0};
+  auto out_of_order = 0U;
+  auto calls = 0U;
+  while (expected < count) {
+    auto const before = expected;
+    // Alternate between the two ways of reading the queue.
+    if (++calls % 2U == 0U) {
+      q.drain ([&] (uint32_t const v) { out_of_order += v != expected++; });
+    } else if (auto const v = q.pop ()) {
+      out_of_order += *v != expected++;
+    }
+    if (expected == before) {
+      // Give the producer a chance to run on a single-core machine.
+      std::this_thread::yield ();
+    }
+  }
+  producer.join ();
+  EXPECT_EQ (out_of_order, 0U);
+  EXPECT_EQ (expected, count);
+  EXPECT_TRUE (q.empty ());
+}
+
+TEST (SpscQueue, Events) {
+  using event_type = event<48000U, nco_traits>;
+  event_queue<48000U, nco_traits, 4> q;
+  voice_assigner<48000U, nco_traits> voices;
+  EXPECT_TRUE (q.push (event_type::make_note_on (60U)));
+  EXPECT_TRUE (q.push (event_type::make_note_on (64U)));
+  EXPECT_TRUE (voices.active_voices ().none ());
+  EXPECT_EQ (apply_events (q, voices), 2U);
+  EXPECT_EQ (voices.active_voices ().to_ulong (), 0b11U);
+  EXPECT_TRUE (q.empty ());
+}
@@ -0,0 +1,77 @@
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <numeric>
+#include <vector>
+
+#include "synth/thread_pool.hpp"
+
+using namespace synth;
+
+namespace {
+
+/// Runs \p tasks tasks on \p pool and checks that each was executed exactly
+/// once.
+void check_each_task_once (thread_pool& pool, size_t const tasks) {
+  std::vector<std::atomic<unsigned>> counts (tasks);
+  pool.run (tasks, [&counts] (size_t const task) noexcept {
+    counts[task].fetch_add (1U, std::memory_order_relaxed);
+  });
+  for (auto task = size_t{0}; task < tasks; ++task) {
+    EXPECT_EQ (counts[task].load (), 1U) << "task " << task;
+  }
+}
+
+}  // end anonymous namespace
+
+TEST (ThreadPool, NoWorkers) {
+  thread_pool pool{0U};
+  EXPECT_EQ (pool.concurrency (), 1U);
+  check_each_task_once (pool, 0U);
+  check_each_task_once (pool, 1U);
+  check_each_task_once (pool, 100U);
+}
+
+TEST (ThreadPool, EachTaskOnce) {
+  thread_pool pool{3U};
+  EXPECT_EQ (pool.concurrency (), 4U);
+  for (auto const tasks : {size_t{0}, size_t{1}, size_t{2}, size_t{3},
+                           size_t{4}, size_t{5}, size_t{1000}}) {
+    check_each_task_once (pool, tasks);
+  }
+}
+
+TEST (ThreadPool, UnevenTasks) {
+  // The tasks in the first thread's range take much longer than the others:
+  // the other threads steal from it.
+  thread_pool pool{3U};
+  constexpr auto tasks = size_t{64};
+  std::vector<uint64_t> result (tasks);
+  pool.run (tasks, [&result] (size_t const task) noexcept {
+    auto const n = task < tasks / 4U ? 100000U : 10U;
+    auto x = uint64_t{task};
+    for (auto ctr = 0U; ctr < n; ++ctr) {
+      x = x * 6364136223846793005U + 1442695040888963407U;
+    }
+    result[task] = x;
+  });
+  for (auto task = size_t{0}; task < tasks; ++task) {
+    auto const n = task < tasks / 4U ? 100000U : 10U;
+    auto x = uint64_t{task};
+    for (auto ctr = 0U; ctr < n; ++ctr) {
+      x = x * 6364136223846793005U + 1442695040888963407U;
+    }
+    EXPECT_EQ (result[task], x) << "task " << task;
+  }
+}
+
+TEST (ThreadPool, ManyRuns) {
+  // Lots of short runs in quick succession, as in an audio callback.
+  thread_pool pool{2U};
+  std::vector<unsigned> values (8U);
+  for (auto run = 0U; run < 2000U; ++run) {
+    pool.run (values.size (),
+              [&values] (size_t const task) noexcept { ++values[task]; });
+  }
+  EXPECT_THAT (values, testing::Each (2000U));
+}
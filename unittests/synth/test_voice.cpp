@@ -0,0 +1,55 @@
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <vector>
+
+#include "synth/voice.hpp"
+
+using namespace synth;
+
+namespace {
+
+using voice_type = voice<48000U, nco_traits>;
+static_assert (voice_type::oscillators == 2U);
+
+/// The soft clipper applied by voice::mix(), in floating point.
+double saturate (double const a) {
+  if (std::abs (a) >= 1.0) {
+    return std::copysign (1.0, a);
+  }
+  return a * (2.0 - std::abs (a));
+}
+
+}  // end anonymous namespace
+
+TEST (Voice, MixSaturates) {
+  // Negative samples as well as positive ones; some of the sums fall outside
+  // [-1, 1] and are clamped.
+  std::vector<double> const values{-0.99, -0.75, -0.5, -0.1, -1.0 / 1024.0,
+                                   0.0,   0.1,   0.5,  0.75, 0.99};
+  std::vector<amplitude> in;
+  std::vector<double> expected;
+  for (auto const x : values) {
+    for (auto const y : values) {
+      expected.push_back (saturate (saturate (x) + y));
+    }
+  }
+  // mix() takes the oscillators' output as consecutive rows.
+  for (auto const x : values) {
+    std::fill_n (std::back_inserter (in), values.size (),
+                 amplitude::fromfp (x));
+  }
+  for (auto k = size_t{0}; k < values.size (); ++k) {
+    for (auto const y : values) {
+      in.push_back (amplitude::fromfp (y));
+    }
+  }
+  std::vector<amplitude> out (expected.size ());
+  voice_type::mix (span<amplitude const>{in}, span<amplitude>{out});
+  for (auto k = size_t{0}; k < out.size (); ++k) {
+    EXPECT_NEAR (out[k].as_double (), expected[k], 1e-5) << "sample " << k;
+  }
+}
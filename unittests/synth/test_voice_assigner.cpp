@@ -0,0 +1,200 @@
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "synth/voice_assigner.hpp"
+
+using namespace synth;
+
+namespace {
+
+constexpr auto sample_rate = 48000U;
+using phase = envelope<sample_rate>::phase;
+
+template <size_t Polyphony>
+using voices_type = voice_assigner<sample_rate, nco_traits, Polyphony>;
+
+template <typename Voices>
+void render (Voices& voices, size_t samples) {
+  std::vector<double> out (samples);
+  voices.render (span<double>{out});
+}
+
+}  // end anonymous namespace
+
+TEST (VoiceAssigner, NoteOffReleasesOnlyThatNote) {
+  voices_type<4> voices;
+  voices.note_on (60U);
+  voices.note_on (62U);
+  EXPECT_EQ (voices.active_voices ().to_ulong (), 0b11U);
+  voices.note_off (60U);
+  render (voices, 64U);  // The release time is zero.
+  EXPECT_EQ (voices.active_voices ().to_ulong (), 0b10U);
+  EXPECT_EQ (voices.note (0U), voices_type<4>::no_note);
+  EXPECT_EQ (voices.note (1U), 62U);
+}
+
+TEST (VoiceAssigner, FreeVoiceBeforeStealing) {
+  voices_type<2> voices;
+  voices.note_on (60U);
+  voices.note_on (62U);
+  voices.note_off (60U);
+  render (voices, 64U);
+  // Voice 0 is free so the new note must not take voice 1.
+  voices.note_on (64U);
+  EXPECT_EQ (voices.note (0U), 64U);
+  EXPECT_EQ (voices.note (1U), 62U);
+}
+
+TEST (VoiceAssigner, RetriggerReusesVoice) {
+  voices_type<4> voices;
+  voices.set_envelope (phase::release, 1.0);
+  voices.note_on (60U);
+  voices.note_off (60U);
+  voices.note_on (60U);
+  EXPECT_EQ (voices.active_voices ().count (), 1U);
+  render (voices, 64U);
+  voices.note_off (60U);
+  render (voices, 64U);
+  // The voice is still releasing.
+  EXPECT_EQ (voices.active_voices ().count (), 1U);
+}
+
+TEST (VoiceAssigner, StealOldest) {
+  voices_type<2> voices;
+  voices.set_envelope (phase::release, 1.0);
+  voices.note_on (60U);
+  voices.note_on (62U);
+  render (voices, 64U);
+  voices.note_off (62U);
+  voices.note_on (64U);
+  EXPECT_EQ (voices.note (0U), 64U);
+  EXPECT_EQ (voices.note (1U), 62U);
+  // Note 60 lost its voice so releasing it has no effect.
+  voices.note_off (60U);
+  EXPECT_EQ (voices.note (0U), 64U);
+}
+
+TEST (VoiceAssigner, StealReleasingFirst) {
+  voices_type<2> voices;
+  voices.set_steal_policy (steal_policy::releasing_first);
+  voices.set_envelope (phase::release, 1.0);
+  voices.note_on (60U);
+  voices.note_on (62U);
+  render (voices, 64U);
+  voices.note_off (62U);
+  voices.note_on (64U);
+  EXPECT_EQ (voices.note (0U), 60U);
+  EXPECT_EQ (voices.note (1U), 64U);
+}
+
+TEST (VoiceAssigner, StealQuietest) {
+  voices_type<2> voices;
+  voices.set_steal_policy (steal_policy::quietest);
+  voices.set_envelope (phase::attack, 0.5);
+  voices.note_on (60U);
+  render (voices, 1000U);
+  voices.note_on (62U);  // Still at level zero.
+  voices.note_on (64U);
+  EXPECT_EQ (voices.note (0U), 60U);
+  EXPECT_EQ (voices.note (1U), 64U);
+}
+
+// A stolen voice which is sounding fades out before its new note starts.
+TEST (VoiceAssigner, StolenVoiceIsQuenched) {
+  voices_type<1> voices;
+  voices.note_on (60U);
+  std::vector<double> out (64U);
+  voices.render (span<double>{out});
+  auto const full = std::abs (out.back ());
+  EXPECT_GT (full, 0.0);
+
+  voices.note_on (72U);
+  EXPECT_EQ (voices.note (0U), 72U);
+  // The quench lasts envelope::quench_time. The output must shrink during that
+  // time rather than jump to the new note.
+  constexpr auto quench_samples = static_cast<size_t> (
+      envelope<sample_rate>::quench_time * sample_rate);
+  std::vector<double> fade (quench_samples);
+  voices.render (span<double>{fade});
+  EXPECT_LE (std::abs (fade.front ()), 1.0);
+  EXPECT_NEAR (fade.back (), 0.0, 0.02);
+  EXPECT_TRUE (voices.active_voices ().any ());
+  // Once the quench is complete, the voice plays the new note.
+  render (voices, 128U);
+  EXPECT_TRUE (voices.active_voices ().any ());
+  voices.note_off (72U);
+  render (voices, 64U);
+  EXPECT_TRUE (voices.active_voices ().none ());
+}
+
+TEST (VoiceAssigner, LargePolyphony) {
+  voices_type<256> voices;
+  for (auto note = 0U; note < 128U; ++note) {
+    voices.note_on (note);
+  }
+  EXPECT_EQ (voices.active_voices ().count (), 128U);
+  render (voices, 64U);
+  for (auto note = 0U; note < 128U; note += 2U) {
+    voices.note_off (note);
+  }
+  render (voices, 64U);
+  EXPECT_EQ (voices.active_voices ().count (), 64U);
+}
+
+// The output when rendering with a thread pool is bit-identical to that
+// produced by a single thread, whatever the number of threads.
+TEST (VoiceAssigner, ThreadPoolMatchesSingleThread) {
+  using voices = voices_type<160>;  // Five chunks, the last one partial.
+  auto const play = [] (thread_pool* const pool) {
+    auto v = std::make_unique<voices> ();
+    v->set_thread_pool (pool);
+    v->set_envelope (phase::release, 0.01);
+    std::vector<double> out (1000U);
+    auto pos = size_t{0};
+    // Notes are started and released between blocks so that chunks become
+    // busy and idle.
+    for (auto step = 0U; step < 10U; ++step) {
+      for (auto note = step * 7U; note < 128U; note += 11U) {
+        v->note_on (note);
+      }
+      for (auto note = step * 3U; note < 128U; note += 13U) {
+        v->note_off (note);
+      }
+      v->render (span<double>{out.data () + pos, 100U});
+      pos += 100U;
+    }
+    return out;
+  };
+  auto const expected = play (nullptr);
+  for (auto const workers : {0U, 1U, 3U}) {
+    thread_pool pool{workers};
+    EXPECT_EQ (play (&pool), expected) << workers << " workers";
+  }
+}
+
+TEST (VoiceAssigner, RenderAmplitudeMatchesTick) {
+  // Enough notes that the mix exceeds [-1, 1] and is saturated.
+  voices_type<8> block;
+  voices_type<8> ticked;
+  for (auto const note : {48U, 52U, 55U, 60U, 64U, 67U, 72U, 76U}) {
+    block.note_on (note);
+    ticked.note_on (note);
+  }
+  // More than one of the assigner's internal blocks.
+  std::vector<amplitude> out (300U);
+  block.render (span<amplitude>{out});
+  auto clipped = 0U;
+  for (auto k = size_t{0}; k < out.size (); ++k) {
+    auto const expected = ticked.tick ();
+    if (expected > 1.0 || expected < -1.0) {
+      ++clipped;
+    }
+    EXPECT_EQ (out[k].as_double (), std::clamp (expected, -1.0, 1.0))
+        << "sample " << k;
+  }
+  EXPECT_GT (clipped, 0U);
+}
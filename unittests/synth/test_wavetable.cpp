@@ -1,5 +1,9 @@
 #include <gmock/gmock.h>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "synth/wavetable.hpp"
 
 using namespace synth;
@@ -82,3 +86,127 @@ TEST (Wavetable, f) {
   //  (wt.phase_to_amplitude(phase_index_type::fromfp (sixteenth)),
   //  amplitude::fromfp (-1.0));
 }
+
+namespace {
+
+template <interpolation Interpolation, unsigned N = 2U>
+struct interpolated_traits {
+  static constexpr auto wavetable_N = N;
+  static constexpr auto M = 32U;
+  static constexpr auto interpolation = Interpolation;
+};
+
+template <typename Traits>
+typename oscillator_info<Traits>::phase_index_type phase (double const x) {
+  return oscillator_info<Traits>::phase_index_type::fromfp (x);
+}
+
+/// Returns the largest absolute difference between a sine wavetable using
+/// traits \p Traits and std::sin().
+template <typename Traits>
+double max_sine_error () {
+  using phase_index_type = typename oscillator_info<Traits>::phase_index_type;
+  wavetable<Traits> const wt{[] (double const theta) {
+    return std::sin (theta);
+  }};
+  auto result = 0.0;
+  constexpr auto steps = 10000U;
+  constexpr auto entries = double{1U << Traits::wavetable_N};
+  for (auto ctr = 0U; ctr < steps; ++ctr) {
+    auto const x = entries * ctr / steps;
+    auto const actual = wt.phase_to_amplitude (phase_index_type::fromfp (x));
+    result = std::max (
+        result, std::abs (actual.as_double () - std::sin (two_pi * x / entries)));
+  }
+  return result;
+}
+
+template <typename Traits>
+void check_batch_matches_scalar () {
+  using phase_index_type = typename oscillator_info<Traits>::phase_index_type;
+  wavetable<Traits> const wt{[] (double const theta) {
+    return std::sin (theta);
+  }};
+  // An odd size exercises both the vector and the scalar paths.
+  std::vector<phase_index_type> phases (37);
+  auto p = uint32_t{0};
+  for (auto& x : phases) {
+    x = phase_index_type::frombits (p);
+    p += 0x9E3779B9U;
+  }
+  std::vector<amplitude> actual (phases.size ());
+  wt.phase_to_amplitude (phases, actual);
+  for (auto ctr = size_t{0}; ctr < phases.size (); ++ctr) {
+    EXPECT_EQ (actual[ctr], wt.phase_to_amplitude (phases[ctr]))
+        << "index " << ctr;
+  }
+}
+
+}  // end anonymous namespace
+
+TEST (Wavetable, Linear) {
+  using traits = interpolated_traits<interpolation::linear>;
+  // The table entries are -1, -0.5, 0, 0.5.
+  wavetable<traits> const wt{[] (double const theta) { return theta / pi - 1.0; }};
+  EXPECT_EQ (wt.phase_to_amplitude (phase<traits> (0.0)),
+             amplitude::fromfp (-1.0));
+  EXPECT_EQ (wt.phase_to_amplitude (phase<traits> (0.5)),
+             amplitude::fromfp (-0.75));
+  EXPECT_EQ (wt.phase_to_amplitude (phase<traits> (2.25)),
+             amplitude::fromfp (0.125));
+  // Between the last entry and the first.
+  EXPECT_EQ (wt.phase_to_amplitude (phase<traits> (3.5)),
+             amplitude::fromfp (-0.25));
+}
+
+TEST (Wavetable, CubicPassesThroughEntries) {
+  using traits = interpolated_traits<interpolation::cubic>;
+  wavetable<traits> const wt{[] (double const theta) { return theta / pi - 1.0; }};
+  EXPECT_EQ (wt.phase_to_amplitude (phase<traits> (0.0)),
+             amplitude::fromfp (-1.0));
+  EXPECT_EQ (wt.phase_to_amplitude (phase<traits> (1.0)),
+             amplitude::fromfp (-0.5));
+  EXPECT_EQ (wt.phase_to_amplitude (phase<traits> (3.0)),
+             amplitude::fromfp (0.5));
+  // Midway between two points on a straight line, Catmull-Rom interpolation
+  // is exact.
+  EXPECT_EQ (wt.phase_to_amplitude (phase<traits> (1.5)),
+             amplitude::fromfp (-0.25));
+}
+
+TEST (Wavetable, InterpolationReducesError) {
+  constexpr auto N = 8U;
+  auto const none = max_sine_error<interpolated_traits<interpolation::none, N>> ();
+  auto const linear =
+      max_sine_error<interpolated_traits<interpolation::linear, N>> ();
+  auto const cubic =
+      max_sine_error<interpolated_traits<interpolation::cubic, N>> ();
+  EXPECT_LT (linear, none / 50.0);
+  EXPECT_LT (cubic, linear);
+  EXPECT_LT (cubic, 1e-5);
+}
+
+TEST (Wavetable, BatchMatchesScalar) {
+  check_batch_matches_scalar<interpolated_traits<interpolation::none, 8U>> ();
+  check_batch_matches_scalar<interpolated_traits<interpolation::linear, 8U>> ();
+  check_batch_matches_scalar<interpolated_traits<interpolation::cubic, 8U>> ();
+}
+
+// The standard wavetables are built at compile time.
+static_assert (sine<nco_traits>.phase_to_amplitude (
+                   oscillator_info<nco_traits>::phase_index_type::fromint (0)) ==
+               amplitude::fromint (0));
+static_assert (square<nco_traits>.phase_to_amplitude (
+                   oscillator_info<nco_traits>::phase_index_type::fromint (0)) ==
+               amplitude::fromint (1));
+
+TEST (Wavetable, ConstexprSineMatchesStd) {
+  wavetable<nco_traits> const expected{
+      [] (double const theta) { return std::sin (theta); }};
+  EXPECT_TRUE (std::equal (std::begin (sine<nco_traits>),
+                           std::end (sine<nco_traits>), std::begin (expected)));
+  for (auto ctr = -20; ctr <= 20; ++ctr) {
+    auto const x = static_cast<double> (ctr) * 0.7;
+    EXPECT_NEAR (details::sin (x), std::sin (x), 1e-15) << "x=" << x;
+  }
+}
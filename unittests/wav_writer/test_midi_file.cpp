@@ -0,0 +1,262 @@
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <vector>
+
+#include "midi_file.hpp"
+
+using namespace synth;
+
+namespace {
+
+using bytes = std::vector<uint8_t>;
+
+constexpr uint8_t hi (unsigned const x) noexcept {
+  return static_cast<uint8_t> (x >> 8U);
+}
+constexpr uint8_t lo (unsigned const x) noexcept {
+  return static_cast<uint8_t> (x & 0xFFU);
+}
+
+/// The end-of-track meta event with a zero delta-time.
+bytes const end_of_track{0x00, 0xFF, 0x2F, 0x00};
+
+/// Returns an MThd chunk.
+bytes header (unsigned const format, unsigned const tracks,
+              unsigned const division) {
+  return {'M', 'T', 'h', 'd', 0, 0, 0, 6,  //
+          hi (format),   lo (format),        //
+          hi (tracks),   lo (tracks),        //
+          hi (division), lo (division)};
+}
+
+/// Appends a chunk of type \p id containing \p payload to \p file. If \p size
+/// is given, it is written as the chunk size in place of the payload's size.
+void append_chunk (bytes& file, char const* const id, bytes const& payload,
+                   std::optional<uint32_t> const size = std::nullopt) {
+  auto const s = size.value_or (static_cast<uint32_t> (payload.size ()));
+  file.insert (file.end (), id, id + 4);
+  for (auto shift : {24U, 16U, 8U, 0U}) {
+    file.push_back (static_cast<uint8_t> (s >> shift));
+  }
+  file.insert (file.end (), payload.begin (), payload.end ());
+}
+
+/// Returns a file with the tracks \p tracks, each of which is followed by an
+/// end-of-track event. A file with more than one track is format 1.
+bytes smf (unsigned const division, std::initializer_list<bytes> tracks) {
+  auto file = header (tracks.size () > 1U ? 1U : 0U,
+                      static_cast<unsigned> (tracks.size ()), division);
+  for (auto track : tracks) {
+    track.insert (track.end (), end_of_track.begin (), end_of_track.end ());
+    append_chunk (file, "MTrk", track);
+  }
+  return file;
+}
+
+std::vector<note_event> read (bytes const& file) {
+  return read_midi_file (span<uint8_t const>{file});
+}
+
+/// Reads a variable-length quantity which must occupy all of \p b.
+uint32_t vlq (bytes const& b) {
+  details::smf_reader r{span<uint8_t const>{b}};
+  auto const result = r.vlq ();
+  EXPECT_TRUE (r.empty ());
+  return result;
+}
+
+/// Checks that \p e is a note-on (or note-off) for \p note at \p time seconds.
+void check (note_event const& e, double const time, bool const on,
+            unsigned const note) {
+  EXPECT_NEAR (e.time, time, 1e-9);
+  EXPECT_EQ (e.on, on);
+  EXPECT_EQ (e.note, note);
+}
+
+}  // end anonymous namespace
+
+TEST (SmfReader, Vlq) {
+  // The examples from the Standard MIDI File specification.
+  EXPECT_EQ (vlq ({0x00}), 0x00U);
+  EXPECT_EQ (vlq ({0x40}), 0x40U);
+  EXPECT_EQ (vlq ({0x7F}), 0x7FU);
+  EXPECT_EQ (vlq ({0x81, 0x00}), 0x80U);
+  EXPECT_EQ (vlq ({0xC0, 0x00}), 0x2000U);
+  EXPECT_EQ (vlq ({0xFF, 0x7F}), 0x3FFFU);
+  EXPECT_EQ (vlq ({0x81, 0x80, 0x00}), 0x4000U);
+  EXPECT_EQ (vlq ({0xFF, 0xFF, 0x7F}), 0x1FFFFFU);
+  EXPECT_EQ (vlq ({0x81, 0x80, 0x80, 0x00}), 0x200000U);
+  EXPECT_EQ (vlq ({0xFF, 0xFF, 0xFF, 0x7F}), 0xFFFFFFFU);
+}
+TEST (SmfReader, VlqTooLong) {
+  bytes const b{0x80, 0x80, 0x80, 0x80, 0x00};
+  details::smf_reader r{span<uint8_t const>{b}};
+  EXPECT_THROW (r.vlq (), midi_file_error);
+}
+TEST (SmfReader, VlqTruncated) {
+  bytes const b{0x81, 0x80};
+  details::smf_reader r{span<uint8_t const>{b}};
+  EXPECT_THROW (r.vlq (), midi_file_error);
+}
+TEST (SmfReader, BigEndian) {
+  bytes const b{0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE};
+  details::smf_reader r{span<uint8_t const>{b}};
+  EXPECT_EQ (r.u16 (), 0x1234U);
+  EXPECT_EQ (r.u32 (), 0x56789ABCU);
+  EXPECT_EQ (r.pos (), 6U);
+  EXPECT_THROW (r.u16 (), midi_file_error);
+}
+
+TEST (MidiFile, NoteEvents) {
+  // 96 ticks per quarter note at the default 120 bpm: a tick is 1/192 s.
+  auto const events = read (smf (96U, {{0x00, 0x91, 60, 100,  //
+                                        0x60, 0x81, 60, 64,   //
+                                        0x30, 0x91, 62, 0}}));
+  ASSERT_EQ (events.size (), 3U);
+  check (events[0], 0.0, true, 60U);
+  EXPECT_EQ (events[0].channel, 1U);
+  EXPECT_EQ (events[0].velocity, 100U);
+  check (events[1], 0.5, false, 60U);
+  EXPECT_EQ (events[1].velocity, 64U);
+  // A note-on with zero velocity is a note-off.
+  check (events[2], 0.75, false, 62U);
+}
+
+TEST (MidiFile, RunningStatus) {
+  // Running status applies to messages with one data byte as well as two.
+  auto const events = read (smf (96U, {{0x00, 0x90, 60, 100,  //
+                                        0x30, 62, 100,        // note-on
+                                        0x30, 60, 0,          // note-off
+                                        0x00, 0xC0, 5,        //
+                                        0x00, 6,              // program change
+                                        0x30, 0x90, 64, 100}}));
+  ASSERT_EQ (events.size (), 4U);
+  check (events[0], 0.0, true, 60U);
+  check (events[1], 0.25, true, 62U);
+  check (events[2], 0.5, false, 60U);
+  check (events[3], 0.75, true, 64U);
+}
+
+TEST (MidiFile, MetaAndSysexCancelRunningStatus) {
+  EXPECT_THROW (read (smf (96U, {{0x00, 0x90, 60, 100,  //
+                                  0x00, 0xFF, 0x01, 0x00,  // empty text
+                                  0x00, 62, 100}})),
+                midi_file_error);
+  EXPECT_THROW (read (smf (96U, {{0x00, 0x90, 60, 100,  //
+                                  0x00, 0xF0, 0x01, 0xF7,  //
+                                  0x00, 62, 100}})),
+                midi_file_error);
+  EXPECT_THROW (read (smf (96U, {{0x00, 60, 100}})), midi_file_error);
+}
+
+TEST (MidiFile, MetaAndSysexLengths) {
+  // A text event with a two-byte length whose payload contains bytes which
+  // look like status bytes, then a sysex message and a sysex escape.
+  bytes track{0x00, 0xFF, 0x01, 0x81, 0x00};  // 128 bytes of text
+  track.insert (track.end (), 128U, 0x90);
+  track.insert (track.end (), {0x10, 0xF0, 0x03, 0x7E, 0x7F, 0xF7,  //
+                               0x10, 0xF7, 0x02, 0xF8, 0xFA,        //
+                               0x10, 0x90, 60, 100});
+  auto const events = read (smf (96U, {track}));
+  ASSERT_EQ (events.size (), 1U);
+  check (events[0], 48.0 / 192.0, true, 60U);
+}
+
+TEST (MidiFile, TempoMap) {
+  // 480 ticks per quarter note. The tempo changes from 120 bpm to 60 bpm at
+  // tick 960 (one second). Tempo changes in the first track apply to the
+  // second.
+  auto const events = read (smf (
+      480U, {{0x00, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20,           // 120 bpm
+              0x87, 0x40, 0xFF, 0x51, 0x03, 0x0F, 0x42, 0x40},    // 60 bpm
+             {0x83, 0x60, 0x90, 60, 100,                          // tick 480
+              0x87, 0x40, 0x80, 60, 64}}));                       // tick 1440
+  ASSERT_EQ (events.size (), 2U);
+  check (events[0], 0.5, true, 60U);
+  check (events[1], 2.0, false, 60U);
+}
+
+TEST (MidiFile, SameTickOrderedByTrack) {
+  auto const events =
+      read (smf (96U, {{0x60, 0x90, 60, 100}, {0x60, 0x90, 62, 100}}));
+  ASSERT_EQ (events.size (), 2U);
+  check (events[0], 0.5, true, 60U);
+  check (events[1], 0.5, true, 62U);
+}
+
+TEST (MidiFile, Smpte) {
+  // 25 frames per second and 40 ticks per frame: 1000 ticks per second.
+  // Tempo events don't affect SMPTE time.
+  auto const events =
+      read (smf ((0xE7U << 8U) | 40U,
+                 {{0x00, 0xFF, 0x51, 0x03, 0x0F, 0x42, 0x40,  //
+                   0x87, 0x68, 0x90, 60, 100}}));
+  ASSERT_EQ (events.size (), 1U);
+  check (events[0], 1.0, true, 60U);
+}
+TEST (MidiFile, SmpteDropFrame) {
+  // -29 means 29.97 frames per second. 2997 ticks of 100 per frame is one
+  // second.
+  auto const events = read (
+      smf ((0xE3U << 8U) | 100U, {{0x97, 0x35, 0x90, 60, 100}}));
+  ASSERT_EQ (events.size (), 1U);
+  check (events[0], 1.0, true, 60U);
+}
+TEST (MidiFile, BadDivision) {
+  EXPECT_THROW (read (smf (0U, {{}})), midi_file_error);
+  EXPECT_THROW (read (smf (0xE700U, {{}})), midi_file_error);  // 0 ticks/frame
+}
+
+TEST (MidiFile, UnknownChunk) {
+  auto file = header (0U, 1U, 96U);
+  append_chunk (file, "XFIH", {0x90, 60, 100});
+  append_chunk (file, "MTrk", {0x00, 0x90, 60, 100, 0x00, 0xFF, 0x2F, 0x00,
+                               0x00, 0x90, 62, 100});  // After end of track.
+  auto const events = read (file);
+  ASSERT_EQ (events.size (), 1U);
+  check (events[0], 0.0, true, 60U);
+}
+
+TEST (MidiFile, TruncatedHeader) {
+  EXPECT_THROW (read ({'M', 'T', 'h', 'd', 0, 0}), midi_file_error);
+  auto file = header (0U, 1U, 96U);
+  file.resize (file.size () - 1U);
+  EXPECT_THROW (read (file), midi_file_error);
+}
+TEST (MidiFile, TruncatedChunk) {
+  auto const complete = smf (96U, {{0x00, 0x90, 60, 100}});
+  // Cut the file off part-way through the track's length field and then
+  // part-way through its payload.
+  for (auto const size : {header (0U, 1U, 96U).size () + 6U,
+                          complete.size () - 1U}) {
+    bytes const file{complete.begin (),
+                     complete.begin () + static_cast<std::ptrdiff_t> (size)};
+    EXPECT_THROW (read (file), midi_file_error) << "size " << size;
+  }
+}
+TEST (MidiFile, ChunkLengthTooLong) {
+  auto file = header (0U, 1U, 96U);
+  append_chunk (file, "MTrk", {0x00, 0x90, 60, 100}, 100U);
+  EXPECT_THROW (read (file), midi_file_error);
+}
+TEST (MidiFile, EventLengthBeyondChunk) {
+  // Neither a meta event's length nor a channel message may run into the
+  // chunk which follows the track.
+  for (auto const& track : {bytes{0x00, 0xFF, 0x01, 0x05, 'a'},
+                            bytes{0x00, 0x90, 60}}) {
+    auto file = header (1U, 2U, 96U);
+    append_chunk (file, "MTrk", track);
+    append_chunk (file, "MTrk", {0x00, 0x90, 60, 100});
+    EXPECT_THROW (read (file), midi_file_error);
+  }
+}
+TEST (MidiFile, IncompleteMessage) {
+  EXPECT_THROW (read (smf (96U, {{0x00, 0x90, 60, 0x80, 60, 64}})),
+                midi_file_error);
+}
+TEST (MidiFile, SystemMessageInTrack) {
+  EXPECT_THROW (read (smf (96U, {{0x00, 0xF8}})), midi_file_error);
+}
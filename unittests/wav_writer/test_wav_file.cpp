@@ -0,0 +1,175 @@
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "wav_stream.hpp"
+
+using namespace synth;
+
+namespace {
+
+uint32_t le16 (std::vector<uint8_t> const& b, size_t const pos) {
+  return uint32_t{b[pos]} | uint32_t{b[pos + 1U]} << 8U;
+}
+uint32_t le32 (std::vector<uint8_t> const& b, size_t const pos) {
+  return le16 (b, pos) | le16 (b, pos + 2U) << 16U;
+}
+
+/// Returns the bytes [first, last) of \p b.
+std::vector<uint8_t> bytes (std::vector<uint8_t> const& b, size_t const first,
+                            size_t const last) {
+  return {b.begin () + static_cast<std::ptrdiff_t> (first),
+          b.begin () + static_cast<std::ptrdiff_t> (last)};
+}
+
+struct chunk {
+  std::string id;
+  size_t offset;  ///< The offset of the chunk's payload.
+  uint32_t size;
+};
+
+/// Returns the chunks of the RIFF file \p b in order.
+std::vector<chunk> chunks (std::vector<uint8_t> const& b) {
+  std::vector<chunk> result;
+  for (auto pos = size_t{12}; pos + 8U <= b.size ();) {
+    auto const size = le32 (b, pos + 4U);
+    auto const id = bytes (b, pos, pos + 4U);
+    result.push_back (
+        chunk{std::string{id.begin (), id.end ()}, pos + 8U, size});
+    pos += 8U + size + (size & 1U);
+  }
+  return result;
+}
+
+std::vector<double> samples (size_t const n) {
+  std::vector<double> result (n);
+  for (auto k = size_t{0}; k < n; ++k) {
+    result[k] = static_cast<double> (k % 50U) / 25.0 - 1.0;
+  }
+  return result;
+}
+
+/// Writes a file with \p frames frames of \p format.
+std::vector<uint8_t> write (wav_format const& format, size_t const frames,
+                            dither_mode const dither = dither_mode::none) {
+  std::stringstream ss;
+  {
+    wav_stream out{ss, format, dither};
+    auto const in = samples (frames * format.channels);
+    out.write (span<double const>{in});
+    EXPECT_TRUE (out.close ());
+  }
+  auto const s = ss.str ();
+  return {s.begin (), s.end ()};
+}
+
+std::vector<std::string> ids (std::vector<chunk> const& c) {
+  std::vector<std::string> result;
+  for (auto const& x : c) {
+    result.push_back (x.id);
+  }
+  return result;
+}
+
+/// Checks the fields common to every format chunk.
+void check_format (std::vector<uint8_t> const& b, chunk const& fmt,
+                   uint32_t const tag, wav_format const& format) {
+  EXPECT_EQ (le16 (b, fmt.offset), tag);                      // wFormatTag
+  EXPECT_EQ (le16 (b, fmt.offset + 2U), format.channels);     // wChannels
+  EXPECT_EQ (le32 (b, fmt.offset + 4U), format.sample_rate);  // dwSamplesPerSec
+  EXPECT_EQ (le32 (b, fmt.offset + 8U),
+             format.sample_rate * format.block_align ());  // dwAvgBytesPerSec
+  EXPECT_EQ (le16 (b, fmt.offset + 12U), format.block_align ());  // wBlockAlign
+  EXPECT_EQ (le16 (b, fmt.offset + 14U),
+             format.bits_per_sample ());  // wBitsPerSample
+}
+
+}  // end anonymous namespace
+
+TEST (WavFile, Pcm) {
+  for (auto const f :
+       {sample_format::int16, sample_format::int24, sample_format::int32}) {
+    for (auto const channels : {1U, 2U}) {
+      wav_format const format{44100U, channels, f};
+      auto const b = write (format, 11U);
+      auto const c = chunks (b);
+      EXPECT_THAT (ids (c), testing::ElementsAre ("JUNK", "fmt ", "data"));
+      ASSERT_EQ (c.size (), 3U);
+      EXPECT_EQ (c[1].size, 16U);
+      check_format (b, c[1], 1U, format);  // WAVE_FORMAT_PCM
+      EXPECT_EQ (c[2].size, 11U * format.block_align ());
+      EXPECT_EQ (le32 (b, 4U), b.size () - 8U);
+    }
+  }
+}
+
+TEST (WavFile, Float) {
+  wav_format const format{96000U, 2U, sample_format::float32};
+  auto const b = write (format, 13U);
+  auto const c = chunks (b);
+  // A non-PCM format has cbSize in its format chunk and a fact chunk.
+  EXPECT_THAT (ids (c), testing::ElementsAre ("JUNK", "fmt ", "fact", "data"));
+  ASSERT_EQ (c.size (), 4U);
+  EXPECT_EQ (c[1].size, 18U);
+  check_format (b, c[1], 3U, format);  // WAVE_FORMAT_IEEE_FLOAT
+  EXPECT_EQ (le16 (b, c[1].offset + 16U), 0U);  // cbSize
+  EXPECT_EQ (c[2].size, 4U);
+  EXPECT_EQ (le32 (b, c[2].offset), 13U);  // dwSampleLength
+  EXPECT_EQ (c[3].size, 13U * 8U);
+  EXPECT_EQ (le32 (b, 4U), b.size () - 8U);
+}
+
+TEST (WavFile, Extensible) {
+  for (auto const f : {sample_format::int24, sample_format::float32}) {
+    wav_format const format{48000U, 6U, f};
+    auto const b = write (format, 5U);
+    auto const c = chunks (b);
+    auto const fmt = c.at (1U);
+    EXPECT_EQ (fmt.id, "fmt ");
+    EXPECT_EQ (fmt.size, 40U);
+    check_format (b, fmt, 0xFFFEU, format);  // WAVE_FORMAT_EXTENSIBLE
+    EXPECT_EQ (le16 (b, fmt.offset + 16U), 22U);  // cbSize
+    EXPECT_EQ (le16 (b, fmt.offset + 18U),
+               format.bits_per_sample ());          // wValidBitsPerSample
+    EXPECT_EQ (le32 (b, fmt.offset + 20U), 0x3FU);  // dwChannelMask
+    // SubFormat: KSDATAFORMAT_SUBTYPE_PCM or KSDATAFORMAT_SUBTYPE_IEEE_FLOAT.
+    auto const tag = static_cast<uint8_t> (format.is_float () ? 3U : 1U);
+    EXPECT_THAT (bytes (b, fmt.offset + 24U, fmt.offset + 40U),
+                 testing::ElementsAre (tag, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10,
+                                       0x00, 0x80, 0x00, 0x00, 0xAA, 0x00,
+                                       0x38, 0x9B, 0x71));
+    if (format.is_float ()) {
+      EXPECT_THAT (ids (c),
+                   testing::ElementsAre ("JUNK", "fmt ", "fact", "data"));
+    } else {
+      EXPECT_THAT (ids (c), testing::ElementsAre ("JUNK", "fmt ", "data"));
+    }
+    EXPECT_EQ (c.back ().size, 5U * format.block_align ());
+    EXPECT_EQ (le32 (b, 4U), b.size () - 8U);
+  }
+}
+
+TEST (WavFile, Dither) {
+  wav_format const format{48000U, 1U, sample_format::int16};
+  auto const plain = write (format, 1000U);
+  auto const dithered = write (format, 1000U, dither_mode::tpdf);
+  ASSERT_EQ (plain.size (), dithered.size ());
+  auto const data = chunks (plain).back ().offset;
+  auto differences = 0U;
+  for (auto pos = data; pos < plain.size (); pos += 2U) {
+    auto const a = static_cast<int16_t> (le16 (plain, pos));
+    auto const b = static_cast<int16_t> (le16 (dithered, pos));
+    // TPDF dither is less than one LSB in each direction.
+    EXPECT_LE (std::abs (a - b), 1) << "offset " << pos;
+    differences += a != b;
+  }
+  EXPECT_GT (differences, 0U);
+  // Dither is applied only to 16-bit output.
+  wav_format const format24{48000U, 1U, sample_format::int24};
+  EXPECT_EQ (write (format24, 1000U, dither_mode::tpdf),
+             write (format24, 1000U));
+}
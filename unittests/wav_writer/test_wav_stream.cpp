@@ -0,0 +1,225 @@
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "wav_stream.hpp"
+
+using namespace synth;
+
+namespace {
+
+/// A file in the temporary directory which is deleted when the object is
+/// destroyed. Its name is that of the running test.
+class temporary_file {
+public:
+  temporary_file ()
+      : path_{std::filesystem::temp_directory_path () /
+              (std::string{"synth_"} + test_name () + ".wav")} {}
+  temporary_file (temporary_file const&) = delete;
+  ~temporary_file () noexcept {
+    std::error_code ec;
+    std::filesystem::remove (path_, ec);
+  }
+  temporary_file& operator= (temporary_file const&) = delete;
+
+  std::filesystem::path const& path () const noexcept { return path_; }
+  std::vector<uint8_t> contents () const {
+    std::ifstream is{path_, std::ios::binary};
+    return {std::istreambuf_iterator<char>{is},
+            std::istreambuf_iterator<char>{}};
+  }
+
+private:
+  static char const* test_name () {
+    return testing::UnitTest::GetInstance ()->current_test_info ()->name ();
+  }
+
+  std::filesystem::path path_;
+};
+
+std::ofstream open (temporary_file const& f) {
+  return std::ofstream{f.path (), std::ios::binary | std::ios::trunc};
+}
+
+std::string fourcc (std::vector<uint8_t> const& b, size_t const pos) {
+  return {b.begin () + static_cast<std::ptrdiff_t> (pos),
+          b.begin () + static_cast<std::ptrdiff_t> (pos + 4U)};
+}
+uint32_t le32 (std::vector<uint8_t> const& b, size_t const pos) {
+  return uint32_t{b[pos]} | uint32_t{b[pos + 1U]} << 8U |
+         uint32_t{b[pos + 2U]} << 16U | uint32_t{b[pos + 3U]} << 24U;
+}
+uint64_t le64 (std::vector<uint8_t> const& b, size_t const pos) {
+  return uint64_t{le32 (b, pos)} | uint64_t{le32 (b, pos + 4U)} << 32U;
+}
+
+std::vector<double> ramp (size_t const n) {
+  std::vector<double> result (n);
+  for (auto k = size_t{0}; k < n; ++k) {
+    result[k] = static_cast<double> (k % 200U) / 100.0 - 1.0;
+  }
+  return result;
+}
+
+/// The offset of the data chunk of a mono or stereo PCM file: RIFF header
+/// (12), JUNK or ds64 (8+28), and fmt (8+16).
+constexpr auto pcm_data_chunk = size_t{72};
+
+/// A stream buffer which rejects everything written to it.
+class failing_buffer : public std::streambuf {
+protected:
+  int_type overflow (int_type) override { return traits_type::eof (); }
+  std::streamsize xsputn (char const*, std::streamsize) override { return 0; }
+};
+
+}  // end anonymous namespace
+
+TEST (WavStream, RiffSizes) {
+  temporary_file file;
+  auto const in = ramp (1001U);
+  {
+    auto os = open (file);
+    wav_stream out{os, wav_format{48000U, 1U, sample_format::int24}};
+    out.write (span<double const>{in});
+    EXPECT_TRUE (out.close ());
+  }
+  auto const b = file.contents ();
+  // 1001 24-bit samples is an odd number of bytes so a pad byte follows.
+  auto const data_size = size_t{3003};
+  ASSERT_EQ (b.size (), pcm_data_chunk + 8U + data_size + 1U);
+  EXPECT_EQ (fourcc (b, 0U), "RIFF");
+  EXPECT_EQ (le32 (b, 4U), b.size () - 8U);
+  EXPECT_EQ (fourcc (b, 8U), "WAVE");
+  EXPECT_EQ (fourcc (b, 12U), "JUNK");
+  EXPECT_EQ (le32 (b, 16U), 28U);
+  EXPECT_EQ (fourcc (b, 48U), "fmt ");
+  EXPECT_EQ (fourcc (b, pcm_data_chunk), "data");
+  EXPECT_EQ (le32 (b, pcm_data_chunk + 4U), data_size);
+  EXPECT_EQ (b.back (), 0U);
+
+  std::vector<uint8_t> expected (data_size);
+  to_pcm<24> (span<double const>{in}, span<uint8_t>{expected});
+  EXPECT_TRUE (std::equal (expected.begin (), expected.end (),
+                           b.begin () + pcm_data_chunk + 8U));
+}
+
+TEST (WavStream, SmallBuffers) {
+  // With buffers much smaller than the input, the writer thread is handed many
+  // buffers and frames are split between them.
+  temporary_file file;
+  auto const in = ramp (5000U);
+  {
+    auto os = open (file);
+    wav_stream out{os, wav_format{48000U, 2U, sample_format::int16},
+                   dither_mode::none, 6U};
+    auto pos = size_t{0};
+    for (auto const n : {1U, 7U, 999U, 3U}) {
+      out.write (span<double const>{in.data () + pos, n});
+      pos += n;
+    }
+    std::copy (in.begin () + static_cast<std::ptrdiff_t> (pos), in.end (),
+               std::back_inserter (out));
+    EXPECT_EQ (out.size (), in.size ());
+    EXPECT_TRUE (out.close ());
+  }
+  auto const b = file.contents ();
+  ASSERT_EQ (b.size (), pcm_data_chunk + 8U + in.size () * 2U);
+  EXPECT_EQ (le32 (b, 4U), b.size () - 8U);
+  EXPECT_EQ (le32 (b, pcm_data_chunk + 4U), in.size () * 2U);
+  std::vector<uint8_t> expected (in.size () * 2U);
+  to_pcm<16> (span<double const>{in}, span<uint8_t>{expected});
+  EXPECT_TRUE (std::equal (expected.begin (), expected.end (),
+                           b.begin () + pcm_data_chunk + 8U));
+}
+
+TEST (WavStream, Rf64) {
+  // Lowering the threshold switches the file to RF64 without writing 4 GiB.
+  temporary_file file;
+  auto const in = ramp (1000U);
+  {
+    auto os = open (file);
+    wav_stream out{os, wav_format{48000U, 1U, sample_format::int16}};
+    out.set_rf64_threshold (100U);
+    out.write (span<double const>{in});
+    EXPECT_TRUE (out.close ());
+  }
+  auto const b = file.contents ();
+  auto const data_size = size_t{2000};
+  ASSERT_EQ (b.size (), pcm_data_chunk + 8U + data_size);
+  EXPECT_EQ (fourcc (b, 0U), "RF64");
+  EXPECT_EQ (le32 (b, 4U), 0xFFFFFFFFU);
+  EXPECT_EQ (fourcc (b, 8U), "WAVE");
+  // The JUNK chunk has become ds64 and holds the real sizes.
+  EXPECT_EQ (fourcc (b, 12U), "ds64");
+  EXPECT_EQ (le32 (b, 16U), 28U);
+  EXPECT_EQ (le64 (b, 20U), b.size () - 8U);  // riffSize
+  EXPECT_EQ (le64 (b, 28U), data_size);       // dataSize
+  EXPECT_EQ (le64 (b, 36U), in.size ());      // sampleCount
+  EXPECT_EQ (le32 (b, 44U), 0U);              // tableLength
+  EXPECT_EQ (fourcc (b, pcm_data_chunk), "data");
+  EXPECT_EQ (le32 (b, pcm_data_chunk + 4U), 0xFFFFFFFFU);
+}
+
+TEST (WavStream, Rf64Threshold) {
+  // A RIFF size equal to the threshold still fits in the RIFF header.
+  temporary_file file;
+  auto const in = ramp (1000U);
+  {
+    auto os = open (file);
+    wav_stream out{os, wav_format{48000U, 1U, sample_format::int16}};
+    out.set_rf64_threshold (pcm_data_chunk + in.size () * 2U);
+    out.write (span<double const>{in});
+    EXPECT_TRUE (out.close ());
+  }
+  auto const b = file.contents ();
+  ASSERT_EQ (b.size (), pcm_data_chunk + 8U + in.size () * 2U);
+  EXPECT_EQ (fourcc (b, 0U), "RIFF");
+  EXPECT_EQ (fourcc (b, 12U), "JUNK");
+}
+
+TEST (WavStream, Empty) {
+  temporary_file file;
+  {
+    auto os = open (file);
+    wav_stream out{os, wav_format{}};
+    EXPECT_TRUE (out.close ());
+  }
+  auto const b = file.contents ();
+  ASSERT_EQ (b.size (), pcm_data_chunk + 8U);
+  EXPECT_EQ (le32 (b, 4U), b.size () - 8U);
+  EXPECT_EQ (le32 (b, pcm_data_chunk + 4U), 0U);
+}
+
+TEST (WavStream, DestructorCloses) {
+  // A stream which is destroyed without close() stops its writer thread and
+  // completes the file.
+  temporary_file file;
+  auto const in = ramp (3000U);
+  {
+    auto os = open (file);
+    wav_stream out{os, wav_format{48000U, 1U, sample_format::int32},
+                   dither_mode::none, 64U};
+    out.write (span<double const>{in});
+  }
+  auto const b = file.contents ();
+  ASSERT_EQ (b.size (), pcm_data_chunk + 8U + in.size () * 4U);
+  EXPECT_EQ (le32 (b, 4U), b.size () - 8U);
+  EXPECT_EQ (le32 (b, pcm_data_chunk + 4U), in.size () * 4U);
+}
+
+TEST (WavStream, WriteFailure) {
+  // Errors are reported by close() and the writer thread still stops.
+  failing_buffer buffer;
+  std::ostream os{&buffer};
+  wav_stream out{os, wav_format{48000U, 1U, sample_format::int16},
+                 dither_mode::none, 16U};
+  auto const in = ramp (1000U);
+  out.write (span<double const>{in});
+  EXPECT_FALSE (out.close ());
+}